@@ -313,4 +313,28 @@ next i
 m[1,2,3,4,5,6]=999
 if (999 <> m[1,2,3,4,5,6]) then
   throw "e"
-endif
\ No newline at end of file
+endif
+' reductions over whole arrays
+dim r(300000)
+for i = 0 to 300000: r(i) = (i mod 101) - 50: next
+r(200000) = 99
+s = 0
+for i = 0 to 300000: s += r(i): next
+if (sum(r) != s or max(r) != 99 or min(r) != -50 or absmin(r) != 0 or absmax(r) != 99) then throw "reduce int"
+q = [1, 2.5, 4.5]
+if (sumsq(2, q) != 31.5 or statmean(q, 4) != 3 or max(q, 2) != 4.5 or min(2, q) != 1) then throw "reduce num"
+r(3) = "z"
+q(1) = "6"
+if (max(r) != "z" or min(1, r) != -50 or abs(statmeandev(q) - 17 / 9) > 1e-9) then throw "reduce mixed"
+
+' random fill, reproducible after RANDOMIZE
+dim rf(2, 3)
+rf(1, 1) = "s"
+randomize 5
+rndfill rf
+randomize 5
+for i = 0 to 2
+  for j = 0 to 3
+    if (rf(i, j) != rnd or rf(i, j) < 0 or rf(i, j) >= 1) then throw "rndfill"
+  next j
+next i
@@ -0,0 +1,67 @@
+' HTTP client response parsing, served from a local SSVR listener
+const crlf = chr(13) + chr(10)
+
+' listen on the first free port
+port = 18431
+repeat
+  try
+    open "SSVR:" + port as #1
+    listening = true
+  catch e
+    port++
+  end try
+until listening or port > 18531
+
+' reads the request header, returns the request line
+func serve_request(byref h)
+  local ln, result
+  while h == 0
+    h = accept(1)
+  wend
+  lineinput #h, result
+  repeat
+    lineinput #h, ln
+  until len(trim(ln)) == 0
+  serve_request = trim(result)
+end
+
+sub respond(h, header, body)
+  print #h; "HTTP/1.1 " + header + crlf + crlf + body;
+end
+
+' Content-Length body
+h = 0
+open "http://127.0.0.1:" + port + "/length" as #2
+print serve_request(h)
+respond(h, "200 OK" + crlf + "Content-Length: 5", "hello")
+tload #2, s
+close #2
+print "[" + s + "]"
+
+' chunked body with an extension and a trailer, on the pooled connection
+open "http://127.0.0.1:" + port + "/chunked" as #2
+print serve_request(h)
+respond(h, "200 OK" + crlf + "Transfer-Encoding: chunked", "3;ext=1" + crlf + "abc" + crlf + "A" + crlf + "0123456789" + crlf + "0" + crlf + "X-Trailer: 1" + crlf + crlf)
+tload #2, s
+close #2
+print "[" + s + "]"
+
+' no body after 204 even without Content-Length
+open "http://127.0.0.1:" + port + "/nocontent" as #2
+print serve_request(h)
+respond(h, "204 No Content", "")
+tload #2, s
+close #2
+print "[" + s + "]"
+
+' interim 100 Continue before the final response
+open "http://127.0.0.1:" + port + "/continue" as #2
+print serve_request(h)
+respond(h, "100 Continue", "")
+respond(h, "200 OK" + crlf + "Content-Length: 4", "done")
+tload #2, s
+close #2
+print "[" + s + "]"
+
+close #h
+close #1
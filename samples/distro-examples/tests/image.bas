@@ -0,0 +1,99 @@
+'
+' native image operations
+'
+
+' 4x3 image of opaque ARGB pixels
+dim a(3, 2)
+for i = 0 to 11
+  a(i \ 3, i mod 3) = 0xff000000 + (i * 20) * 0x10000 + (240 - i * 20) * 0x100 + 100
+next
+png = image(a)
+print "size: "; png.width; "x"; png.height
+
+png.getchannel(0, r)
+png.getchannel(1, g)
+png.getchannel(2, b)
+png.getchannel(3, al)
+print "red: "; r
+print "green: "; g
+print "blue: "; b
+print "alpha: "; al
+
+' channel round trip
+png.setchannel(2, g)
+png.getchannel(2, b)
+if (b != g) then throw "setchannel"
+blue = [100,100,100,100; 100,100,100,100; 100,100,100,100]
+png.setchannel(2, blue)
+
+' identity kernel and matrix leave the image unchanged
+k = [0,0,0; 0,1,0; 0,0,0]
+png.convolve(k)
+png.getchannel(0, r2)
+if (r2 != r) then throw "convolve"
+m = [1,0,0; 0,1,0; 0,0,1]
+png.colormatrix(m)
+png.getchannel(0, r2)
+if (r2 != r) then throw "colormatrix"
+
+' a blur of a flat image is flat
+flat = image(a)
+level = [50,50,50,50; 50,50,50,50; 50,50,50,50]
+flat.setchannel(0, level)
+flat.blur(2)
+flat.getchannel(0, r2)
+print "blur flat: "; r2
+
+' swap red and green, halve blue
+m = [0,1,0; 1,0,0; 0,0,0.5]
+png.colormatrix(m)
+png.getchannel(0, r2)
+png.getchannel(1, g2)
+png.getchannel(2, b2)
+print "matrix red: "; r2
+print "matrix green: "; g2
+print "matrix blue: "; b2
+
+png.grey()
+png.getchannel(0, r2)
+print "grey: "; r2
+
+png.threshold(120)
+png.getchannel(1, g2)
+print "threshold: "; g2
+
+png.blur()
+png.getchannel(1, g2)
+print "blur: "; g2
+
+png.sharpen(0.5)
+png.getchannel(1, g2)
+print "sharpen: "; g2
+
+png.resize(8, 6)
+print "resize: "; png.width; "x"; png.height
+png.getchannel(1, g2)
+print "resized: "; g2
+png.getchannel(3, al)
+print "resized alpha: "; al
+
+try
+  png.blur(0)
+  print "blur(0) accepted"
+catch e
+  print "blur(0) rejected"
+end try
+
+try
+  png.resize(32768, 32768)
+  print "resize(32768, 32768) accepted"
+catch e
+  print "resize(32768, 32768) rejected"
+end try
+
+try
+  png.resize(0, 6)
+  print "resize(0, 6) accepted"
+catch e
+  print "resize(0, 6) rejected"
+end try
@@ -0,0 +1,48 @@
+' GETPIXELS and PUTPIXELS, run with --png to draw into an image
+
+' round trip
+dim a(2, 3)
+for j = 0 to 2
+  for i = 0 to 3
+    a(j, i) = rgb(j * 60, i * 50, 255 - j * i)
+  next
+next
+putpixels 10, 20, a
+getpixels 10, 20, 4, 3, b
+print "round trip: "; iff(a = b, "same", "different")
+print "point: "; point(13, 22) = a(2, 3)
+
+' palette colours become rgb
+dim c(0, 1)
+c(0, 0) = 12
+c(0, 1) = 15
+putpixels 0, 0, c
+getpixels 0, 0, 2, 1, c
+print "palette: "; c
+
+' pixels beyond the screen are zero, and not drawn
+rect 0, 0, xmax, ymax, 2 filled
+getpixels xmax - 1, ymax - 1, 3, 3, d
+print "corner: "; d
+getpixels -2, -1, 3, 2, e
+print "origin: "; e
+f = [-0x112233, -0x445566; -0x778899, -0xaabbcc]
+putpixels xmax - 1, -1, f
+getpixels xmax - 1, 0, 2, 1, f
+print "clipped: "; f
+getpixels xmax + 5, 0, 2, 2, g
+print "outside: "; g
+
+' the matrix is limited to the size of the screen
+try
+  getpixels 0, 0, xmax, 1, g
+  print "screen width accepted"
+catch e
+  print "screen width rejected"
+end try
+try
+  getpixels 0, 0, 100000, 100000, g
+  print "100000x100000 accepted"
+catch e
+  print "100000x100000 rejected"
+end try
@@ -159,3 +159,66 @@ local blah,
 local z,
 blah=1
 z=blah
+
+' exit from a loop with block locals
+sub exitfor(a, byref r)
+local s = a
+for i = 1 to 10
+  local q = i
+  if i = 3 then exit sub
+  r = s + q
+next
+end
+
+' recursion with byref parameters and locals
+sub sumdown(n, byref total)
+local k = n
+if n > 0 then sumdown(n - 1, total)
+total += k
+end
+
+r = 0
+exitfor(1, r)
+print r
+r = 0
+sumdown(10, r)
+print r
+
+' single expression functions and tail calls
+func sqr2(x) = x * x
+func hyp2(a, b) = sqr(sqr2(a) + sqr2(b))
+func facttail(n, acc)
+if n <= 1 then return acc
+return facttail(n - 1, acc * n)
+end
+sub countdown(n, s)
+if n = 0 then
+  print s
+  exit sub
+endif
+countdown(n - 1, s + 1)
+end
+print sqr2(1 + 2), hyp2(3, 4)
+print facttail(10, 1), facttail(100000, 1) > 0
+countdown(100000, 0)
+
+' arguments are evaluated once, even when the parameter is used twice
+func diff(x) = x - x
+print diff(rnd), diff(timer), diff(ticks)
+
+' recursion deeper than the initial program stack
+sub deep(n)
+if n > 0 then deep(n - 1)
+end
+deep(5000)
+print fre(-21) > 5000, fre(-22) > fre(-21)
+
+' functions called from expressions nest on the C stack, up to 1024 deep
+func depth(n)
+if n == 0 then
+  depth = 0
+else
+  depth = 1 + depth(n - 1)
+endif
+end
+print depth(1000)
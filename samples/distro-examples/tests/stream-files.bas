@@ -30,6 +30,45 @@ WHILE NOT EOF(F)
 WEND
 CLOSE #F
 
+' WRITE/READ binary round trip
+dim nums(1 to 3, 0 to 1)
+for i = 1 to 3: nums(i, 0) = i * 1.5: nums(i, 1) = -i: next
+ints = [1, 2, 3]
+mixed = [1, "two", 3.5]
+m = {}
+m.name = "sprite"
+m.pos = [10, 20]
+m.child = {}
+m.child.hp = 100
+s$ = "text"
+e = []
+OPEN "test.dat" FOR OUTPUT AS #F
+WRITE #F; nums, ints, mixed, m, s$, e
+CLOSE #F
+OPEN "test.dat" FOR INPUT AS #F
+READ #F; nums2, ints2, mixed2, m2, s2$, e2
+CLOSE #F
+if (nums2 != nums) then throw "READ numeric matrix"
+if (lbound(nums2, 1) != 1 || ubound(nums2, 2) != 1) then throw "READ bounds"
+if (ints2 != ints) then throw "READ int array"
+if (mixed2 != mixed) then throw "READ mixed array"
+if (m2.name != "sprite" || m2.pos(1) != 20 || m2.child.hp != 100) then throw "READ map"
+if (s2$ != s$) then throw "READ string"
+if (len(e2) != 0 || !isarray(e2)) then throw "READ empty array"
+print "WRITE/READ ok"
+
+' asynchronous read/write
+h = AWRITE("test.dat", "first" + chr(10) + "second")
+if (AWAIT(h) != 12) then throw "AWRITE length"
+h = AWRITE("test.dat", chr(13) + chr(10) + "third", 1)
+n = AWAIT(h)
+h = ATLOAD("test.dat")
+r = AREAD("test.dat")
+lines = AWAIT(h)
+if (lines != ["first", "second", "third"]) then throw "ATLOAD"
+if (len(AWAIT(r)) != 19) then throw "AREAD"
+print "AREAD/AWRITE ok"
+
 # find main.cpp in the console folder
 has_main = false
 func walker(node)
@@ -39,4 +78,23 @@ end
 dirwalk "./", "*.cpp" use walker(x)
 if (!has_main) then throw "dirwalk error"
 
+# same again, with the entries passed in batches
+has_main = false
+func batch_walker(nodes)
+  local node
+  for node in nodes
+    if (node.name == "main.cpp" && node.dir == 0) then has_main=true
+  next
+  return 1
+end
+dirwalk "./", "*.cpp", 10 use batch_walker(x)
+if (!has_main) then throw "dirwalk batch error"
+
+# list without a callback
+has_main = false
+for f in dirwalk("./", "*.cpp")
+  if (f like "*/main.cpp") then has_main=true
+next
+if (!has_main) then throw "dirwalk list error"
+
 
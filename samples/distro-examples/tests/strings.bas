@@ -198,3 +198,30 @@ if (asc("\r") != 13) then throw "err6"
 if (asc("\t") !=  9) then throw "err7"
 if (asc("\v") != 11) then throw "err8"
 
+
+' regular expressions
+m = rematch("key=value; x=12", "([a-z]+)=([0-9]+)")
+if (len(m) != 3 or m(0) != "x=12" or m(1) != "x" or m(2) != "12") then throw "rematch"
+if (len(rematch("abc", "z")) != 0) then throw "rematch none"
+m = rematchall("a1 b22 c333", "[0-9]+")
+if (len(m) != 3 or m(2) != "333") then throw "rematchall"
+if (resub("2024-01-05", "([0-9]+)-([0-9]+)-([0-9]+)", "\3/\2/\1") != "05/01/2024") then throw "resub"
+if (resub("aaa", "a", "b", 2) != "bba") then throw "resub count"
+if (resub("abc", "x*", "-") != "-a-b-c-") then throw "resub empty"
+if (resub("abc", "$", "!") != "abc!") then throw "resub end"
+if (resub("abc", "^", "!") != "!abc") then throw "resub start"
+
+' substring search
+s = string(50, "abcde") + "needle"
+if (instr(s, "needle") != 251 or rinstr(s, "bcd") != 247 or rinstr(s, "xyz") != 0) then throw "instr"
+if (instr(100, s, "abcde") != 101 or rinstr(10, "aaaa", "aa") != 0 or rinstr("aaaa", "aa") != 3) then throw "rinstr"
+if (translate("abcabc", "") != "abcabc" or translate("aBcAbc", "b", "--", true) != "a--cA--c") then throw "translate"
+
+' embedded NUL bytes
+z = "a" + chr(0) + "bc"
+if (len(z) != 4 or len(z + z) != 8 or instr(z, "b") != 3 or len(mid(z, 2)) != 3) then throw "nul concat"
+if (len(left(z, 3)) != 3 or right(z, 2) != "bc" or len(chop(z)) != 3 or len(ucase(z)) != 4) then throw "nul left"
+if (z = "a" or "ab" > "abc" or leftof("a=b", "=") != "a" or rightoflast("a.b.c", ".") != "c") then throw "nul compare"
+t = "  keep  "
+if (rtrim(t) != "  keep" or t != "  keep  " or trim(t) != "keep") then throw "rtrim"
+if (replace("abcdef", 2, "XY", 1) != "aXYcdef" or leftoflast("abc", "") != "abc") then throw "replace"
@@ -0,0 +1,20 @@
+' a unit recompiled within the same second to the same size is reloaded
+
+sub write_unit(value)
+  open "cacheunit.bas" for output as #1
+  print #1, "unit cacheunit"
+  print #1, "export f"
+  print #1, "func f"
+  print #1, "  f = " + value
+  print #1, "end"
+  close #1
+  if exist("cacheunit.sbu") then kill "cacheunit.sbu"
+end
+
+write_unit(1)
+chain "import cacheunit" + chr(10) + "print cacheunit.f()"
+write_unit(2)
+chain "import cacheunit" + chr(10) + "print cacheunit.f()"
+
+kill "cacheunit.bas"
+kill "cacheunit.sbu"
@@ -11,7 +11,9 @@
 #include "common/pproc.h"
 #include "common/fmt.h"
 #include "common/keymap.h"
+#include "common/fs_async.h"
 #include "common/messages.h"
+#include "common/blib_math.h"
 
 #define STR_INIT_SIZE 256
 #define PKG_INIT_SIZE 5
@@ -958,16 +960,67 @@ void cmd_gosub() {
   code_jump_label(goto_label);
 }
 
+/**
+ * Evaluates the arguments of a call into new frame slots
+ *
+ * a single variable is kept as a reference, it can be used 'by value' or
+ * 'by reference'. an expression is evaluated into the slot, it can be used
+ * only 'by value'.
+ *
+ * @return the number of arguments
+ */
+static bcip_t cmd_frame_args() {
+  bcip_t pcount = 0;
+  byte ready = 0;
+  do {
+    byte code = code_peek();  // get next BC
+    switch (code) {
+    case kwTYPE_LINE:
+      ready = 1;           // finish flag
+      break;
+    case kwTYPE_EOC:       // end of an expression (parameter)
+      code_skipnext();     // ignore it
+      break;
+    case kwTYPE_SEP:       // separator (comma or semi-colon)
+      code_skipsep();      // ignore it
+      break;
+    case kwTYPE_LEVEL_END: // (right-parenthesis) which means: end of parameters
+      code_skipnext();
+      ready = 1;           // finish flag
+      break;
+
+    case kwTYPE_VAR: {     // the parameter is a variable
+      bcip_t ofs = prog_ip; // keep expression's IP
+      if (code_isvar()) {  // this parameter is a single variable (it is not an expression)
+        frame_slot_t *slot = code_frame_push();
+        slot->ref = code_getvarptr(); // var_t pointer; the variable itself
+        slot->flags = FRAME_ARGREF;
+        pcount++;
+        break;             // we finished with this parameter
+      }
+      prog_ip = ofs;       // back to the start of the expression
+      // now we are sure, this parameter is not a single variable
+      // no 'break' here
+    }
+
+    default:
+      // default: the parameter is an expression, the result is stored in
+      // the slot and becomes the by-val value
+      eval(&code_frame_push()->var);
+      pcount++;
+    }
+  } while (!ready && !prog_error);
+  return pcount;
+}
+
 /**
  * Call a user-defined procedure or function
  *
  * What will happend to the stack
- * [param 1]
- * ...
- * [param N]
  * [udp-call node]
  *
- * p1...pN nodes will be removed by cmd_param()
+ * The arguments are stored in the frame slots starting at vcall.frame,
+ * they are bound to the parameter variables by cmd_param()
  * cmd_param is the first UDP/F's command
  *
  * @param cmd is the type of the udp (function or procedure)
@@ -975,9 +1028,8 @@ void cmd_gosub() {
  * @param return-variable ID
  */
 bcip_t cmd_push_args(int cmd, bcip_t goto_addr, bcip_t rvid) {
-  bcip_t ofs;
+  uint32_t frame = code_frame_top();
   bcip_t pcount = 0;
-  var_t *arg = NULL;
 
   if (code_peek() == kwTYPE_LEVEL_BEGIN) {
     // kwTYPE_LEVEL_BEGIN (which means left-parenthesis)
@@ -997,61 +1049,18 @@ bcip_t cmd_push_args(int cmd, bcip_t goto_addr, bcip_t rvid) {
       rvid = var_ptr.v.ap.v;
     }
 
-    byte ready = 0;
-    do {
-      byte code = code_peek();  // get next BC
-      switch (code) {
-      case kwTYPE_LINE:
-        ready = 1;           // finish flag
-        break;
-      case kwTYPE_EOC:       // end of an expression (parameter)
-        code_skipnext();     // ignore it
-        break;
-      case kwTYPE_SEP:       // separator (comma or semi-colon)
-        code_skipsep();      // ignore it
-        break;
-      case kwTYPE_LEVEL_END: // (right-parenthesis) which means: end of parameters
-        code_skipnext();
-        ready = 1;           // finish flag
-        break;
-
-      case kwTYPE_VAR:       // the parameter is a variable
-        ofs = prog_ip;       // keep expression's IP
-        if (code_isvar()) {  // this parameter is a single variable (it is not an expression)
-          stknode_t *param = code_push(kwTYPE_VAR); // push parameter
-          param->x.param.res = code_getvarptr(); // var_t pointer; the variable itself
-          param->x.param.vcheck = 0x3; // parameter can be used 'by value' or 'by reference'
-          pcount++;
-          break;             // we finished with this parameter
-        }
-
-        prog_ip = ofs;       // back to the start of the expression
-        // now we are sure, this parameter is not a single variable
-        // no 'break' here
-
-      default:
-        // default: the parameter is an expression
-        arg = v_new();       // create a new temporary variable; it is the
-                             // by-val value 'arg' will be freed at udp's return
-        eval(arg);           // execute the expression and store the result to 'arg'
-
-        if (!prog_error) {
-          stknode_t *param = code_push(kwTYPE_VAR); // push parameter
-          param->x.param.res = arg;  // var_t pointer; the variable itself
-          param->x.param.vcheck = 1; // parameter can be used only as 'by value'
-          pcount++;
-        } else {             // error; clean up and return
-          v_free(arg);
-          v_detach(arg);
-          return 0;
-        }
-      }
-    } while (!ready);
+    pcount = cmd_frame_args();
+    if (prog_error) {
+      // error; clean up and return
+      code_frame_release(frame);
+      return 0;
+    }
   }
 
   // store call-info
   stknode_t *vcall = code_push(cmd); // store it to stack
-  vcall->x.vcall.pcount = pcount;    // number parameter-nodes in the stack
+  vcall->x.vcall.pcount = pcount;    // number of arguments in the frame
+  vcall->x.vcall.frame = frame;      // first slot of the frame
   vcall->x.vcall.ret_ip = prog_ip;   // where to go after exit (caller's next address)
   vcall->x.vcall.rvid = rvid;        // return-variable ID
   vcall->x.vcall.task_id = -1;
@@ -1080,73 +1089,18 @@ void cmd_udp(int cmd) {
  * @param rvid return-var-id on callers task (this task)
  */
 void cmd_call_unit_udp(int cmd, int udp_tid, bcip_t goto_addr, bcip_t rvid) {
-  bcip_t ofs;
-  var_t *arg = NULL;
+  uint32_t frame = code_frame_top();
   bcip_t pcount = 0;
   int my_tid = ctask->tid;
 
   if (code_peek() == kwTYPE_LEVEL_BEGIN) {
     code_skipnext();         // kwTYPE_LEVEL_BEGIN (which means left-parenthesis)
-
-    byte ready = 0;
-    do {
-      byte code = code_peek();    // get next BC
-      switch (code) {
-      case kwTYPE_LINE:
-        ready = 1;           // finish flag
-        break;
-      case kwTYPE_EOC:       // end of an expression (parameter)
-        code_skipnext();     // ignore it
-        break;
-      case kwTYPE_SEP:       // separator (comma or semi-colon)
-        code_skipsep();      // ignore it
-        break;
-      case kwTYPE_LEVEL_END: // (right-parenthesis) which means: end of parameters
-        code_skipnext();
-        ready = 1;           // finish flag
-        break;
-      case kwTYPE_VAR:       // the parameter is a variable
-        ofs = prog_ip;       // keep expression's IP
-
-        if (code_isvar()) {  // this parameter is a single variable (not an expression)
-          var_p_t var = code_getvarptr(); // var_t pointer; the variable itself
-          activate_task(udp_tid);
-          stknode_t *param = code_push(kwTYPE_VAR); // push parameter, on unit's task
-          param->x.param.res = var;
-          param->x.param.vcheck = 0x3; // parameter can be used 'by value' or 'by reference'
-          activate_task(my_tid);
-          pcount++;
-          break;             // we finished with this parameter
-        }
-
-        prog_ip = ofs;       // back to the start of the expression
-        // now we are sure, this parameter is not a single variable
-        // no 'break' here
-
-      default:
-        // default: the parameter is an expression
-        arg = v_new();       // create a new temporary variable; it is the by-val value
-                             // 'arg' will be freed at udp's return
-        eval(arg);           // execute the expression and store the result to 'arg'
-
-        if (!prog_error) {
-          activate_task(udp_tid);
-          stknode_t *param = code_push(kwTYPE_VAR);    // push parameter, on unit's task
-          param->x.param.res = arg;  // var_t pointer; the variable itself
-          param->x.param.vcheck = 1; // parameter can be used only as 'by value'
-
-          activate_task(my_tid);
-          pcount++;
-        } else {             // error; clean up and return
-          v_free(arg);
-          v_detach(arg);
-          return;
-        }
-      }
-    } while (!ready);
+    // the frame is shared by all tasks, the arguments are evaluated on this task
+    pcount = cmd_frame_args();
   }
 
   if (prog_error) {
+    code_frame_release(frame);
     return;
   }
 
@@ -1157,7 +1111,8 @@ void cmd_call_unit_udp(int cmd, int udp_tid, bcip_t goto_addr, bcip_t rvid) {
   }
 
   stknode_t *vcall = code_push(cmd); // store it to stack, on unit's task
-  vcall->x.vcall.pcount = pcount;   // the number of parameter-nodes in the stack
+  vcall->x.vcall.pcount = pcount;    // number of arguments in the frame
+  vcall->x.vcall.frame = frame;      // first slot of the frame
   vcall->x.vcall.ret_ip = prog_ip;   // where to go after exit (caller's next address)
   vcall->x.vcall.rvid = rvid;        // return-variable ID
   vcall->x.vcall.task_id = my_tid;
@@ -1171,41 +1126,112 @@ void cmd_call_unit_udp(int cmd, int udp_tid, bcip_t goto_addr, bcip_t rvid) {
   prog_ip = goto_addr + ADDRSZ + 3; // jump to udp's code
 }
 
+/**
+ * Self-recursive call in tail position (RETURN f(x) in FUNC f, or a call to
+ * itself as the last statement of a SUB). The arguments replace the frame of
+ * the current call which is then restarted; no stack node is added.
+ *
+ * the compiler only emits this for SUBs/FUNCs without BYREF parameters
+ */
+void cmd_call_tail() {
+  bcip_t goto_addr = code_getaddr();
+  code_skipaddr();
+  uint32_t args = code_frame_top();
+  bcip_t pcount = 0;
+
+  if (code_peek() == kwTYPE_LEVEL_BEGIN) {
+    code_skipnext();
+    pcount = cmd_frame_args();
+  }
+  if (prog_error) {
+    code_frame_release(args);
+    return;
+  }
+
+  // copy the variable arguments since they may be locals of this call
+  for (uint32_t i = args; i < args + pcount; i++) {
+    frame_slot_t *slot = code_frame_slot(i);
+    if (slot->flags & FRAME_ARGREF) {
+      v_set(&slot->var, slot->ref);
+      slot->flags = 0;
+    }
+  }
+
+  // remove the blocks of the current call
+  stknode_t *ncall = code_stackpeek();
+  while (ncall != NULL && ncall->type != kwPROC && ncall->type != kwFUNC) {
+    code_pop_and_free();
+    ncall = code_stackpeek();
+  }
+  if (ncall == NULL) {
+    code_frame_release(args);
+    err_stackmess();
+    return;
+  }
+
+  code_frame_shift(ncall->x.vcall.frame, args);
+  ncall->x.vcall.pcount = pcount;
+  if (ncall->x.vcall.rvid != INVALID_ADDR) {
+    v_free(tvar[ncall->x.vcall.rvid]);
+  }
+  code_jump(goto_addr);
+}
+
+/**
+ * binds the variable-id to the given variable until the slot is released
+ */
+static inline void cmd_frame_bind(frame_slot_t *slot, bid_t vid, var_t *var) {
+  slot->bind = &tvar[vid];
+  slot->prev = tvar[vid];
+  slot->flags |= FRAME_BOUND;
+  tvar[vid] = var;
+}
+
 /**
  * Create dynamic-variables (actually local-variables)
+ *
+ * LOCALs in the body of a SUB/FUNC are added to the call's frame. LOCALs
+ * inside a block are stored in the stack and removed at the end of the block.
  */
 void cmd_crvar() {
   // number of variables to create
   int count = code_getnext();
+  stknode_t *top = code_stackpeek();
+  int in_frame = (top != NULL && (top->type == kwPROC || top->type == kwFUNC));
+
   for (int i = 0; i < count; i++) {
     // an ID on global-variable-table is used
     bcip_t vid = code_getaddr();
+    if (in_frame) {
+      frame_slot_t *slot = code_frame_push();
+      cmd_frame_bind(slot, vid, &slot->var);
+    } else {
+      // store previous variable to stack
+      // we will restore it at 'return'
+      stknode_t *node = code_push(kwTYPE_CRVAR);
+      node->x.vdvar.vid = vid;
+      node->x.vdvar.vptr = tvar[vid];
 
-    // store previous variable to stack
-    // we will restore it at 'return'
-    stknode_t *node = code_push(kwTYPE_CRVAR);
-    node->x.vdvar.vid = vid;
-    node->x.vdvar.vptr = tvar[vid];
-
-    // create a new variable with the same ID
-    tvar[vid] = v_new();
+      // create a new variable with the same ID
+      tvar[vid] = v_new();
+    }
   }
 }
 
 /**
  * user defined procedure or function - parse parameters code
  *
- * this code will be called by udp/f to check parameter nodes
- * stored in stack by the cmd_udp (call to udp/f)
+ * this code will be called by udp/f to bind the arguments stored in the
+ * frame by the caller (cmd_push_args) to the parameter variables
  *
- * 'by value' parameters are stored as local variables in the stack (kwTYPE_CRVAR)
- * 'by reference' parameters are stored as local variables in the stack (kwTYPE_BYREF)
+ * 'by value' parameters use the variable held in the slot
+ * 'by reference' parameters use the caller's variable
  */
 void cmd_param() {
   // get caller's info-node
-  stknode_t *ncall = &prog_stack[prog_stack_count - 1];
+  stknode_t *ncall = code_stackpeek();
 
-  if (ncall->type != kwPROC && ncall->type != kwFUNC) {
+  if (ncall == NULL || (ncall->type != kwPROC && ncall->type != kwFUNC)) {
     err_stackmess();
     return;
   }
@@ -1218,44 +1244,25 @@ void cmd_param() {
     return;
   }
 
-  if (pcount) {
-    for (int i = 0; i < pcount; i++) {
-      // check parameters one-by-one
-      byte vattr = code_getnext();
-      bid_t vid = code_getaddr();
-      int stack_pos = (prog_stack_count - 1 - pcount) + i;
-      stknode_t *node = &prog_stack[stack_pos];
-      var_t *param_var = node->x.param.res;
-      int vcheck = node->x.param.vcheck;
+  for (int i = 0; i < pcount; i++) {
+    // check parameters one-by-one
+    byte vattr = code_getnext();
+    bid_t vid = code_getaddr();
+    frame_slot_t *slot = code_frame_slot(ncall->x.vcall.frame + i);
 
-      if (node->type != kwTYPE_VAR) {
-        err_stackmess();
-        break;
-      }
-      else if ((vattr & 0x80) == 0) {
-        // UDP requires a 'by value' parameter
-        node->type = kwTYPE_CRVAR;
-        node->x.vdvar.vid = vid;
-        node->x.vdvar.vptr = tvar[vid];
-
-        // assign
-        if (vcheck == 1) {
-          // its already cloned by the CALL (expr)
-          tvar[vid] = param_var;
-        } else {
-          tvar[vid] = v_clone(param_var);
-        }
-      } else if (vcheck == 1) {
-        // error - the parameter can be used only 'by value'
-        err_parm_byref(i);
-        break;
-      } else {
-        // UDP requires 'by reference' parameter
-        node->type = kwBYREF;
-        node->x.vdvar.vid = vid;
-        node->x.vdvar.vptr = tvar[vid];
-        tvar[vid] = param_var;
+    if ((vattr & 0x80) == 0) {
+      // UDP requires a 'by value' parameter
+      if (slot->flags & FRAME_ARGREF) {
+        v_set(&slot->var, slot->ref);
       }
+      cmd_frame_bind(slot, vid, &slot->var);
+    } else if ((slot->flags & FRAME_ARGREF) == 0) {
+      // error - the parameter can be used only 'by value'
+      err_parm_byref(i);
+      break;
+    } else {
+      // UDP requires 'by reference' parameter
+      cmd_frame_bind(slot, vid, slot->ref);
     }
   }
 }
@@ -1282,24 +1289,8 @@ void cmd_udpret() {
     return;
   }
 
-  // handle parameters
-  int i;
-  for (i = ncall.x.vcall.pcount; i > 0 && !prog_error; i--) {
-    stknode_t node;
-    code_pop(&node, 0);
-
-    // local variable - cleanup
-    if (node.type == kwTYPE_CRVAR) {
-      // free local variable data
-      v_free(tvar[node.x.vdvar.vid]);
-      v_detach(tvar[node.x.vdvar.vid]);
-      // restore ptr (replace to pre-call variable)
-      tvar[node.x.vdvar.vid] = node.x.vdvar.vptr;
-    } else if (node.type == kwBYREF) {
-      // variable 'by reference', restore ptr
-      tvar[node.x.vdvar.vid] = node.x.vdvar.vptr;
-    }
-  }
+  // release parameters and locals
+  code_frame_release(ncall.x.vcall.frame);
 
   // restore return value
   if (ncall.x.vcall.rvid != (bid_t) INVALID_ADDR) {
@@ -1367,11 +1358,12 @@ int cmd_exit() {
       v_free(node.x.vcase.var_ptr);
       v_detach(node.x.vcase.var_ptr);
       break;
+    case kwTYPE_CRVAR:
+      // block LOCAL
+      free_node(&node);
+      break;
     case kwPROC:
     case kwFUNC:
-    case kwTYPE_CRVAR:
-    case kwBYREF:
-    case kwTYPE_PARAM:
       if (code == 0 || code == kwPROCSEP || code == kwFUNCSEP) {
         stknode_t *stknode = code_push(node.type);
         *stknode = node;
@@ -2051,22 +2043,36 @@ void cmd_restore() {
  * RANDOMIZE [num]
  */
 void cmd_randomize() {
-  long seed;
+  var_int_t seed;
 
   byte code = code_peek();
   switch (code) {
   case kwTYPE_LINE:
   case kwTYPE_EOC:
-    srand(clock());
+    rnd_seed(time(NULL) ^ clock());
     break;
   default:
     seed = par_getint();
     if (!prog_error) {
-      srand(seed);
+      rnd_seed(seed);
     }
   };
 }
 
+/**
+ * RNDFILL array
+ */
+void cmd_rndfill() {
+  var_t *var_p = par_getvarray();
+  if (!prog_error) {
+    if (var_p == NULL) {
+      err_varisnotarray();
+    } else {
+      rnd_fill(v_elem(var_p, 0), v_asize(var_p));
+    }
+  }
+}
+
 /**
  * DELAY
  */
@@ -2232,7 +2238,21 @@ void cmd_wsplit() {
     char *z;
     var_t *elem_p;
 
+    // characters that end a run of plain text
+    char *stops = malloc(strlen(del) + strlen(pairs) + 1);
+    strcpy(stops, del);
+    strcat(stops, pairs);
+
     while (*p) {
+      if (wait_q) {
+        z = strchr(p, wait_q);
+        p = z ? z : p + strlen(p);
+      } else {
+        p += strcspn(p, stops);
+      }
+      if (*p == '\0') {
+        break;
+      }
       if (wait_q == *p) {
         wait_q = 0;
         p++;
@@ -2292,6 +2312,7 @@ void cmd_wsplit() {
     }
     // cleanup
     pfree3(str, del, pairs);
+    free(stops);
     free(new_text);
   }
 }
@@ -2791,6 +2812,8 @@ void cmd_case() {
       var_t vp_next;
       v_init(&vp_next);
       eval(&vp_next);
+      // the stack may have grown during eval
+      node = code_stackpeek();
       node->x.vcase.flags = v_compare(node->x.vcase.var_ptr, &vp_next) == 0 ? 1 : 0;
       v_free(&vp_next);
     }
@@ -2935,3 +2958,22 @@ void cmd_timer() {
   }
   v_free(&var);
 }
+
+/**
+ * Calls the SUB when the asynchronous request completes
+ *
+ * ADONE handle, sub
+ */
+void cmd_adone() {
+  var_int_t handle = par_getint();
+  if (!prog_error) {
+    par_getcomma();
+    if (code_peek() != kwTYPE_CALL_UDF) {
+      err_syntax(kwADONE, "%I,%G");
+    } else if (!async_set_handler(handle, prog_ip)) {
+      rt_raise(ERR_ASYNC_HANDLE, handle);
+    } else {
+      prog_ip += BC_CTRLSZ + 1;
+    }
+  }
+}
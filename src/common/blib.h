@@ -27,6 +27,7 @@ void dump_stack(void);
 void cmd_udp(int);
 bcip_t cmd_push_args(int cmd, bcip_t goto_addr, bcip_t rvid);
 void cmd_call_unit_udp(int cmd, int udp_tid, bcip_t goto_addr, bcip_t rvid);
+void cmd_call_tail(void);
 void cmd_udpret(void);
 void cmd_crvar(void);
 void cmd_param(void);
@@ -101,6 +102,8 @@ void cmd_arc(void);
 char *draw_getval(const char *src, int *c);
 void cmd_draw(void);
 void cmd_paint(void);
+void cmd_getpixels(void);
+void cmd_putpixels(void);
 void cmd_pen(void);
 void cmd_view(void);
 void cmd_window(void);
@@ -135,6 +138,7 @@ void cmd_integral(void);
 void cmd_root();
 
 void cmd_randomize(void);
+void cmd_rndfill(void);
 void cmd_at(void);
 void cmd_locate(void);
 void cmd_color(void);
@@ -164,6 +168,8 @@ void cmd_fsaveln(void);
 void cmd_flock(void);
 void cmd_chmod(void);
 void cmd_dirwalk(void);
+void cmd_adone(void);
+void dirwalk_list(var_t *result, char *dir, char *wc);
 void cmd_bputc(void);
 void cmd_bload(void);
 void cmd_bsave(void);
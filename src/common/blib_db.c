@@ -15,8 +15,12 @@
 #include "common/blib.h"
 #include "common/messages.h"
 #include "common/fs_socket_client.h"
+#include "common/hashmap.h"
+#include "common/threads.h"
+#include "lib/match.h"
 
 #include <dirent.h>
+#include <errno.h>
 
 #define LDLN_INC    256
 #define GROW_SIZE   1024
@@ -24,11 +28,27 @@
 #define CHK_ERR_CLEANUP(s) if (err_handle_error(s, &file_name)) return;
 #define CHK_ERR(s) if (err_handle_error(s, NULL)) return;
 
+#define ENC_VERSION_1 1
+#define ENC_VERSION_2 2
+#define ENC_MIXED     0xff
+#define ENC_MAX_DEPTH 256
+
+#if defined(_UnixOS) && !defined(_Win32)
+#define DIRWALK_AT
+#endif
+
+#define DIRWALK_OK       0
+#define DIRWALK_ERR_OPEN 1
+#define DIRWALK_ERR_NAME 2
+#define DIRWALK_EVENTS   64
+#define DIRWALK_FLUSH    256
+#define DIRWALK_WAIT     50
+
 struct file_encoded_var {
   byte sign;     // always '$'
-  byte version;  //
+  byte version;  // ENC_VERSION_1 or ENC_VERSION_2
   byte type;     //
-  uint32_t size; //
+  uint32_t size; // V1: data or array size, V2: payload size
 };
 
 /*
@@ -131,60 +151,414 @@ void cmd_fseek() {
 }
 
 /*
- * store a variable in binary form
+ * version 2 payload: a type tag followed by the value. numbers are stored
+ * as raw 64 bit values, strings as uint32 length + bytes, maps as uint32
+ * count + (uint32 key length, key bytes, value) pairs, arrays as the
+ * dimensions, uint32 size and the element type when all elements share
+ * the same numeric type, which are then stored as one packed block. the
+ * whole payload is length prefixed so it can be mapped or read in one go
  */
-void write_encoded_var(int handle, var_t *var) {
-  struct file_encoded_var fv;
+typedef struct var_encoder {
+  hashmap_cb cb;    // first, so map callbacks can find the encoder
+  byte *data;
+  uint32_t size;    // allocated bytes
+  uint32_t length;  // used bytes
+  int depth;
+} var_encoder;
+
+/*
+ * returns the next size bytes of the buffer or NULL when out of memory
+ */
+static byte *encode_reserve(var_encoder *enc, uint32_t size) {
+  byte *result = NULL;
+  if (prog_error) {
+    // already failed
+  } else if (size > UINT32_MAX / 2 - enc->length) {
+    err_memory();
+  } else {
+    if (enc->length + size > enc->size) {
+      uint32_t grow = (enc->length + size) * 2;
+      byte *data = realloc(enc->data, grow);
+      if (data == NULL) {
+        err_memory();
+        return NULL;
+      }
+      enc->data = data;
+      enc->size = grow;
+    }
+    result = enc->data + enc->length;
+    enc->length += size;
+  }
+  return result;
+}
+
+static void encode_bytes(var_encoder *enc, const void *data, uint32_t size) {
+  byte *out = encode_reserve(enc, size);
+  if (out != NULL) {
+    memcpy(out, data, size);
+  }
+}
+
+static void encode_byte(var_encoder *enc, byte b) {
+  encode_bytes(enc, &b, 1);
+}
+
+static void encode_uint32(var_encoder *enc, uint32_t n) {
+  encode_bytes(enc, &n, sizeof(n));
+}
 
-  fv.sign = '$';
-  fv.version = 1;
-  fv.type = var->type;
+static void encode_var(var_encoder *enc, var_t *var);
+
+static int encode_map_count_cb(hashmap_cb *cb, var_p_t key, var_p_t value) {
+  if (value->type != V_FUNC) {
+    cb->count++;
+  }
+  return 0;
+}
+
+static int encode_map_cb(hashmap_cb *cb, var_p_t key, var_p_t value) {
+  var_encoder *enc = (var_encoder *)cb;
+  if (value->type != V_FUNC && !prog_error) {
+    uint32_t len = v_strlen(key);
+    encode_uint32(enc, len);
+    encode_bytes(enc, key->v.p.ptr, len);
+    encode_var(enc, value);
+  }
+  return 0;
+}
+
+/*
+ * returns V_INT or V_NUM when every element has that type
+ */
+static byte encode_packed_type(var_t *var) {
+  uint32_t size = v_asize(var);
+  byte result = size ? v_data(var)[0].type : ENC_MIXED;
+  if (result != V_INT && result != V_NUM) {
+    result = ENC_MIXED;
+  }
+  for (uint32_t i = 1; i < size && result != ENC_MIXED; i++) {
+    if (v_data(var)[i].type != result) {
+      result = ENC_MIXED;
+    }
+  }
+  return result;
+}
+
+static void encode_array(var_encoder *enc, var_t *var) {
+  uint32_t size = v_asize(var);
+  encode_byte(enc, v_maxdim(var));
+  for (int i = 0; i < v_maxdim(var); i++) {
+    int32_t bounds[2] = { v_lbound(var, i), v_ubound(var, i) };
+    encode_bytes(enc, bounds, sizeof(bounds));
+  }
+  encode_uint32(enc, size);
+
+  byte packed = encode_packed_type(var);
+  if (packed != ENC_MIXED && size > UINT32_MAX / sizeof(var_num_t)) {
+    err_memory();
+    return;
+  }
+  encode_byte(enc, packed);
+  switch (packed) {
+  case V_INT: {
+    byte *out = encode_reserve(enc, size * sizeof(var_int_t));
+    for (uint32_t i = 0; out != NULL && i < size; i++, out += sizeof(var_int_t)) {
+      memcpy(out, &v_data(var)[i].v.i, sizeof(var_int_t));
+    }
+    break;
+  }
+  case V_NUM: {
+    byte *out = encode_reserve(enc, size * sizeof(var_num_t));
+    for (uint32_t i = 0; out != NULL && i < size; i++, out += sizeof(var_num_t)) {
+      memcpy(out, &v_data(var)[i].v.n, sizeof(var_num_t));
+    }
+    break;
+  }
+  default:
+    for (uint32_t i = 0; i < size && !prog_error; i++) {
+      encode_var(enc, v_elem(var, i));
+    }
+    break;
+  }
+}
+
+static void encode_var(var_encoder *enc, var_t *var) {
+  if (++enc->depth > ENC_MAX_DEPTH) {
+    rt_raise("WRITE: NESTING TOO DEEP");
+    return;
+  }
+  while (var->type == V_REF && var->v.ref != NULL) {
+    var = var->v.ref;
+  }
   switch (var->type) {
   case V_INT:
-    fv.size = OS_INTSZ;
-    dev_fwrite(handle, (byte *)&fv, sizeof(struct file_encoded_var));
-    dev_fwrite(handle, (byte *)&var->v.i, fv.size);
+    encode_byte(enc, V_INT);
+    encode_bytes(enc, &var->v.i, sizeof(var_int_t));
     break;
   case V_NUM:
-    fv.size = OS_REALSZ;
-    dev_fwrite(handle, (byte *)&fv, sizeof(struct file_encoded_var));
-    dev_fwrite(handle, (byte *)&var->v.n, fv.size);
+    encode_byte(enc, V_NUM);
+    encode_bytes(enc, &var->v.n, sizeof(var_num_t));
     break;
-  case V_STR:
-    fv.size = strlen(var->v.p.ptr);
-    dev_fwrite(handle, (byte *)&fv, sizeof(struct file_encoded_var));
-    dev_fwrite(handle, (byte *)var->v.p.ptr, fv.size);
+  case V_STR: {
+    uint32_t len = v_strlen(var);
+    encode_byte(enc, V_STR);
+    encode_uint32(enc, len);
+    encode_bytes(enc, var->v.p.ptr, len);
     break;
+  }
+  case V_MAP: {
+    hashmap_cb counter;
+    counter.count = 0;
+    hashmap_foreach(var, encode_map_count_cb, &counter);
+    encode_byte(enc, V_MAP);
+    encode_uint32(enc, counter.count);
+    hashmap_foreach(var, encode_map_cb, &enc->cb);
+    break;
+  }
   case V_ARRAY:
-    fv.size = v_asize(var);
-    dev_fwrite(handle, (byte *)&fv, sizeof(struct file_encoded_var));
+    encode_byte(enc, V_ARRAY);
+    encode_array(enc, var);
+    break;
+  default:
+    // pointers and methods are meaningless outside this run
+    encode_byte(enc, V_NIL);
+    break;
+  }
+  enc->depth--;
+}
 
-    // write additional data about array
-    dev_fwrite(handle, &v_maxdim(var), 1);
-    for (int i = 0; i < v_maxdim(var); i++) {
-      dev_fwrite(handle, (byte *)&v_lbound(var, i), sizeof(int));
-      dev_fwrite(handle, (byte *)&v_ubound(var, i), sizeof(int));
+/*
+ * store a variable in binary form
+ */
+void write_encoded_var(int handle, var_t *var) {
+  struct file_encoded_var fv;
+  var_encoder enc;
+
+  enc.size = GROW_SIZE;
+  enc.length = 0;
+  enc.depth = 0;
+  enc.data = malloc(enc.size);
+  if (enc.data == NULL) {
+    err_memory();
+    return;
+  }
+
+  // the header is filled in once the payload size is known
+  encode_reserve(&enc, sizeof(struct file_encoded_var));
+  encode_var(&enc, var);
+
+  if (!prog_error) {
+    fv.sign = '$';
+    fv.version = ENC_VERSION_2;
+    fv.type = var->type;
+    fv.size = enc.length - sizeof(struct file_encoded_var);
+    memcpy(enc.data, &fv, sizeof(struct file_encoded_var));
+    dev_fwrite(handle, enc.data, enc.length);
+  }
+  free(enc.data);
+}
+
+typedef struct var_decoder {
+  const byte *data;
+  uint32_t size;
+  uint32_t pos;
+  int depth;
+} var_decoder;
+
+static const byte *decode_bytes(var_decoder *dec, uint32_t size) {
+  const byte *result;
+  if (size > dec->size - dec->pos) {
+    rt_raise("READ: BAD DATA");
+    result = NULL;
+  } else {
+    result = dec->data + dec->pos;
+    dec->pos += size;
+  }
+  return result;
+}
+
+static int decode_uint32(var_decoder *dec, uint32_t *n) {
+  const byte *p = decode_bytes(dec, sizeof(uint32_t));
+  if (p != NULL) {
+    memcpy(n, p, sizeof(uint32_t));
+  }
+  return p != NULL;
+}
+
+static void decode_str(var_decoder *dec, var_t *var) {
+  uint32_t len;
+  const byte *p;
+  if (decode_uint32(dec, &len) && (p = decode_bytes(dec, len)) != NULL) {
+    v_init_str(var, len);
+    memcpy(var->v.p.ptr, p, len);
+    var->v.p.ptr[len] = '\0';
+  }
+}
+
+static void decode_var(var_decoder *dec, var_t *var);
+
+static void decode_map(var_decoder *dec, var_t *var) {
+  uint32_t count;
+  if (decode_uint32(dec, &count)) {
+    if (count > dec->size - dec->pos) {
+      rt_raise("READ: BAD DATA");
+      return;
+    }
+    hashmap_create(var, count);
+    for (uint32_t i = 0; i < count && !prog_error; i++) {
+      var_t *key = v_new();
+      decode_str(dec, key);
+      if (prog_error) {
+        v_free(key);
+        v_detach(key);
+      } else {
+        decode_var(dec, hashmap_putv(var, key));
+      }
+    }
+  }
+}
+
+/*
+ * returns the number of elements described by the bounds, or zero when
+ * the bounds are invalid
+ */
+static uint64_t decode_array_size(int32_t bounds[][2], int maxdim) {
+  uint64_t result = maxdim ? 1 : 0;
+  for (int i = 0; i < maxdim && result; i++) {
+    if (bounds[i][1] < bounds[i][0]) {
+      result = 0;
+    } else {
+      result *= (uint64_t)((int64_t)bounds[i][1] - bounds[i][0] + 1);
+      if (result > UINT32_MAX) {
+        result = 0;
+      }
     }
+  }
+  return result;
+}
 
-    // write elements
-    for (int i = 0; i < v_asize(var); i++) {
+static void decode_array(var_decoder *dec, var_t *var) {
+  const byte *p = decode_bytes(dec, 1);
+  if (p == NULL) {
+    return;
+  }
+  byte maxdim = *p;
+  int32_t bounds[MAXDIM][2];
+  uint32_t size;
+  if (maxdim > MAXDIM || (p = decode_bytes(dec, maxdim * sizeof(bounds[0]))) == NULL) {
+    if (!prog_error) {
+      rt_raise("READ: BAD DATA");
+    }
+    return;
+  }
+  memcpy(bounds, p, maxdim * sizeof(bounds[0]));
+  if (!decode_uint32(dec, &size) || (p = decode_bytes(dec, 1)) == NULL) {
+    return;
+  }
+  byte packed = *p;
+  if (size != 0 && decode_array_size(bounds, maxdim) != size) {
+    // an empty array keeps the bounds of a single element
+    rt_raise("READ: BAD DATA");
+    return;
+  }
+  uint32_t remain = dec->size - dec->pos;
+  if (packed == V_INT || packed == V_NUM) {
+    if (size > remain / sizeof(var_int_t)) {
+      rt_raise("READ: BAD DATA");
+      return;
+    }
+    p = decode_bytes(dec, size * sizeof(var_int_t));
+  } else if (size > remain) {
+    // each element takes at least one byte
+    rt_raise("READ: BAD DATA");
+    return;
+  }
+
+  v_new_array(var, size);
+  v_maxdim(var) = maxdim;
+  for (int i = 0; i < maxdim; i++) {
+    v_lbound(var, i) = bounds[i][0];
+    v_ubound(var, i) = bounds[i][1];
+  }
+
+  switch (packed) {
+  case V_INT:
+    for (uint32_t i = 0; i < size; i++, p += sizeof(var_int_t)) {
       var_t *elem = v_elem(var, i);
-      write_encoded_var(handle, elem);
+      elem->type = V_INT;
+      memcpy(&elem->v.i, p, sizeof(var_int_t));
     }
     break;
-  };
+  case V_NUM:
+    for (uint32_t i = 0; i < size; i++, p += sizeof(var_num_t)) {
+      var_t *elem = v_elem(var, i);
+      elem->type = V_NUM;
+      memcpy(&elem->v.n, p, sizeof(var_num_t));
+    }
+    break;
+  default:
+    for (uint32_t i = 0; i < size && !prog_error; i++) {
+      decode_var(dec, v_elem(var, i));
+    }
+    break;
+  }
+}
+
+static void decode_var(var_decoder *dec, var_t *var) {
+  const byte *p = decode_bytes(dec, 1);
+  if (p == NULL) {
+    return;
+  }
+  if (++dec->depth > ENC_MAX_DEPTH) {
+    rt_raise("READ: BAD DATA");
+    return;
+  }
+  switch (*p) {
+  case V_INT:
+    if ((p = decode_bytes(dec, sizeof(var_int_t))) != NULL) {
+      var->type = V_INT;
+      memcpy(&var->v.i, p, sizeof(var_int_t));
+    }
+    break;
+  case V_NUM:
+    if ((p = decode_bytes(dec, sizeof(var_num_t))) != NULL) {
+      var->type = V_NUM;
+      memcpy(&var->v.n, p, sizeof(var_num_t));
+    }
+    break;
+  case V_STR:
+    decode_str(dec, var);
+    break;
+  case V_MAP:
+    decode_map(dec, var);
+    break;
+  case V_ARRAY:
+    decode_array(dec, var);
+    break;
+  case V_NIL:
+    var->type = V_NIL;
+    break;
+  default:
+    rt_raise("READ: BAD DATA");
+    break;
+  }
+  dec->depth--;
 }
 
 /*
- * read a variable from a binary form
+ * read a version 1 variable, each element has its own header
  */
-int read_encoded_var(int handle, var_t *var) {
+static int read_encoded_var_v1(int handle, var_t *var, struct file_encoded_var *hdr) {
   struct file_encoded_var fv;
 
-  dev_fread(handle, (byte *)&fv, sizeof(struct file_encoded_var));
-  if (fv.sign != '$') {
-    rt_raise("READ: BAD SIGNATURE");
-    return -1;                  // bad signature
+  if (hdr != NULL) {
+    fv = *hdr;
+  } else {
+    dev_fread(handle, (byte *)&fv, sizeof(struct file_encoded_var));
+    if (fv.sign != '$') {
+      rt_raise("READ: BAD SIGNATURE");
+      return -1;                  // bad signature
+    }
   }
 
   v_free(var);
@@ -198,8 +572,7 @@ int read_encoded_var(int handle, var_t *var) {
     dev_fread(handle, (byte *)&var->v.n, fv.size);
     break;
   case V_STR:
-    var->type = V_STR;
-    var->v.p.ptr = malloc(fv.size + 1);
+    v_init_str(var, fv.size);
     dev_fread(handle, (byte *)var->v.p.ptr, fv.size);
     var->v.p.ptr[fv.size] = '\0';
     break;
@@ -217,7 +590,7 @@ int read_encoded_var(int handle, var_t *var) {
     for (int i = 0; i < v_asize(var); i++) {
       var_t *elem = v_elem(var, i);
       v_init(elem);
-      read_encoded_var(handle, elem);
+      read_encoded_var_v1(handle, elem, NULL);
     }
     break;
   default:
@@ -227,6 +600,44 @@ int read_encoded_var(int handle, var_t *var) {
   return 0;
 }
 
+/*
+ * read a variable from a binary form
+ */
+int read_encoded_var(int handle, var_t *var) {
+  struct file_encoded_var fv;
+
+  dev_fread(handle, (byte *)&fv, sizeof(struct file_encoded_var));
+  if (prog_error) {
+    return -1;
+  }
+  if (fv.sign != '$') {
+    rt_raise("READ: BAD SIGNATURE");
+    return -1;                  // bad signature
+  }
+  if (fv.version == ENC_VERSION_1) {
+    return read_encoded_var_v1(handle, var, &fv);
+  }
+  if (fv.version != ENC_VERSION_2) {
+    rt_raise("READ: BAD VERSION");
+    return -1;
+  }
+
+  dev_fview_t view;
+  if (!dev_fmap(handle, fv.size, &view)) {
+    return -1;
+  }
+  var_decoder dec;
+  dec.data = view.data;
+  dec.size = fv.size;
+  dec.pos = 0;
+  dec.depth = 0;
+  v_free(var);
+  v_init(var);
+  decode_var(&dec, var);
+  dev_funmap(&view);
+  return prog_error ? -2 : 0;
+}
+
 /*
  * WRITE #fileN; var1 [, varN]
  */
@@ -538,6 +949,21 @@ void cmd_floadln() {
     CHK_ERR(FSERR_INVALID_PARAMETER);
     par_getcomma();
     CHK_ERR(FSERR_INVALID_PARAMETER);
+    dev_file_t *f = dev_getfileptr(handle);
+    if (f != NULL && f->type == ft_http_client &&
+        code_peek() == kwTYPE_SEP && code_peeksep() == '#') {
+      // TLOAD #1, #2 - stream the response into file #2
+      par_getsharp();
+      int out_handle = par_getint();
+      if (!prog_error) {
+        if (dev_fstatus(out_handle)) {
+          http_read_file(f, out_handle);
+        } else {
+          rt_raise(ERR_FILE_NOT_OPEN);
+        }
+      }
+      return;
+    }
     array_p = var_p = code_getvarptr();
     CHK_ERR(FSERR_INVALID_PARAMETER);
     if (code_peek() == kwTYPE_SEP) {
@@ -546,8 +972,7 @@ void cmd_floadln() {
       type = par_getint();
     }
 
-    dev_file_t *f = dev_getfileptr(handle);
-    if (f->type == ft_http_client) {
+    if (f != NULL && f->type == ft_http_client) {
       http_read(f, var_p);  // TLOAD #1, html_str
       return;
     }
@@ -796,10 +1221,9 @@ void join_path(char *path, char *ext) {
 }
 
 /*
- * walk on dirs
+ * resolves the leading "." or "~" of the starting directory
  */
-void dirwalk(char *dir, char *wc, bcip_t use_ip, int depth) {
-  char path[OS_PATHNAME_SIZE];
+char *dirwalk_root(char *dir, char *path) {
   path[0] = '\0';
   if (dir[0] == '.') {
     getcwd(path, OS_PATHNAME_SIZE - 1);
@@ -808,21 +1232,80 @@ void dirwalk(char *dir, char *wc, bcip_t use_ip, int depth) {
   } else if (dir[0] == '~') {
     const char *home = getenv("HOME");
     if (home != NULL) {
-      strlcpy(path, home, sizeof(path));
+      strlcpy(path, home, OS_PATHNAME_SIZE);
       join_path(path, ++dir);
       dir = path;
     }
   }
+  return dir;
+}
+
+/*
+ * returns whether the entry is a directory (1) or not (0) when this
+ * is known without a stat call, otherwise -1. symbolic links are not
+ * followed to avoid walking in circles.
+ */
+int dirwalk_d_type(struct dirent *dp) {
+#if defined(DIRWALK_AT) && defined(DT_DIR)
+  switch (dp->d_type) {
+  case DT_DIR:
+    return 1;
+  case DT_UNKNOWN:
+    return -1;
+  default:
+    return 0;
+  }
+#else
+  return -1;
+#endif
+}
+
+/*
+ * stat the entry name within the open directory
+ */
+int dirwalk_stat(DIR *dfd, const char *path, const char *name, struct stat *st, int follow) {
+#if defined(DIRWALK_AT)
+  return fstatat(dirfd(dfd), name, st, follow ? 0 : AT_SYMLINK_NOFOLLOW);
+#else
+  return stat(path, st);
+#endif
+}
+
+/*
+ * builds the map passed to the USE expression
+ */
+void dirwalk_map(var_t *var, const char *dir, const char *name, int depth, struct stat *st) {
+  map_init(var);
+  v_setstr(map_add_var(var, "path", 0), dir);
+  v_setstr(map_add_var(var, "name", 0), name);
+  map_add_var(var, "depth", depth);
+  if (st != NULL) {
+    map_add_var(var, "mtime", st->st_mtime);
+    map_add_var(var, "size", st->st_size);
+    map_add_var(var, "dir", S_ISDIR(st->st_mode) ? 1 : 0);
+  }
+}
+
+/*
+ * walk on dirs, calling the USE expression for each entry
+ */
+void dirwalk(char *dir, char *wc, bcip_t use_ip, int depth) {
+  char path[OS_PATHNAME_SIZE];
+  dir = dirwalk_root(dir, path);
 
   DIR *dfd = opendir(dir);
   if (dfd == NULL) {
-    log_printf(ERR_DIRWALK_CANT_OPEN, dir);
+    // sub-folders may be unreadable or removed by the user-func
+    if (depth == 0 || (errno != EACCES && errno != ENOENT)) {
+      log_printf(ERR_DIRWALK_CANT_OPEN, dir);
+    }
     return;
   }
 
   struct dirent *dp;
+  int entries = 0;
   while ((dp = readdir(dfd)) != NULL) {
-    if (dev_events(0) != 0) {
+    if (++entries % DIRWALK_EVENTS == 0 && dev_events(0) != 0) {
       break;
     }
     if (strcmp(dp->d_name, ".") == 0 || strcmp(dp->d_name, "..") == 0) {
@@ -831,68 +1314,433 @@ void dirwalk(char *dir, char *wc, bcip_t use_ip, int depth) {
     }
     if (strlen(dir) + strlen(dp->d_name) + 2 > OS_PATHNAME_SIZE) {
       rt_raise(ERR_DIRWALK_NAME, dir, dp->d_name);
+      break;
+    }
+
+    // check filename
+    int callusr;
+    int contf = 1;
+    int is_dir = dirwalk_d_type(dp);
+    struct stat st;
+
+    if (!wc) {
+      if (code_peek() == kwTYPE_EOC) {
+        rt_raise(ERR_DIRWALK_MISSING_USE);
+        break;
+      }
+      callusr = 1;
     } else {
-      // check filename
-      int callusr;
-      int contf = 1;
-      struct stat st;
-
-      if (!wc) {
-        if (code_peek() == kwTYPE_EOC) {
-          rt_raise(ERR_DIRWALK_MISSING_USE);
-          break;
-        }
-        callusr = 1;
-      } else {
-        callusr = wc_match(wc, dp->d_name);
+      callusr = wc_match(wc, dp->d_name);
+    }
+
+    char name[OS_PATHNAME_SIZE];
+    strcpy(name, dir);
+    join_path(name, dp->d_name);
+
+    if (callusr) {
+      // call user's function
+      int has_stat = dirwalk_stat(dfd, name, dp->d_name, &st, 1) == 0;
+      var_t *var = v_new();
+      dirwalk_map(var, dir, dp->d_name, depth, has_stat ? &st : NULL);
+      exec_usefunc(var, use_ip);
+      contf = v_getint(var);
+      v_free(var);
+      v_detach(var);
+    }
+    if (!contf || prog_error) {
+      break;
+    }
+
+    // proceed to the next
+    if (is_dir == -1) {
+      is_dir = dirwalk_stat(dfd, name, dp->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+    }
+    if (is_dir) {
+      dirwalk(name, wc, use_ip, depth + 1);
+    }
+  }
+  closedir(dfd);
+}
+
+//
+// parallel walk: worker threads read sub-trees into dirwalk_node lists
+// which the main thread converts to BASIC variables
+//
+typedef struct dirwalk_node {
+  struct dirwalk_node *next;
+  const char *name;   // entry name, following the directory in path
+  time_t mtime;
+  off_t size;
+  int depth;
+  int has_stat;
+  int dir;
+  int error;
+  char path[];        // the directory
+} dirwalk_node;
+
+typedef struct dirwalk_queue {
+  dirwalk_node *head;
+  dirwalk_node *tail;
+  int count;
+} dirwalk_queue;
+
+typedef struct dirwalk_t {
+  thread_lock_t *lock;
+  reg_pattern_t *wc;    // NULL to match everything
+  int batch;
+  dirwalk_queue pending; // directories not yet read
+  dirwalk_queue found;   // matching entries not yet delivered
+  int busy;             // workers reading a directory
+  int running;          // workers not yet finished
+  int cancel;
+} dirwalk_t;
+
+dirwalk_node *dirwalk_node_create(const char *dir, const char *name, int depth) {
+  size_t dir_len = strlen(dir) + 1;
+  size_t name_len = name != NULL ? strlen(name) + 1 : 1;
+  dirwalk_node *node = malloc(sizeof(dirwalk_node) + dir_len + name_len);
+  if (node != NULL) {
+    char *node_name = node->path + dir_len;
+    memcpy(node->path, dir, dir_len);
+    if (name != NULL) {
+      memcpy(node_name, name, name_len);
+    } else {
+      node_name[0] = '\0';
+    }
+    node->next = NULL;
+    node->name = node_name;
+    node->depth = depth;
+    node->has_stat = 0;
+    node->dir = 0;
+    node->error = DIRWALK_OK;
+  }
+  return node;
+}
+
+void dirwalk_queue_add(dirwalk_queue *queue, dirwalk_node *node) {
+  if (node != NULL) {
+    if (queue->tail != NULL) {
+      queue->tail->next = node;
+    } else {
+      queue->head = node;
+    }
+    queue->tail = node;
+    queue->count++;
+  }
+}
+
+void dirwalk_queue_append(dirwalk_queue *queue, dirwalk_queue *other) {
+  if (other->head != NULL) {
+    if (queue->tail != NULL) {
+      queue->tail->next = other->head;
+    } else {
+      queue->head = other->head;
+    }
+    queue->tail = other->tail;
+    queue->count += other->count;
+    other->head = other->tail = NULL;
+    other->count = 0;
+  }
+}
+
+void dirwalk_queue_free(dirwalk_queue *queue) {
+  dirwalk_node *node = queue->head;
+  while (node != NULL) {
+    dirwalk_node *next = node->next;
+    free(node);
+    node = next;
+  }
+  queue->head = queue->tail = NULL;
+  queue->count = 0;
+}
+
+/*
+ * hands the entries read so far to the main thread and newly found
+ * directories to the other workers. returns whether to continue.
+ */
+int dirwalk_flush(dirwalk_t *walk, dirwalk_queue *found, dirwalk_queue *pending) {
+  thread_lock(walk->lock);
+  int wake = pending->count > 0;
+  dirwalk_queue_append(&walk->found, found);
+  dirwalk_queue_append(&walk->pending, pending);
+  if (wake || walk->found.count >= walk->batch) {
+    thread_notify(walk->lock);
+  }
+  int result = !walk->cancel;
+  thread_unlock(walk->lock);
+  return result;
+}
+
+/*
+ * reads a single directory, called without the lock held. wc is the
+ * calling thread's copy of the pattern
+ */
+void dirwalk_read(dirwalk_t *walk, reg_pattern_t *wc, dirwalk_node *parent) {
+  dirwalk_queue found = {NULL, NULL, 0};
+  dirwalk_queue pending = {NULL, NULL, 0};
+  const char *dir = parent->path;
+
+  DIR *dfd = opendir(dir);
+  if (dfd == NULL) {
+    if (parent->depth == 0 || (errno != EACCES && errno != ENOENT)) {
+      dirwalk_node *node = dirwalk_node_create(dir, NULL, parent->depth);
+      if (node != NULL) {
+        node->error = DIRWALK_ERR_OPEN;
+      }
+      dirwalk_queue_add(&found, node);
+      dirwalk_flush(walk, &found, &pending);
+    }
+    return;
+  }
+
+  int next = 1;
+  struct dirent *dp;
+  while (next && (dp = readdir(dfd)) != NULL) {
+    const char *name = dp->d_name;
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+      continue;
+    }
+    if (strlen(dir) + strlen(name) + 2 > OS_PATHNAME_SIZE) {
+      dirwalk_node *node = dirwalk_node_create(dir, name, parent->depth);
+      if (node != NULL) {
+        node->error = DIRWALK_ERR_NAME;
       }
+      dirwalk_queue_add(&found, node);
+      break;
+    }
 
-      char name[OS_PATHNAME_SIZE];
-      strcpy(name, dir);
-      join_path(name, dp->d_name);
-
-      if (callusr) {
-        // call user's function
-        var_t *var = v_new();
-        map_init(var);
-        v_setstr(map_add_var(var, "path", 0), dir);
-        v_setstr(map_add_var(var, "name", 0), dp->d_name);
-        map_add_var(var, "depth", depth);
-        if (stat(name, &st) != -1) {
-          map_add_var(var, "mtime", st.st_mtime);
-          map_add_var(var, "size", st.st_size);
-          map_add_var(var, "dir", (st.st_mode & S_IFDIR) ? 1 : 0);
-        }
-        exec_usefunc(var, use_ip);
-        contf = v_getint(var);
-        v_free(var);
-        v_detach(var);
+    char path[OS_PATHNAME_SIZE];
+    strcpy(path, dir);
+    join_path(path, dp->d_name);
+
+    int match = (wc == NULL || reg_pattern_match(wc, dp->d_name) == reg_match_valid);
+    int is_dir = dirwalk_d_type(dp);
+    struct stat st;
+    if (match) {
+      dirwalk_node *node = dirwalk_node_create(dir, name, parent->depth);
+      if (node != NULL && dirwalk_stat(dfd, path, name, &st, 1) == 0) {
+        node->has_stat = 1;
+        node->mtime = st.st_mtime;
+        node->size = st.st_size;
+        node->dir = S_ISDIR(st.st_mode);
       }
-      if (!contf) {
+      dirwalk_queue_add(&found, node);
+    }
+    if (is_dir == -1) {
+      is_dir = dirwalk_stat(dfd, path, name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+    }
+    if (is_dir) {
+      dirwalk_queue_add(&pending, dirwalk_node_create(path, NULL, parent->depth + 1));
+    }
+    if (found.count + pending.count >= DIRWALK_FLUSH) {
+      next = dirwalk_flush(walk, &found, &pending);
+    }
+  }
+  closedir(dfd);
+  dirwalk_flush(walk, &found, &pending);
+}
+
+/*
+ * reads the next pending directory, called with the lock held
+ */
+void dirwalk_step(dirwalk_t *walk, reg_pattern_t *wc) {
+  dirwalk_node *node = walk->pending.head;
+  walk->pending.head = node->next;
+  if (walk->pending.head == NULL) {
+    walk->pending.tail = NULL;
+  }
+  walk->pending.count--;
+  walk->busy++;
+  thread_unlock(walk->lock);
+
+  dirwalk_read(walk, wc, node);
+  free(node);
+
+  thread_lock(walk->lock);
+  if (--walk->busy == 0 && walk->pending.head == NULL) {
+    thread_notify(walk->lock);
+  }
+}
+
+/*
+ * worker thread: reads pending directories until there are none left
+ * and no other worker can produce more
+ */
+void dirwalk_worker(void *data) {
+  dirwalk_t *walk = (dirwalk_t *)data;
+  reg_pattern_t *wc = walk->wc != NULL ? reg_pattern_copy(walk->wc) : NULL;
+  int ok = (walk->wc == NULL || wc != NULL);
+  thread_lock(walk->lock);
+  while (ok && !walk->cancel) {
+    if (walk->pending.head != NULL) {
+      dirwalk_step(walk, wc);
+    } else if (walk->busy) {
+      thread_wait(walk->lock, -1);
+    } else {
+      break;
+    }
+  }
+  walk->running--;
+  thread_notify(walk->lock);
+  thread_unlock(walk->lock);
+  reg_pattern_free(wc);
+}
+
+/*
+ * passes the nodes to the USE expression in arrays of up to batch maps,
+ * or appends the full path names to list. returns whether to continue.
+ */
+int dirwalk_deliver(dirwalk_node *head, int count, int batch, bcip_t use_ip, var_t *list) {
+  int result = 1;
+  dirwalk_node *node = head;
+  while (node != NULL && result && !prog_error) {
+    int size = (list != NULL || count < batch) ? count : batch;
+    var_t *var = list;
+    uint32_t index = 0;
+    if (list == NULL) {
+      var = v_new();
+      v_toarray1(var, size);
+    } else {
+      index = v_asize(list);
+      v_resize_array(list, index + size);
+    }
+    int used = 0;
+    for (int i = 0; i < size && node != NULL; i++, node = node->next) {
+      if (node->error == DIRWALK_ERR_OPEN) {
+        log_printf(ERR_DIRWALK_CANT_OPEN, node->path);
+      } else if (node->error == DIRWALK_ERR_NAME) {
+        rt_raise(ERR_DIRWALK_NAME, node->path, node->name);
+        result = 0;
         break;
+      } else if (list == NULL) {
+        struct stat st;
+        st.st_mtime = node->mtime;
+        st.st_size = node->size;
+        st.st_mode = node->dir ? S_IFDIR : S_IFREG;
+        dirwalk_map(v_elem(var, used), node->path, node->name, node->depth,
+                    node->has_stat ? &st : NULL);
+        used++;
+      } else {
+        char path[OS_PATHNAME_SIZE];
+        strcpy(path, node->path);
+        join_path(path, (char *)node->name);
+        v_setstr(v_elem(list, index + used), path);
+        used++;
+      }
+    }
+    count -= size;
+    if (used != size) {
+      v_resize_array(var, index + used);
+    }
+    if (list == NULL) {
+      if (used && !prog_error) {
+        exec_usefunc(var, use_ip);
+        result = result && v_getint(var);
       }
+      v_free(var);
+      v_detach(var);
+    }
+  }
+  return result && !prog_error;
+}
 
-      // proceed to the next
-      if (access(name, R_OK) == 0) {
-        // user-func, possible it is deleted
-        if (stat(name, &st) == 0 && st.st_mode & S_IFDIR) {
-          dirwalk(name, wc, use_ip, depth + 1);
-        }
+/*
+ * walk on dirs using worker threads. matching entries are passed to the
+ * USE expression in batches, or appended to list when use_ip is not set.
+ */
+void dirwalk_parallel(char *dir, char *wc, int batch, bcip_t use_ip, var_t *list) {
+  char path[OS_PATHNAME_SIZE];
+  thread_t *threads[THREAD_MAX_WORKERS];
+  dirwalk_t walk;
+
+  memset(&walk, 0, sizeof(walk));
+
+  // compiled here since the workers can't report a bad pattern
+  if (wc != NULL && *wc != '\0' && strcmp(wc, "*") != 0) {
+    walk.wc = reg_pattern_create(wc);
+    if (walk.wc == NULL) {
+      return;
+    }
+  }
+
+  walk.lock = thread_lock_create();
+  walk.batch = batch;
+  dirwalk_queue_add(&walk.pending, dirwalk_node_create(dirwalk_root(dir, path), NULL, 0));
+
+  // with a single cpu the main thread reads between deliveries
+  int workers = thread_workers();
+  if (workers < 2) {
+    workers = 0;
+  }
+  thread_lock(walk.lock);
+  for (int i = 0; i < workers; i++) {
+    threads[i] = thread_start(dirwalk_worker, &walk);
+    if (threads[i] != NULL) {
+      walk.running++;
+    }
+  }
+  thread_unlock(walk.lock);
+
+  int next = 1;
+  while (next) {
+    thread_lock(walk.lock);
+    if (walk.running == 0) {
+      while (walk.found.count < batch && walk.pending.head != NULL) {
+        dirwalk_step(&walk, walk.wc);
       }
+    } else if (walk.found.count < batch) {
+      thread_wait(walk.lock, DIRWALK_WAIT);
+    }
+    dirwalk_queue ready = {NULL, NULL, 0};
+    int more = walk.running > 0 || walk.pending.head != NULL;
+    if (walk.found.count >= batch || !more) {
+      dirwalk_queue_append(&ready, &walk.found);
+    }
+    next = more || ready.head != NULL;
+    thread_unlock(walk.lock);
+
+    if (dev_events(0) != 0) {
+      next = 0;
+    }
+    if (next && ready.head != NULL) {
+      next = dirwalk_deliver(ready.head, ready.count, batch, use_ip, list);
     }
+    dirwalk_queue_free(&ready);
   }
-  closedir(dfd);
+
+  thread_lock(walk.lock);
+  walk.cancel = 1;
+  thread_notify(walk.lock);
+  thread_unlock(walk.lock);
+  for (int i = 0; i < workers; i++) {
+    thread_join(threads[i]);
+  }
+  dirwalk_queue_free(&walk.pending);
+  dirwalk_queue_free(&walk.found);
+  thread_lock_destroy(walk.lock);
+  reg_pattern_free(walk.wc);
+}
+
+/*
+ * returns the full path names of the matching entries
+ *
+ * DIRWALK("/home" [, "*"])
+ */
+void dirwalk_list(var_t *result, char *dir, char *wc) {
+  v_toarray1(result, 0);
+  dirwalk_parallel(dir, wc, DIRWALK_FLUSH, INVALID_ADDR, result);
 }
 
 /*
  * walking on directories
  *
- * DIRWALK "/home" [, "*"] USE MYPRN(x)
+ * DIRWALK "/home" [, "*" [, batch]] USE MYPRN(x)
  */
 void cmd_dirwalk() {
   char *dir = NULL, *wc = NULL;
+  var_int_t batch = 0;
 
-  par_massget("Ss", &dir, &wc);
+  par_massget("Ssi", &dir, &wc, &batch);
   if (!prog_error) {
     bcip_t use_ip, exit_ip;
 
@@ -904,7 +1752,13 @@ void cmd_dirwalk() {
     } else {
       use_ip = exit_ip = INVALID_ADDR;
     }
-    dirwalk(dir, wc, use_ip, 0);
+    if (batch > 0 && use_ip == INVALID_ADDR) {
+      rt_raise(ERR_DIRWALK_MISSING_USE);
+    } else if (batch > 0) {
+      dirwalk_parallel(dir, wc, batch, use_ip, NULL);
+    } else {
+      dirwalk(dir, wc, use_ip, 0);
+    }
 
     if (exit_ip != INVALID_ADDR) {
       code_jump(exit_ip);
@@ -19,6 +19,9 @@
 #include "common/geom.h"
 #include "common/messages.h"
 #include "common/keymap.h"
+#include "common/fs_async.h"
+#include "common/threads.h"
+#include "lib/match.h"
 
 // relative coordinates (current x/y) from blib_graph
 extern int gra_x;
@@ -32,6 +35,12 @@ static char *date_mN_table[] = TABLE_MONTH_FULL;
 
 #define BUF_LEN 64
 
+// arrays from this size are reduced by several workers
+#define DAR_PARALLEL_MIN 0x40000
+
+// elements type checked ahead of each reduction step
+#define DAR_BLOCK 256
+
 /*
  */
 var_int_t r2int(var_num_t x, var_int_t l, var_int_t h) {
@@ -165,6 +174,221 @@ void dar_final(long funcCode, var_t *r, int count) {
   };
 }
 
+/*
+ * ARRAY ROUTINES - reduction of a slice of a numeric array
+ */
+typedef struct dar_part_t {
+  const var_t *data;
+  uint32_t count;
+  long funcCode;
+  int type;         // V_INT or V_NUM, from the first element of the array
+  int mixed;        // an element was not of the expected type
+  var_num_t value;  // SUM, SUMSV, STATMEAN, ABSMAX, ABSMIN
+  uint32_t index;   // MAX, MIN: offset of the first extreme element
+} dar_part_t;
+
+#define DAR_VALUE(e) (is_int ? (var_num_t)(e)->v.i : (e)->v.n)
+
+/*
+ * ARRAY ROUTINES - runs on the interpreter thread or on a worker. Only
+ * reads the elements, in blocks which are type checked while in cache.
+ */
+static void dar_part_reduce(void *data) {
+  dar_part_t *part = (dar_part_t *)data;
+  const var_t *e = part->data;
+  const var_t *end = e + part->count;
+  const int type = part->type;
+  const int is_int = (type == V_INT);
+  var_num_t s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+  if (e->type != type) {
+    part->mixed = 1;
+    return;
+  }
+  if (part->funcCode == kwABSMAX || part->funcCode == kwABSMIN) {
+    s0 = fabs(DAR_VALUE(e));
+  }
+
+  for (const var_t *block = e; block < end; block += DAR_BLOCK) {
+    const var_t *block_end = (end - block > DAR_BLOCK) ? block + DAR_BLOCK : end;
+    const var_t *p;
+    for (p = block; p < block_end; p++) {
+      if (p->type != type) {
+        part->mixed = 1;
+        return;
+      }
+    }
+    p = (block == e) ? e + 1 : block;
+    switch (part->funcCode) {
+    case kwMAX:
+    case kwMIN:
+      // the same rules as v_compare, keeping the first of equal elements
+      for (; p < block_end; p++) {
+        const var_t *best = e + part->index;
+        int next;
+        if (is_int) {
+          next = (part->funcCode == kwMAX) ? p->v.i > best->v.i : p->v.i < best->v.i;
+        } else {
+          var_num_t diff = best->v.n - p->v.n;
+          next = !(fabs(diff) < EPSILON) && ((part->funcCode == kwMAX) == (diff < 0.0));
+        }
+        if (next) {
+          part->index = p - e;
+        }
+      }
+      break;
+    case kwABSMAX:
+      for (; p < block_end; p++) {
+        var_num_t n = fabs(DAR_VALUE(p));
+        if (n > s0) {
+          s0 = n;
+        }
+      }
+      break;
+    case kwABSMIN:
+      for (; p < block_end; p++) {
+        var_num_t n = fabs(DAR_VALUE(p));
+        if (n < s0) {
+          s0 = n;
+        }
+      }
+      break;
+    case kwSUMSV:
+      // independent accumulators let the additions overlap
+      for (p = block; p + 4 <= block_end; p += 4) {
+        var_num_t n0 = DAR_VALUE(p), n1 = DAR_VALUE(p + 1);
+        var_num_t n2 = DAR_VALUE(p + 2), n3 = DAR_VALUE(p + 3);
+        s0 += n0 * n0;
+        s1 += n1 * n1;
+        s2 += n2 * n2;
+        s3 += n3 * n3;
+      }
+      for (; p < block_end; p++) {
+        var_num_t n = DAR_VALUE(p);
+        s0 += n * n;
+      }
+      break;
+    default:
+      for (p = block; p + 4 <= block_end; p += 4) {
+        s0 += DAR_VALUE(p);
+        s1 += DAR_VALUE(p + 1);
+        s2 += DAR_VALUE(p + 2);
+        s3 += DAR_VALUE(p + 3);
+      }
+      for (; p < block_end; p++) {
+        s0 += DAR_VALUE(p);
+      }
+      break;
+    }
+  }
+  part->value = (s0 + s1) + (s2 + s3);
+}
+
+/*
+ * ARRAY ROUTINES - reduces a whole array of numbers of one type into r,
+ * large arrays are divided between workers. Returns 0 when the array
+ * needs the per element dar_first/dar_next path.
+ */
+static int dar_reduce(long funcCode, var_t *r, var_t *array, int first) {
+  dar_part_t parts[THREAD_MAX_WORKERS];
+  thread_t *threads[THREAD_MAX_WORKERS];
+  uint32_t count = v_asize(array);
+  const var_t *data = v_elem(array, 0);
+
+  if (count == 0 || (data->type != V_INT && data->type != V_NUM)) {
+    return 0;
+  }
+
+  int workers = count < DAR_PARALLEL_MIN ? 1 : thread_workers();
+  uint32_t size = count / workers;
+  for (int i = 0; i < workers; i++) {
+    uint32_t offset = i * size;
+    parts[i].data = data + offset;
+    parts[i].count = (i == workers - 1) ? count - offset : size;
+    parts[i].funcCode = funcCode;
+    parts[i].type = data->type;
+    parts[i].mixed = 0;
+    parts[i].value = 0.0;
+    parts[i].index = 0;
+    threads[i] = i == 0 ? NULL : thread_start(dar_part_reduce, &parts[i]);
+  }
+  for (int i = 0; i < workers; i++) {
+    if (threads[i] == NULL) {
+      dar_part_reduce(&parts[i]);
+    }
+  }
+  for (int i = 1; i < workers; i++) {
+    thread_join(threads[i]);
+  }
+
+  int mixed = 0;
+  for (int i = 0; i < workers; i++) {
+    mixed |= parts[i].mixed;
+  }
+  if (mixed) {
+    return 0;
+  }
+
+  var_t value;
+  switch (funcCode) {
+  case kwMAX:
+  case kwMIN:
+    for (int i = 0; i < workers; i++) {
+      var_t *elem_p = (var_t *)parts[i].data + parts[i].index;
+      if (first && i == 0) {
+        dar_first(funcCode, r, elem_p);
+      } else {
+        dar_next(funcCode, r, elem_p);
+      }
+    }
+    break;
+  case kwSUMSV:
+    value.v.n = 0.0;
+    for (int i = 0; i < workers; i++) {
+      value.v.n += parts[i].value;
+    }
+    if (first) {
+      r->type = V_NUM;
+      r->v.n = value.v.n;
+    } else {
+      r->v.n += value.v.n;
+    }
+    break;
+  default:
+    value.type = V_NUM;
+    for (int i = 0; i < workers; i++) {
+      value.v.n = parts[i].value;
+      if (first && i == 0) {
+        dar_first(funcCode, r, &value);
+      } else {
+        dar_next(funcCode, r, &value);
+      }
+    }
+    break;
+  }
+  return 1;
+}
+
+/*
+ * ARRAY ROUTINES - copies the values of an array of numbers of one type,
+ * returns 0 when the array needs converting element by element
+ */
+static int dar_gather(var_t *array, var_num_t *dest) {
+  uint32_t count = v_asize(array);
+  const var_t *data = v_elem(array, 0);
+  int type = count ? data->type : V_NUM;
+  int is_int = (type == V_INT);
+  int result = (type == V_INT || type == V_NUM);
+  for (uint32_t i = 0; result && i < count; i++) {
+    if (data[i].type != type) {
+      result = 0;
+    } else {
+      dest[i] = DAR_VALUE(data + i);
+    }
+  }
+  return result;
+}
+
 /*
  * DATE mm/dd/yy string to ints
  */
@@ -480,7 +704,7 @@ var_num_t cmd_math0(long funcCode) {
     }
     break;
   case kwRND:
-    r = ((var_num_t) rand()) / (RAND_MAX + 1.0);
+    r = rnd_next();
     break;
   default:
     rt_raise("Unsupported built-in function call %ld", funcCode);
@@ -663,6 +887,14 @@ var_num_t cmd_math1(long funcCode, var_t *arg) {
 //
 var_int_t cmd_fre(var_int_t arg) {
   var_int_t r = 0;
+  switch (arg) {
+  case -20: // program stack depth
+    return prog_stack_count;
+  case -21: // highest program stack depth
+    return prog_stack_peak;
+  case -22: // program stack limit
+    return code_stack_limit();
+  }
 #if defined(_Win32)
   MEMORYSTATUS ms;
   ms.dwLength = sizeof(MEMORYSTATUS);
@@ -992,10 +1224,11 @@ void cmd_str1(long funcCode, var_t *arg, var_t *r) {
     //
     // str <- LCASE$(s)
     //
-    r->v.p.ptr = v_str(arg);
-    r->v.p.length = strlen(r->v.p.ptr) + 1;
+    v_set(r, arg);
+    v_tostr(r);
+    l = v_strlen(r);
     p = r->v.p.ptr;
-    while (*p) {
+    while (l-- > 0) {
       *p = to_lower(*p);
       p++;
     }
@@ -1004,10 +1237,11 @@ void cmd_str1(long funcCode, var_t *arg, var_t *r) {
     //
     // str <- UCASE$(s)
     //
-    r->v.p.ptr = v_str(arg);
-    r->v.p.length = strlen(r->v.p.ptr) + 1;
+    v_set(r, arg);
+    v_tostr(r);
+    l = v_strlen(r);
     p = r->v.p.ptr;
-    while (*p) {
+    while (l-- > 0) {
       *p = to_upper(*p);
       p++;
     }
@@ -1021,12 +1255,11 @@ void cmd_str1(long funcCode, var_t *arg, var_t *r) {
       break;
     }
     p = arg->v.p.ptr;
-    while (is_wspace(*p)) {
+    wp = p + v_strlen(arg);
+    while (p < wp && is_wspace(*p)) {
       p++;
     }
-    r->v.p.ptr = (char *)malloc(strlen(p) + 1);
-    strcpy(r->v.p.ptr, p);
-    r->v.p.length = strlen(r->v.p.ptr) + 1;
+    v_setstrn(r, p, wp - p);
     break;
   case kwTRIM:
     //
@@ -1041,32 +1274,16 @@ void cmd_str1(long funcCode, var_t *arg, var_t *r) {
       break;
     }
     p = arg->v.p.ptr;
-    if (*p != '\0') {
-      while (*p) {
-        p++;
-      }
-      p--;
-      while (p >= arg->v.p.ptr && (is_wspace(*p))) {
-        p--;
-      }
-      p++;
-      *p = '\0';
+    wp = p + v_strlen(arg);
+    while (wp > p && is_wspace(wp[-1])) {
+      wp--;
     }
-    r->v.p.ptr = (char *)malloc(strlen(arg->v.p.ptr) + 1);
-    strcpy(r->v.p.ptr, arg->v.p.ptr);
-    r->v.p.length = strlen(r->v.p.ptr) + 1;
-
-    // alltrim
     if (funcCode == kwTRIM) {
-      char *tmp_p = p = r->v.p.ptr;
-      while (is_wspace(*p)) {
+      while (p < wp && is_wspace(*p)) {
         p++;
       }
-      r->v.p.ptr = (char *)malloc(strlen(p) + 1);
-      strcpy(r->v.p.ptr, p);
-      r->v.p.length = strlen(r->v.p.ptr) + 1;
-      free(tmp_p);
     }
+    v_setstrn(r, p, wp - p);
     break;
   case kwCAT:
     // we can add color codes
@@ -1352,16 +1569,10 @@ void cmd_strN(long funcCode, var_t *r) {
     //
     // s <- CHOP(s)
     //
-    par_massget("S", &s1);
+    var_p1 = par_next_str(&arg1, 0);
     if (!prog_error) {
-      if (strlen(s1)) {
-        r->v.p.ptr = strdup(s1);
-        r->v.p.ptr[strlen(r->v.p.ptr) - 1] = '\0';
-        r->type = V_STR;
-        r->v.p.length = strlen(r->v.p.ptr) + 1;
-      } else {
-        v_zerostr(r);
-      }
+      len = v_strlen(var_p1);
+      v_setstrn(r, var_p1->v.p.ptr, len ? len - 1 : 0);
     }
     break;
   case kwSTRING:
@@ -1391,11 +1602,11 @@ void cmd_strN(long funcCode, var_t *r) {
         r->type = V_INT;        // dont try to free
       } else {
         r->v.p.ptr = malloc(count * len + 1);
-        *((r->v.p.ptr)) = '\0';
         for (int i = 0; i < count; i++) {
-          strcat(r->v.p.ptr, tmp_p);
+          memcpy(r->v.p.ptr + (i * len), tmp_p, len);
         }
-        r->v.p.length = strlen(r->v.p.ptr) + 1;
+        r->v.p.ptr[count * len] = '\0';
+        r->v.p.length = count * len + 1;
       }
     }
     break;
@@ -1487,20 +1698,17 @@ void cmd_strN(long funcCode, var_t *r) {
     //
     // str <- LEFT$ ( str [, int] )
     //
-    count = 1;
-    par_massget("Si", &s1, &count);
+    var_p1 = par_next_str(&arg1, 0);
+    count = par_getval(1);
     if (!prog_error) {
-      len = strlen(s1);
+      len = v_strlen(var_p1);
       if (count > len) {
         count = len;
       }
       if (count < 0) {
         count = 0;
       }
-      r->v.p.ptr = malloc(count + 1);
-      memcpy(r->v.p.ptr, s1, count);
-      r->v.p.ptr[count] = '\0';
-      r->v.p.length = count + 1;
+      v_setstrn(r, var_p1->v.p.ptr, count);
     }
     break;
 
@@ -1508,41 +1716,36 @@ void cmd_strN(long funcCode, var_t *r) {
     //
     // str <- LEFTOF$(str, strof)
     //
-    par_massget("SS", &s1, &s2);
+    v_init(&arg2);
+    var_p1 = par_next_str(&arg1, 1);
+    var_p2 = par_next_str(&arg2, 0);
     if (!prog_error) {
-      char *p = strstr(s1, s2);
+      const char *p = str_find(var_p1->v.p.ptr, v_strlen(var_p1),
+                               var_p2->v.p.ptr, v_strlen(var_p2), 0);
       if (p != NULL) {
-        char lc = *p;
-        *p = '\0';
-        int l = strlen(s1) + 1;
-        r->v.p.ptr = malloc(l);
-        strcpy(r->v.p.ptr, s1);
-        r->v.p.length = l;
-        *p = lc;
+        v_setstrn(r, var_p1->v.p.ptr, p - var_p1->v.p.ptr);
       } else {
         v_zerostr(r);
       }
     }
+    v_free(&arg2);
     break;
 
   case kwRIGHT:
     //
     // str <- RIGHT$ ( str [, int] )
     //
-    count = 1;
-    par_massget("Si", &s1, &count);
+    var_p1 = par_next_str(&arg1, 0);
+    count = par_getval(1);
     if (!prog_error) {
-      len = strlen(s1);
+      len = v_strlen(var_p1);
       if (count > len) {
         count = len;
       }
       if (count < 0) {
         count = 0;
       }
-      r->v.p.ptr = malloc(count + 1);
-      memcpy(r->v.p.ptr, s1 + (len - count), count + 1);
-      r->v.p.ptr[count] = '\0';
-      r->v.p.length = count + 1;
+      v_setstrn(r, var_p1->v.p.ptr + (len - count), count);
     }
     break;
 
@@ -1550,73 +1753,58 @@ void cmd_strN(long funcCode, var_t *r) {
     //
     // str <- RIGHTOF$(str, strof)
     //
-    par_massget("SS", &s1, &s2);
+    v_init(&arg2);
+    var_p1 = par_next_str(&arg1, 1);
+    var_p2 = par_next_str(&arg2, 0);
     if (!prog_error) {
-      char *p = strstr(s1, s2);
+      len = v_strlen(var_p1);
+      lsrc = v_strlen(var_p2);
+      const char *p = str_find(var_p1->v.p.ptr, len, var_p2->v.p.ptr, lsrc, 0);
       if (p != NULL) {
-        p += strlen(s2);
-        int l = strlen(p) + 1;
-        r->v.p.ptr = malloc(l);
-        memcpy(r->v.p.ptr, p, l);
-        r->v.p.length = l;
+        p += lsrc;
+        v_setstrn(r, p, len - (p - var_p1->v.p.ptr));
       } else {
         v_zerostr(r);
       }
     }
+    v_free(&arg2);
     break;
 
   case kwLEFTOFLAST:
     //
     // str <- LEFTOFLAST$(str, strof)
     //
-    par_massget("SS", &s1, &s2);
-    if (!prog_error) {
-      char *lp = s1;
-      int l2 = strlen(s2);
-      char *p = NULL;
-      while ((lp = strstr(lp, s2)) != NULL) {
-        p = lp;
-        lp += l2;
-      };
-
-      if (p) {
-        char lc = *p;
-        *p = '\0';
-        int l = strlen(s1) + 1;
-        r->v.p.ptr = malloc(l);
-        memcpy(r->v.p.ptr, s1, l);
-        r->v.p.length = l;
-        *p = lc;
-      } else {
-        v_zerostr(r);
-      }
-    }
-    break;
-
   case kwRIGHTOFLAST:
     //
     // str <- RIGHTOFLAST$(str, strof)
     //
-    par_massget("SS", &s1, &s2);
+    v_init(&arg2);
+    var_p1 = par_next_str(&arg1, 1);
+    var_p2 = par_next_str(&arg2, 0);
     if (!prog_error) {
-      char *lp = s1;
-      int l2 = strlen(s2);
-      char *p = NULL;
-      while ((lp = strstr(lp, s2)) != NULL) {
-        p = lp;
-        lp += l2;
-      };
-
-      if (p) {
-        p += l2;
-        int l = strlen(p) + 1;
-        r->v.p.ptr = malloc(l);
-        memcpy(r->v.p.ptr, p, l);
-        r->v.p.length = l;
+      // the last of the non-overlapping matches
+      const char *end = var_p1->v.p.ptr + v_strlen(var_p1);
+      const char *lp = var_p1->v.p.ptr;
+      const char *p = NULL;
+      int l2 = v_strlen(var_p2);
+      if (l2 == 0) {
+        p = end;
       } else {
+        while ((lp = str_find(lp, end - lp, var_p2->v.p.ptr, l2, 0)) != NULL) {
+          p = lp;
+          lp += l2;
+        }
+      }
+      if (p == NULL) {
         v_zerostr(r);
+      } else if (funcCode == kwLEFTOFLAST) {
+        v_setstrn(r, var_p1->v.p.ptr, p - var_p1->v.p.ptr);
+      } else {
+        p += l2;
+        v_setstrn(r, p, end - p);
       }
     }
+    v_free(&arg2);
     break;
 
   case kwREPLACE:
@@ -1631,15 +1819,8 @@ void cmd_strN(long funcCode, var_t *r) {
     if (!prog_error) {
       // write str into pos of source the return the new string
       int len_source = v_strlen(var_p1);
-      int len_str;
-      char *str;
-      if (var_p2->type != V_STR) {
-        str = v_str(var_p2);
-        len_str = strlen(str);
-      } else {
-        str = NULL;
-        len_str = v_strlen(var_p2);
-      }
+      int len_str = v_strlen(var_p2);
+      int len_tail;
 
       start--;
       if (start < 0) {
@@ -1652,31 +1833,15 @@ void cmd_strN(long funcCode, var_t *r) {
         // how much of "str" to retain
         count = len_str;
       }
+      len_tail = (start + count < len_source) ? len_source - (start + count) : 0;
 
-      // calculate the final length
-      r->v.p.length = start + len_str + 1;
-      if (start + count < len_source) {
-        r->v.p.length += (len_source - (start + count));
-      }
+      // source left side, str, then the remainder of source after count
+      r->v.p.length = start + len_str + len_tail + 1;
       r->v.p.ptr = malloc(r->v.p.length);
-
-      // copy the left side of "source"
       memcpy(r->v.p.ptr, var_p1->v.p.ptr, start);
-
-      // insert "str"
-      r->v.p.ptr[start] = '\0';
-
-      if (str != NULL) {
-        strcat(r->v.p.ptr, str);
-        free(str);
-      } else {
-        strcat(r->v.p.ptr, var_p2->v.p.ptr);
-      }
-
-      // add the remainder of "source" startin at index "count"
-      if (start + count < len_source) {
-        strcat(r->v.p.ptr, var_p1->v.p.ptr + start + count);
-      }
+      memcpy(r->v.p.ptr + start, var_p2->v.p.ptr, len_str);
+      memcpy(r->v.p.ptr + start + len_str, var_p1->v.p.ptr + start + count, len_tail);
+      r->v.p.ptr[start + len_str + len_tail] = '\0';
     }
     v_free(&arg2);
     break;
@@ -1734,9 +1899,10 @@ void cmd_intN(long funcCode, var_t *r) {
   char *s1 = NULL, *s2 = NULL, *s3 = NULL;
   var_int_t start;
 
-  var_t arg1;
+  var_t arg1, arg2, arg3;
   int l;
   var_t *var_p = NULL;
+  var_t *var_p2 = NULL;
 
   r->type = V_INT;
   v_init(&arg1);
@@ -1751,28 +1917,39 @@ void cmd_intN(long funcCode, var_t *r) {
     //
     r->v.i = 0;
     start = 1;
-    if (par_massget("iSS", &start, &s1, &s2) > 1 &&
-        !prog_error && s1[0] != '\0' && s2[0] != '\0') {
+    v_init(&arg2);
+    v_init(&arg3);
+    var_p = par_next_str(&arg1, 1);
+    var_p2 = par_next_str(&arg2, 0);
+    if (!prog_error && code_peek() != kwTYPE_LEVEL_END) {
+      // the leading start position was given
+      start = v_getint(var_p);
+      var_p = var_p2;
+      var_p2 = par_next_str(&arg3, 0);
+    }
+    if (!prog_error) {
+      const char *s = var_p->v.p.ptr;
+      int s_len = v_strlen(var_p);
+      l = v_strlen(var_p2);
       start--;
-      int s1_len = strlen(s1);
-      if (start >= s1_len) {
-        start = s1_len;
+      if (start >= s_len) {
+        start = s_len;
       }
       if (start < 0) {
         start = 0;
       }
-      char *p = s1 + start;
-      l = strlen(s2);
-      while (*p) {
-        if (strncmp(p, s2, l) == 0) {
-          r->v.i = (p - s1) + 1;
-          if (funcCode == kwINSTR) {
-            break;
-          }
-        }
-        p++;
+      const char *p = NULL;
+      if (s_len && l) {
+        p = (funcCode == kwINSTR) ?
+            str_find(s + start, s_len - start, var_p2->v.p.ptr, l, 0) :
+            str_rfind(s + start, s_len - start, var_p2->v.p.ptr, l);
+      }
+      if (p != NULL) {
+        r->v.i = (p - s) + 1;
       }
     }
+    v_free(&arg2);
+    v_free(&arg3);
     break;
   case kwISARRAY:
     cmd_is_var_type(V_ARRAY, &arg1, r);
@@ -2033,6 +2210,88 @@ void cmd_numN(long funcCode, var_t *r) {
   }
 }
 
+// capture groups returned by REMATCH and used by RESUB
+#define REGEX_GROUPS 10
+
+/*
+ * array <- REMATCH(s, pattern): the match followed by its groups
+ */
+static void regex_match(var_t *r, const char *s, const char *pattern) {
+  int ovector[REGEX_GROUPS * 2];
+  int groups = reg_search(pattern, s, strlen(s), 0, ovector, REGEX_GROUPS);
+  v_toarray1(r, groups > 0 ? groups : 0);
+  for (int i = 0; i < groups; i++) {
+    var_t *elem = v_elem(r, i);
+    if (ovector[i * 2] == -1) {
+      v_setstr(elem, "");
+    } else {
+      v_setstrn(elem, s + ovector[i * 2], ovector[i * 2 + 1] - ovector[i * 2]);
+    }
+  }
+}
+
+/*
+ * array <- REMATCHALL(s, pattern): every match, left to right
+ */
+static void regex_match_all(var_t *r, const char *s, const char *pattern) {
+  int len = strlen(s);
+  int ovector[2];
+  int offset = 0;
+  int count = 0;
+  v_toarray1(r, 0);
+  while (offset <= len && reg_search(pattern, s, len, offset, ovector, 1) > 0) {
+    v_resize_array(r, count + 1);
+    v_setstrn(v_elem(r, count++), s + ovector[0], ovector[1] - ovector[0]);
+    // an empty match would be found again at the same place
+    offset = ovector[1] > ovector[0] ? ovector[1] : ovector[1] + 1;
+  }
+}
+
+/*
+ * s <- RESUB(s, pattern, replacement [, count]): \0..\9 in the replacement
+ * insert the match or a group, \\ a backslash
+ */
+static void regex_sub(var_t *r, const char *s, const char *pattern, const char *repl, var_int_t limit) {
+  int len = strlen(s);
+  int ovector[REGEX_GROUPS * 2];
+  int offset = 0;
+  int copied = 0;
+  int count = 0;
+  int groups;
+  cstr out;
+  cstr_init(&out, len + 1);
+  while (offset <= len && (limit <= 0 || count++ < limit) &&
+         (groups = reg_search(pattern, s, len, offset, ovector, REGEX_GROUPS)) > 0) {
+    cstr_append_i(&out, s + copied, ovector[0] - copied);
+    for (const char *p = repl; *p; p++) {
+      if (*p == '\\' && isdigit(p[1])) {
+        int group = *++p - '0';
+        if (group < groups && ovector[group * 2] != -1) {
+          cstr_append_i(&out, s + ovector[group * 2], ovector[group * 2 + 1] - ovector[group * 2]);
+        }
+      } else if (*p == '\\' && p[1] == '\\') {
+        cstr_append_i(&out, p++, 1);
+      } else {
+        cstr_append_i(&out, p, 1);
+      }
+    }
+    copied = ovector[1];
+    if (ovector[1] > ovector[0]) {
+      offset = ovector[1];
+    } else {
+      // keep the character after an empty match
+      if (ovector[1] < len) {
+        cstr_append_i(&out, s + ovector[1], 1);
+      }
+      offset = copied = ovector[1] + 1;
+    }
+  }
+  if (copied < len) {
+    cstr_append_i(&out, s + copied, len - copied);
+  }
+  v_move_str(r, out.buf);
+}
+
 /*
  * any <- FUNC (...)
  */
@@ -2561,6 +2820,11 @@ void cmd_genfunc(long funcCode, var_t *r) {
           var_t *basevar_p = code_getvarptr();
           if (!prog_error && basevar_p->type == V_ARRAY) {
             count = v_asize(basevar_p);
+            if (dar_reduce(funcCode, r, basevar_p, first)) {
+              first = 0;
+              tcount += count;
+              break;
+            }
             for (int i = 0; i < count; i++) {
               var_t *elem_p = v_elem(basevar_p, i);
               if (!prog_error) {
@@ -2631,6 +2895,14 @@ void cmd_genfunc(long funcCode, var_t *r) {
           var_t *basevar_p = code_getvarptr();
           if (!prog_error && basevar_p->type == V_ARRAY) {
             count = v_asize(basevar_p);
+            if (tcount + count > len) {
+              len = tcount + count + BUF_LEN;
+              dar = (var_num_t*) realloc(dar, sizeof(var_num_t) * len);
+            }
+            if (dar_gather(basevar_p, dar + tcount)) {
+              tcount += count;
+              break;
+            }
             for (int i = 0; i < count; i++) {
               var_t *elem_p = v_elem(basevar_p, i);
               if (!prog_error) {
@@ -2894,6 +3166,165 @@ void cmd_genfunc(long funcCode, var_t *r) {
     v_create_window(r);
     break;
 
+    //
+    // handle <- ACCEPT(listener)
+    //
+  case kwACCEPT:
+    handle = par_getint();
+    IF_ERR_RETURN;
+    v_setint(r, dev_faccept(handle));
+    break;
+
+    //
+    // array <- POLL(handles [, timeout])
+    //
+  case kwPOLL: {
+    var_int_t timeout = -1;
+    v_init(&arg);
+    eval(&arg);
+    if (!prog_error && code_peek() == kwTYPE_SEP) {
+      par_getcomma();
+      if (!prog_error) {
+        timeout = par_getint();
+      }
+    }
+    if (!prog_error) {
+      count = (arg.type == V_ARRAY) ? v_asize(&arg) : 1;
+      int *handles = malloc(sizeof(int) * (count + 1));
+      int *ready = malloc(sizeof(int) * (count + 1));
+      for (int i = 0; i < count; i++) {
+        handles[i] = v_getint(arg.type == V_ARRAY ? v_elem(&arg, i) : &arg);
+      }
+      tcount = dev_fpoll(handles, count, timeout, ready);
+      v_toarray1(r, prog_error ? 0 : tcount);
+      for (int i = 0, j = 0; i < count && j < tcount && !prog_error; i++) {
+        if (ready[i]) {
+          v_setint(v_elem(r, j++), handles[i]);
+        }
+      }
+      free(handles);
+      free(ready);
+    } else {
+      v_toarray1(r, 0);
+    }
+    v_free(&arg);
+  }
+    break;
+
+    //
+    // array <- DIRWALK(dir [, wildcards])
+    //
+  case kwDIRWALKF: {
+    char *dir = NULL, *wc = NULL;
+    par_massget("Ss", &dir, &wc);
+    if (!prog_error) {
+      dirwalk_list(r, dir, wc);
+    }
+    pfree2(dir, wc);
+  }
+    break;
+
+    //
+    // handle <- AREAD(file) / ATLOAD(file)
+    //
+  case kwAREAD:
+  case kwATLOAD:
+    v_init(&arg);
+    par_getstr(&arg);
+    if (!prog_error) {
+      async_op_t op = (funcCode == kwAREAD) ? async_read : async_lines;
+      v_setint(r, async_submit(op, arg.v.p.ptr, NULL, 0));
+    }
+    v_free(&arg);
+    break;
+
+    //
+    // handle <- AWRITE(file, data [, append])
+    //
+  case kwAWRITE: {
+    var_int_t append = 0;
+    v_init(&arg);
+    v_init(&arg2);
+    par_getstr(&arg);
+    if (!prog_error) {
+      par_getcomma();
+    }
+    if (!prog_error) {
+      eval(&arg2);
+      v_tostr(&arg2);
+    }
+    if (!prog_error && code_peek() == kwTYPE_SEP) {
+      par_getcomma();
+      if (!prog_error) {
+        append = par_getint();
+      }
+    }
+    if (!prog_error) {
+      async_op_t op = append ? async_append : async_write;
+      v_setint(r, async_submit(op, arg.v.p.ptr, arg2.v.p.ptr, v_strlen(&arg2)));
+    }
+    v_free(&arg);
+    v_free(&arg2);
+  }
+    break;
+
+    //
+    // n <- ADONE(handle)
+    //
+  case kwADONE:
+    handle = par_getint();
+    IF_ERR_RETURN;
+    count = async_done(handle);
+    if (count == -1) {
+      rt_raise(ERR_ASYNC_HANDLE, handle);
+    } else {
+      v_setint(r, count);
+    }
+    break;
+
+    //
+    // result <- AWAIT(handle)
+    //
+  case kwAWAIT:
+    handle = par_getint();
+    IF_ERR_RETURN;
+    if (async_wait(handle) || async_done(handle) == -1) {
+      async_result(handle, r);
+    }
+    break;
+
+    //
+    // array <- REMATCH(s, pattern) / REMATCHALL(s, pattern)
+    //
+  case kwREMATCH:
+  case kwREMATCHALL: {
+    char *s = NULL, *pattern = NULL;
+    par_massget("SS", &s, &pattern);
+    if (!prog_error) {
+      if (funcCode == kwREMATCH) {
+        regex_match(r, s, pattern);
+      } else {
+        regex_match_all(r, s, pattern);
+      }
+    }
+    pfree2(s, pattern);
+  }
+    break;
+
+    //
+    // s <- RESUB(s, pattern, replacement [, count])
+    //
+  case kwRESUB: {
+    char *s = NULL, *pattern = NULL, *repl = NULL;
+    var_int_t limit = 0;
+    par_massget("SSSi", &s, &pattern, &repl, &limit);
+    if (!prog_error) {
+      regex_sub(r, s, pattern, repl, limit);
+    }
+    pfree3(s, pattern, repl);
+  }
+    break;
+
   default:
     rt_raise("Unsupported built-in function call %ld", funcCode);
   };
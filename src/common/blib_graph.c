@@ -393,8 +393,7 @@ void cmd_drawpoly() {
     dev_setcolor(color);
 
   if (!filled) {
-    for (i = 1; i < count; i++)
-      dev_line(poly[i - 1].x, poly[i - 1].y, poly[i].x, poly[i].y);
+    dev_polyline(poly, count);
   } else
     dev_pfill(poly, count);
 
@@ -628,6 +627,92 @@ void cmd_paint() {
   dev_setcolor(prev_color);
 }
 
+/*
+ * clips the rectangle to the viewport, returns whether any part is visible
+ */
+static int pixels_clip(int x, int y, int w, int h, int *x1, int *y1, int *x2, int *y2) {
+  *x1 = x < dev_Vx1 ? dev_Vx1 : x;
+  *y1 = y < dev_Vy1 ? dev_Vy1 : y;
+  *x2 = x + w - 1 > dev_Vx2 ? dev_Vx2 : x + w - 1;
+  *y2 = y + h - 1 > dev_Vy2 ? dev_Vy2 : y + h - 1;
+  return (*x1 <= *x2 && *y1 <= *y2);
+}
+
+//
+//  GETPIXELS x, y, w, h, BYREF array
+//
+void cmd_getpixels() {
+  var_int_t x, y, w, h;
+  var_t *array;
+  par_massget("IIIIP", &x, &y, &w, &h, &array);
+  if (prog_error) {
+    return;
+  }
+  if (w < 1 || h < 1 || w > os_graf_mx || h > os_graf_my) {
+    // the matrix may not be larger than the screen
+    err_throw(ERR_PARAM);
+    return;
+  }
+
+  // pixels outside of the viewport are zero
+  v_tomatrix(array, h, w);
+  int x1, y1, x2, y2;
+  if (pixels_clip(x, y, w, h, &x1, &y1, &x2, &y2)) {
+    int cw = x2 - x1 + 1;
+    int ch = y2 - y1 + 1;
+    int *pixels = malloc(cw * ch * sizeof(int));
+    if (pixels == NULL) {
+      err_memory();
+      return;
+    }
+    dev_getpixels(x1, y1, cw, ch, pixels);
+    for (int j = 0; j < ch; j++) {
+      int row = (y1 - y + j) * w + (x1 - x);
+      for (int i = 0; i < cw; i++) {
+        v_setint(v_elem(array, row + i), pixels[j * cw + i]);
+      }
+    }
+    free(pixels);
+  }
+}
+
+//
+//  PUTPIXELS x, y, array
+//
+void cmd_putpixels() {
+  var_int_t x, y;
+  var_t *array;
+  par_massget("IIP", &x, &y, &array);
+  if (prog_error) {
+    return;
+  }
+  if (array->type != V_ARRAY || v_maxdim(array) != 2) {
+    err_throw(ERR_PARAM);
+    return;
+  }
+
+  int h = v_ubound(array, 0) - v_lbound(array, 0) + 1;
+  int w = v_ubound(array, 1) - v_lbound(array, 1) + 1;
+  int x1, y1, x2, y2;
+  if (pixels_clip(x, y, w, h, &x1, &y1, &x2, &y2)) {
+    int cw = x2 - x1 + 1;
+    int ch = y2 - y1 + 1;
+    int *pixels = malloc(cw * ch * sizeof(int));
+    if (pixels == NULL) {
+      err_memory();
+      return;
+    }
+    for (int j = 0; j < ch; j++) {
+      int row = (y1 - y + j) * w + (x1 - x);
+      for (int i = 0; i < cw; i++) {
+        pixels[j * cw + i] = v_getint(v_elem(array, row + i));
+      }
+    }
+    dev_setpixels(x1, y1, cw, ch, pixels);
+    free(pixels);
+  }
+}
+
 //
 char *draw_getval(const char *src, int *c) {
   char *p = (char *) src;
@@ -651,6 +736,47 @@ char *draw_getval(const char *src, int *c) {
   return p;
 }
 
+//
+// the connected lines of a DRAW string, drawn with a single polyline
+//
+typedef struct draw_path_t {
+  ipt_t *pts;
+  int count;
+  int size;
+} draw_path_t;
+
+static void draw_flush(draw_path_t *path) {
+  if (path->count > 1) {
+    dev_polyline(path->pts, path->count);
+  }
+  path->count = 0;
+}
+
+static void draw_line(draw_path_t *path, int x1, int y1, int x2, int y2) {
+  if (path->count &&
+      (path->pts[path->count - 1].x != x1 || path->pts[path->count - 1].y != y1)) {
+    // not joined to the previous line
+    draw_flush(path);
+  }
+  if (path->count + 2 > path->size) {
+    int size = path->size ? path->size * 2 : 32;
+    ipt_t *pts = (ipt_t *)realloc(path->pts, size * sizeof(ipt_t));
+    if (pts == NULL) {
+      draw_flush(path);
+      dev_line(x1, y1, x2, y2);
+      return;
+    }
+    path->pts = pts;
+    path->size = size;
+  }
+  if (!path->count) {
+    path->pts[path->count].x = x1;
+    path->pts[path->count++].y = y1;
+  }
+  path->pts[path->count].x = x2;
+  path->pts[path->count++].y = y2;
+}
+
 //
 //  DRAW "commands"
 //
@@ -660,6 +786,7 @@ void cmd_draw() {
   int32_t prev_color = dev_fgcolor;
   char *p;
   var_t var;
+  draw_path_t path = { NULL, 0, 0 };
 
   par_getstr(&var);
   if (prog_error) {
@@ -695,7 +822,7 @@ void cmd_draw() {
     case 'u':                  // up
       p = draw_getval(p, &y);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x, gra_y - y);
+        draw_line(&path, gra_x, gra_y, gra_x, gra_y - y);
       }
       if (update) {
         gra_y -= y;
@@ -705,7 +832,7 @@ void cmd_draw() {
     case 'd':                  // down
       p = draw_getval(p, &y);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x, gra_y + y);
+        draw_line(&path, gra_x, gra_y, gra_x, gra_y + y);
       }
       if (update) {
         gra_y += y;
@@ -715,7 +842,7 @@ void cmd_draw() {
     case 'l':                  // left
       p = draw_getval(p, &x);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x - x, gra_y);
+        draw_line(&path, gra_x, gra_y, gra_x - x, gra_y);
       }
       if (update) {
         gra_x -= x;
@@ -725,7 +852,7 @@ void cmd_draw() {
     case 'r':                  // right
       p = draw_getval(p, &x);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x + x, gra_y);
+        draw_line(&path, gra_x, gra_y, gra_x + x, gra_y);
       }
       if (update) {
         gra_x += x;
@@ -735,7 +862,7 @@ void cmd_draw() {
     case 'e':                  // up & right
       p = draw_getval(p, &x);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x + x, gra_y - x);
+        draw_line(&path, gra_x, gra_y, gra_x + x, gra_y - x);
       }
       if (update) {
         gra_x += x;
@@ -746,7 +873,7 @@ void cmd_draw() {
     case 'f':                  // down & right
       p = draw_getval(p, &x);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x + x, gra_y + x);
+        draw_line(&path, gra_x, gra_y, gra_x + x, gra_y + x);
       }
       if (update) {
         gra_x += x;
@@ -757,7 +884,7 @@ void cmd_draw() {
     case 'g':                  // down & left
       p = draw_getval(p, &x);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x - x, gra_y + x);
+        draw_line(&path, gra_x, gra_y, gra_x - x, gra_y + x);
       }
       if (update) {
         gra_x -= x;
@@ -768,7 +895,7 @@ void cmd_draw() {
     case 'h':                  // up & left
       p = draw_getval(p, &x);
       if (draw) {
-        dev_line(gra_x, gra_y, gra_x - x, gra_y - x);
+        draw_line(&path, gra_x, gra_y, gra_x - x, gra_y - x);
       }
       if (update) {
         gra_x -= x;
@@ -790,6 +917,8 @@ void cmd_draw() {
       p = draw_getval(p, &x);
       if (*p != ',') {
         rt_raise(ERR_DRAW_SEP);
+        draw_flush(&path);
+        free(path.pts);
         v_free(&var);
         return;
       } else {
@@ -801,14 +930,14 @@ void cmd_draw() {
 
       if (r) {
         if (draw)
-          dev_line(gra_x, gra_y, gra_x + x * r, gra_y + y * r);
+          draw_line(&path, gra_x, gra_y, gra_x + x * r, gra_y + y * r);
         if (update) {
           gra_x += x * r;
           gra_y += x * r;
         }
       } else {
         if (draw) {
-          dev_line(gra_x, gra_y, x, y);
+          draw_line(&path, gra_x, gra_y, x, y);
         }
         if (update) {
           gra_x = x;
@@ -819,6 +948,7 @@ void cmd_draw() {
     case 'C':
     case 'c':                  // color
       p = draw_getval(p, &x);
+      draw_flush(&path);
       dev_setcolor(x);
       continue;
       // Haraszti -- next case filter out the spaces or tabs and semicolons
@@ -830,12 +960,16 @@ void cmd_draw() {
       continue;
     default:
       rt_raise(ERR_DRAW_CMD, *p);
+      draw_flush(&path);
+      free(path.pts);
       v_free(&var);
       return;
     }
     p++;
   }
 
+  draw_flush(&path);
+  free(path.pts);
   dev_setcolor(prev_color);
   v_free(&var);
 }
@@ -902,7 +1036,7 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
 
   // ready
   dev_settextcolor(0, 15);
-  int *pts = (int *) malloc(sizeof(int) * count * 2);
+  ipt_t *pts = (ipt_t *) malloc(sizeof(ipt_t) * count);
 
   if (marks & 0x2) {
     // ruler
@@ -947,8 +1081,8 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
   for (int i = 0; i < count; i++) {
     int x = x1 + i * lx;
     int y = y1 + (dy - ((vals[i] - vmin) * ly));
-    pts[i * 2] = x > 0 ? x : 0;
-    pts[i * 2 + 1] = y > 0 ? y : 0;
+    pts[i].x = x > 0 ? x : 0;
+    pts[i].y = y > 0 ? y : 0;
   }
 
   // draw ruler
@@ -1054,12 +1188,10 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
     // points
     if (chart == 5) {
       for (int i = 0; i < count; i++) {
-        dev_setpixel(pts[i * 2], pts[i * 2 + 1]);
+        dev_setpixel(pts[i].x, pts[i].y);
       }
     } else {
-      for (int i = 1; i < count; i++) {
-        dev_line(pts[(i - 1) * 2], pts[(i - 1) * 2 + 1], pts[i * 2], pts[i * 2 + 1]);
-      }
+      dev_polyline(pts, count);
     }
 
     // draw marks
@@ -1069,8 +1201,8 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
 
         int fw = dev_textwidth(buf);
         int fh = dev_textheight(buf);
-        int mx = pts[i * 2] - fw / 2;
-        int my = pts[i * 2 + 1];
+        int mx = pts[i].x - fw / 2;
+        int my = pts[i].y;
 
         if (my > (y1 + (y2 - y1) / 2)) {
           my -= fh;
@@ -1083,8 +1215,8 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
         }
         dev_setxy(mx, my, 0);
         dev_print(buf);
-        dev_rect(pts[i * 2] - 2, pts[i * 2 + 1] - 2,
-                 pts[i * 2] + 2, pts[i * 2 + 1] + 2, 1);
+        dev_rect(pts[i].x - 2, pts[i].y - 2,
+                 pts[i].x + 2, pts[i].y + 2, 1);
       }
     }
     break;
@@ -1101,14 +1233,14 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
           color = 0;
         }
       }
-      dev_rect(pts[(i - 1) * 2], pts[(i - 1) * 2 + 1], pts[i * 2] - 2, y2, 1);
+      dev_rect(pts[i - 1].x, pts[i - 1].y, pts[i].x - 2, y2, 1);
     }
 
     if (os_color_depth > 2) {
       dev_setcolor(color);
     }
-    dev_rect(pts[(count - 1) * 2], pts[(count - 1) * 2 + 1],
-             pts[(count - 1) * 2] + lx - 1, y2, 1);
+    dev_rect(pts[count - 1].x, pts[count - 1].y,
+             pts[count - 1].x + lx - 1, y2, 1);
 
     // draw marks
     if (marks & 0x1) {
@@ -1118,8 +1250,8 @@ void chart_draw(int x1, int y1, int x2, int y2, var_num_t *vals, int count,
 
         int fw = dev_textwidth(buf);
         int fh = dev_textheight(buf);
-        int mx = pts[i * 2] + lx / 2 - fw / 2;
-        int my = pts[i * 2 + 1];
+        int mx = pts[i].x + lx / 2 - fw / 2;
+        int my = pts[i].y;
 
         if (os_color_depth > 2) {
           if (my - fh >= y1) {
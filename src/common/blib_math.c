@@ -226,7 +226,7 @@ var_num_t statmeandev(var_num_t *e, int count) {
 
   sum = 0.0;
   for (i = 0; i < count; i++) {
-    sum += fabsl(e[i] - mean);
+    sum += fabs(e[i] - mean);
   }
 
   return sum / count;
@@ -806,3 +806,54 @@ void cmd_diffeq() {
 
   code_jump(exit_ip);
 }
+
+/*
+ * RND - xoshiro256** by David Blackman and Sebastiano Vigna, the state is
+ * expanded from the seed with splitmix64
+ */
+static uint64_t rnd_state[4] = {
+  0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL, 0x2545f4914f6cdd1dULL
+};
+
+static inline uint64_t rnd_rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline var_num_t rnd_next_inline(void) {
+  uint64_t *s = rnd_state;
+  uint64_t result = rnd_rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rnd_rotl(s[3], 45);
+
+  // the upper 53 bits fill the mantissa
+  return (result >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void rnd_seed(uint64_t seed) {
+  for (int i = 0; i < 4; i++) {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    rnd_state[i] = z ^ (z >> 31);
+  }
+}
+
+var_num_t rnd_next() {
+  return rnd_next_inline();
+}
+
+void rnd_fill(var_t *data, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    var_t *var_p = &data[i];
+    if (var_p->type != V_NUM) {
+      v_free(var_p);
+      var_p->type = V_NUM;
+    }
+    var_p->v.n = rnd_next_inline();
+  }
+}
@@ -15,6 +15,7 @@
 #define _blib_math_h
 
 #include "common/sys.h"
+#include "common/var.h"
 
 var_num_t fint(var_num_t x);
 var_num_t frac(var_num_t x);
@@ -82,4 +83,33 @@ var_num_t statspreads(var_num_t *e, int count);
  */
 var_num_t statspreadp(var_num_t *e, int count);
 
+/**
+ * @ingroup math
+ *
+ * seeds the RND generator. the same seed produces the same sequence on
+ * every platform
+ *
+ * @param seed the seed
+ */
+void rnd_seed(uint64_t seed);
+
+/**
+ * @ingroup math
+ *
+ * returns the next random number
+ *
+ * @return a number from the range 0 to 1, excluding 1
+ */
+var_num_t rnd_next(void);
+
+/**
+ * @ingroup math
+ *
+ * stores the next count random numbers as V_NUM variables
+ *
+ * @param data the variables
+ * @param count the number of variables
+ */
+void rnd_fill(var_t *data, uint32_t count);
+
 #endif
@@ -25,14 +25,26 @@
 #include "common/device.h"
 #include "common/pproc.h"
 #include "common/keymap.h"
+#include "common/fs_async.h"
+#include "common/blib_math.h"
+#include "lib/match.h"
 
 int brun_create_task(const char *filename, byte *preloaded_bc, int libf);
 int exec_close_task();
+int exec_close(int tid);
 void sys_before_comp();
 
 static char fileName[OS_FILENAME_SIZE + 1];
 static stknode_t err_node;
 
+// SUB/FUNC frame slots, shared by all tasks. slots are allocated in fixed
+// chunks so that the tvar entries bound to them are never moved.
+#define FRAME_CHUNK_BITS 8
+#define FRAME_CHUNK_SIZE (1 << FRAME_CHUNK_BITS)
+static frame_slot_t **frame_chunks;
+static uint32_t frame_chunk_count;
+static uint32_t frame_top;
+
 #define EVT_CHECK_EVERY 50
 #define IF_ERR_BREAK if (prog_error) { \
   if (prog_error == errThrow)       \
@@ -45,22 +57,118 @@ void code_jump_label(uint16_t label_id) {
   prog_ip = tlab[label_id].ip;
 }
 
+/**
+ * Returns the number of nodes the program stack may grow to
+ */
+uint32_t code_stack_limit() {
+  return opt_stack_max ? opt_stack_max : SB_EXEC_STACK_MAX;
+}
+
+/**
+ * Doubles the program stack up to the limit. Returns 0 when the stack
+ * is full; nodes returned by code_push/code_stackpeek may be moved.
+ */
+static int code_stack_grow() {
+  uint32_t limit = code_stack_limit();
+  int result = 0;
+  if (prog_stack_alloc < limit) {
+    uint32_t size = prog_stack_alloc * 2;
+    if (size > limit) {
+      size = limit;
+    }
+    stknode_t *stack = realloc(prog_stack, sizeof(stknode_t) * size);
+    if (stack != NULL) {
+      prog_stack = stack;
+      prog_stack_alloc = size;
+      result = 1;
+    }
+  }
+  return result;
+}
+
 /**
  * Push a new node onto the stack
  */
 stknode_t *code_push(code_t type) {
   stknode_t *result;
-  if (prog_stack_count + 1 >= prog_stack_alloc) {
+  if (prog_stack_count + 1 >= prog_stack_alloc && !code_stack_grow()) {
     err_stackoverflow();
     result = &err_node;
   } else {
     result = &prog_stack[prog_stack_count++];
     result->type = type;
     result->line = prog_line;
+    if (prog_stack_count > prog_stack_peak) {
+      prog_stack_peak = prog_stack_count;
+    }
   }
   return result;
 }
 
+/**
+ * Appends a new slot to the frame stack
+ */
+frame_slot_t *code_frame_push() {
+  uint32_t chunk = frame_top >> FRAME_CHUNK_BITS;
+  if (chunk == frame_chunk_count) {
+    frame_chunks = realloc(frame_chunks, sizeof(frame_slot_t *) * (chunk + 1));
+    frame_chunks[chunk] = malloc(sizeof(frame_slot_t) * FRAME_CHUNK_SIZE);
+    frame_chunk_count++;
+  }
+  frame_slot_t *result = &frame_chunks[chunk][frame_top & (FRAME_CHUNK_SIZE - 1)];
+  frame_top++;
+  v_init(&result->var);
+  result->var.pooled = 0;
+  result->flags = 0;
+  return result;
+}
+
+frame_slot_t *code_frame_slot(uint32_t index) {
+  return &frame_chunks[index >> FRAME_CHUNK_BITS][index & (FRAME_CHUNK_SIZE - 1)];
+}
+
+uint32_t code_frame_top() {
+  return frame_top;
+}
+
+/**
+ * Releases the slots above base in reverse order
+ */
+void code_frame_release(uint32_t base) {
+  while (frame_top > base) {
+    frame_slot_t *slot = code_frame_slot(--frame_top);
+    if (slot->flags & FRAME_BOUND) {
+      *slot->bind = slot->prev;
+    }
+    v_free(&slot->var);
+  }
+}
+
+/**
+ * Releases the slots between base and from, the slots above are moved down
+ * to base
+ */
+void code_frame_shift(uint32_t base, uint32_t from) {
+  uint32_t top = frame_top;
+  frame_top = from;
+  code_frame_release(base);
+  for (uint32_t i = from; i < top; i++) {
+    *code_frame_slot(frame_top++) = *code_frame_slot(i);
+  }
+}
+
+/**
+ * Releases the frame stack memory once no calls are active
+ */
+static void code_frame_free() {
+  for (uint32_t i = 0; i < frame_chunk_count; i++) {
+    free(frame_chunks[i]);
+  }
+  free(frame_chunks);
+  frame_chunks = NULL;
+  frame_chunk_count = 0;
+}
+
 void free_node(stknode_t *node) {
   switch (node->type) {
   case kwTYPE_CRVAR:
@@ -72,17 +180,6 @@ void free_node(stknode_t *node) {
     }
     break;
 
-  case kwBYREF:
-    tvar[node->x.vdvar.vid] = node->x.vdvar.vptr;
-    break;
-
-  case kwTYPE_VAR:
-    if ((node->x.param.vcheck == 1) || (node->x.param.vcheck == 0x81)) {
-      v_free(node->x.param.res);
-      v_detach(node->x.param.res);
-    }
-    break;
-
   case kwTYPE_RET:
     v_free(node->x.vdvar.vptr); // free ret-var
     v_detach(node->x.vdvar.vptr);
@@ -90,6 +187,7 @@ void free_node(stknode_t *node) {
 
   case kwFUNC:
   case kwPROC:
+    code_frame_release(node->x.vcall.frame);
     if (node->x.vcall.rvid != INVALID_ADDR) {
       v_detach(tvar[node->x.vcall.rvid]);
       tvar[node->x.vcall.rvid] = node->x.vcall.retvar;
@@ -422,8 +520,7 @@ void cmd_chain(void) {
 
   bc_loop(0);
   success = prog_error;         // save tid_main status
-  exec_close_task();            // cleanup task data - tid_main
-  close_task(tid_main);         // cleanup task container
+  exec_close(tid_main);         // cleanup tid_main and the units it loaded
   close_task(tid_base);         // cleanup task container
   activate_task(tid_prev);      // resume calling task
 
@@ -528,6 +625,9 @@ static inline void bc_loop_call_proc() {
   case kwRANDOMIZE:
     cmd_randomize();
     break;
+  case kwRNDFILL:
+    cmd_rndfill();
+    break;
   case kwSPLIT:
     cmd_split();
     break;
@@ -549,6 +649,12 @@ static inline void bc_loop_call_proc() {
   case kwPAINT:
     cmd_paint();
     break;
+  case kwGETPIXELS:
+    cmd_getpixels();
+    break;
+  case kwPUTPIXELS:
+    cmd_putpixels();
+    break;
   case kwPLAY:
     cmd_play();
     break;
@@ -669,6 +775,9 @@ static inline void bc_loop_call_proc() {
   case kwTIMER:
     cmd_timer();
     break;
+  case kwADONE:
+    cmd_adone();
+    break;
   default:
     err_pcode_err(pcode);
   }
@@ -711,14 +820,7 @@ void bc_loop_goto() {
   prog_ip = next_ip;
 }
 
-/**
- * execute commands (loop)
- *
- * @param isf if 1, the program must return if found return (by level <= 0);
- * otherwise an RTE will generated
- * if 2; like 1, but increase the proc_level because UDF call executed internaly
- */
-void bc_loop(int isf) {
+static void bc_loop_exec(int isf) {
   byte pops;
   int i;
   int proc_level = 0;
@@ -764,9 +866,7 @@ void bc_loop(int isf) {
         inf_break(prog_line);
         break;
       default:
-        if (prog_timer) {
-          timer_run(now);
-        }
+        timer_run(now);
       };
     }
 
@@ -920,6 +1020,10 @@ void bc_loop(int isf) {
         }
         IF_ERR_BREAK;
         continue;
+      case kwTYPE_CALL_TAIL:
+        cmd_call_tail();
+        IF_ERR_BREAK;
+        continue;
       case kwTYPE_CALL_UDF:
         if (isf) {
           cmd_udp(kwFUNC);
@@ -1062,6 +1166,26 @@ void bc_loop(int isf) {
   }
 }
 
+/**
+ * execute commands (loop)
+ *
+ * @param isf if 1, the program must return if found return (by level <= 0);
+ * otherwise an RTE will generated
+ * if 2; like 1, but increase the proc_level because UDF call executed internaly
+ */
+void bc_loop(int isf) {
+  // functions called from expressions recurse on the C stack, which
+  // overflows long before the program stack
+  static int nested = 0;
+  if (isf && nested == SB_EXEC_NEST_MAX) {
+    err_stackoverflow();
+  } else {
+    nested += (isf != 0);
+    bc_loop_exec(isf);
+    nested -= (isf != 0);
+  }
+}
+
 /**
  * debug info
  * stack dump
@@ -1088,6 +1212,7 @@ void dump_stack() {
           break;
         }
       }
+      free_node(&node);
     } else {
       break;
     }
@@ -1112,22 +1237,10 @@ void brun_load_libraries(int tid) {
       prog_libtable[i].tid = lib_tid;
 
       // update lib-symbols's task-id field (in this code; not in lib's code)
+      // the export index is found by unit_bind on first use
       for (int j = 0; j < prog_symcount; j++) {
-        char *pname = strrchr(prog_symtable[j].symbol, '.') + 1;
-        // the name without the 'class'
         if ((prog_symtable[j].lib_id & (~UID_UNIT_BIT)) == prog_libtable[i].id) {
-          // find symbol by name (for sure) and update it
-          // this is required because lib may be newer than
-          // parent
-          for (int k = 0; k < taskinfo(lib_tid)->sbe.exec.expcount; k++) {
-            if (strcmp(pname, taskinfo(lib_tid)->sbe.exec.exptable[k].symbol) == 0) {
-              prog_symtable[j].exp_idx = k;
-              // adjust sid (sid is <-> exp_idx in lib)
-              prog_symtable[j].task_id = lib_tid;
-              // connect the library
-              break;
-            }
-          }
+          prog_symtable[j].task_id = lib_tid;
         }
       }
     } else {
@@ -1197,27 +1310,36 @@ int brun_create_task(const char *filename, byte *preloaded_bc, int libf) {
       panic("File '%s' not found", fname);
     }
     // look if it is already loaded
-    if (search_task(fname) != -1) {
-      return search_task(fname);
-    }
-    // open & load
-    int h = open(fname, O_RDWR | O_BINARY);
-    if (h == -1) {
-      panic("File '%s' not found", fname);
+    int loaded_tid = search_task(fname);
+    if (loaded_tid != -1) {
+      return loaded_tid;
     }
-    // load it
     if (libf) {
-      read(h, &uft, sizeof(unit_file_t));
-      lseek(h, sizeof(unit_sym_t) * uft.sym_count, SEEK_CUR);
-    }
-    read(h, &hdr, sizeof(bc_head_t));
-    if (hdr.sbver != SB_DWORD_VER) {
-      panic("File '%s' version incorrect", fname);
+      // units stay in memory, shared with the compiler and later runs
+      source = unit_image_load(fname);
+      if (source == NULL) {
+        panic("File '%s' not found", fname);
+      }
+      memcpy(&uft, source, sizeof(unit_file_t));
+      memcpy(&hdr, source + sizeof(unit_file_t) + sizeof(unit_sym_t) * uft.sym_count, sizeof(bc_head_t));
+      if (hdr.sbver != SB_DWORD_VER) {
+        panic("File '%s' version incorrect", fname);
+      }
+    } else {
+      // open & load
+      int h = open(fname, O_RDWR | O_BINARY);
+      if (h == -1) {
+        panic("File '%s' not found", fname);
+      }
+      read(h, &hdr, sizeof(bc_head_t));
+      if (hdr.sbver != SB_DWORD_VER) {
+        panic("File '%s' version incorrect", fname);
+      }
+      source = malloc(hdr.size + 4);
+      lseek(h, 0, SEEK_SET);
+      read(h, source, hdr.size);
+      close(h);
     }
-    source = malloc(hdr.size + 4);
-    lseek(h, 0, SEEK_SET);
-    read(h, source, hdr.size);
-    close(h);
   }
 
   // create task
@@ -1290,10 +1412,14 @@ int brun_create_task(const char *filename, byte *preloaded_bc, int libf) {
     }
   }
 
-  // create system stack
+  // create system stack, grown on demand up to code_stack_limit()
   prog_stack_alloc = SB_EXEC_STACK_SIZE;
+  if (prog_stack_alloc > code_stack_limit()) {
+    prog_stack_alloc = code_stack_limit();
+  }
   prog_stack = malloc(sizeof(stknode_t) * prog_stack_alloc);
   prog_stack_count = 0;
+  prog_stack_peak = 0;
   prog_timer = NULL;
 
   // create eval's stack
@@ -1332,6 +1458,9 @@ int exec_close_task() {
     eval_sp = 0;
 
     // clean up - prog stack
+    if (opt_verbose) {
+      log_printf(MSG_STACK_PEAK, ctask->file, prog_stack_peak, code_stack_limit());
+    }
     while (prog_stack_count > 0) {
       code_pop_and_free();
     }
@@ -1373,7 +1502,9 @@ int exec_close_task() {
     }
 
     // clean up - the rest
-    free(ctask->bytecode);
+    if (!unit_image_release(ctask->bytecode)) {
+      free(ctask->bytecode);
+    }
     ctask->bytecode = NULL;
 
     // cleanup the keyboard map
@@ -1382,6 +1513,9 @@ int exec_close_task() {
     // cleanup timers
     timer_free(prog_timer);
     prog_timer = NULL;
+
+    // cleanup asynchronous requests
+    async_close();
   }
 
   if (prog_error != errEnd && prog_error != errNone) {
@@ -1410,6 +1544,10 @@ int exec_close(int tid) {
   exec_close_task();
   close_task(tid);
   activate_task(prev_tid);
+  if (!frame_top) {
+    code_frame_free();
+  }
+  reg_match_close();
   return 1;
 }
 
@@ -1429,7 +1567,7 @@ void exec_sync_variables(int dir) {
   tid = ctask->tid;
 
   for (i = 0; i < prog_symcount; i++) {
-    if (prog_symtable[i].type == stt_variable) {
+    if (prog_symtable[i].type == stt_variable && unit_bind(i)) {
       ps = &prog_symtable[i];
       us = &(taskinfo(ps->task_id)->sbe.exec.exptable[ps->exp_idx]);
 
@@ -1671,7 +1809,7 @@ int sbasic_exec(const char *file) {
     int exec_tid = sbasic_exec_prepare(file);
 
     dev_init(opt_graphics, 0);  // initialize output device for graphics
-    srand(clock());             // randomize
+    rnd_seed(time(NULL) ^ clock()); // randomize
 
     // run
     sbasic_recursive_exec(exec_tid);
@@ -70,6 +70,37 @@ typedef struct {
  */
 void g_line(int x1, int y1, int x2, int y2, void (*dotproc) (int, int));
 
+/**
+ * @ingroup dev_g
+ *
+ * Midpoint ellipse, as drawn by ui::Graphics. For framebuffer drivers.
+ *
+ * @param xc the centre
+ * @param yc the centre
+ * @param rx the horizontal radius
+ * @param ry the vertical radius
+ * @param fill non-zero to fill with spans
+ * @param dotproc setpixel() function
+ * @param spanproc draws the horizontal line from x1 to x2 at y
+ */
+void g_ellipse(int xc, int yc, int rx, int ry, int fill,
+               void (*dotproc)(int, int), void (*spanproc)(int x1, int x2, int y));
+
+/**
+ * @ingroup dev_g
+ *
+ * returns the colour as 0xRRGGBB. negative values are RGB, others are
+ * the 16 colours below
+ */
+uint32_t g_rgb(long c);
+
+/**
+ * @ingroup dev_g
+ *
+ * returns the colour as a pixel with the r, g, b, a byte order expected by lodepng
+ */
+uint32_t g_rgba(long c);
+
 /*
  *
  * colors - VGA16 compatible
@@ -158,6 +189,12 @@ extern long dev_bgcolor;
 
 #endif
 
+// world to device coordinates, and back
+#define W2X(x) (((((x) - dev_Wx1) * dev_Vdx) / dev_Wdx) + dev_Vx1)
+#define W2Y(y) (((((y) - dev_Wy1) * dev_Vdy) / dev_Wdy) + dev_Vy1)
+#define X2W(x) (((((x) - dev_Vx1) * dev_Wdx) / dev_Vdx) + dev_Wx1)
+#define Y2W(y) (((((y) - dev_Vy1) * dev_Wdy) / dev_Vdy) + dev_Wy1)
+
 /*
  *
  * Driver basics
@@ -510,6 +547,36 @@ void dev_setpixel(int x, int y);
  */
 long dev_getpixel(int x, int y);
 
+/**
+ * @ingroup dev_g
+ *
+ * Copies a rectangle of pixels, in device coordinates, into the buffer
+ * row after row, with the values returned by dev_getpixel. Drivers without
+ * a pixel buffer are read one pixel at a time.
+ *
+ * @param x the left position
+ * @param y the top position
+ * @param w the width
+ * @param h the height
+ * @param pixels the buffer of w * h values
+ */
+void dev_getpixels(int x, int y, int w, int h, int *pixels);
+
+/**
+ * @ingroup dev_g
+ *
+ * Draws a rectangle of pixels, in device coordinates, from the buffer
+ * row after row. The values are colors as given to dev_setcolor. Drivers
+ * without a pixel buffer are drawn one pixel at a time.
+ *
+ * @param x the left position
+ * @param y the top position
+ * @param w the width
+ * @param h the height
+ * @param pixels the buffer of w * h values
+ */
+void dev_setpixels(int x, int y, int w, int h, const int *pixels);
+
 /**
  * @ingroup dev_g
  *
@@ -535,6 +602,17 @@ void dev_clipline(int *x1, int *y1, int *x2, int *y2, int *visible);
  */
 void dev_line(int x1, int y1, int x2, int y2);
 
+/**
+ * @ingroup dev_g
+ *
+ * draw the lines joining the points. the visible parts are passed to the
+ * driver as a single call where possible
+ *
+ * @param pts is a table of points
+ * @param count is the number of the points to use
+ */
+void dev_polyline(const ipt_t *pts, int count);
+
 /**
  * @ingroup dev_g
  *
@@ -784,7 +862,7 @@ typedef enum {
   ft_stream,          /**< simple file */
   ft_serial_port,     /**< COMx:speed, serial port */
   ft_socket_client,   /**< SCLT:address:port, socket client */
-  ft_socket_server,   // SSVR:address:port
+  ft_socket_server,   /**< SSVR:port, non-blocking multi-client listener */
   ft_http_client
 } dev_ftype_t;
 
@@ -809,6 +887,16 @@ typedef struct {
   int open_flags;     /**< the open()'s flags */
 } dev_file_t;
 
+/**
+ * @ingroup dev_f
+ * @typedef dev_fview_t read-only view of a block of file data
+ */
+typedef struct {
+  byte *data;         /**< the requested bytes */
+  void *base;         /**< the mapping or heap block holding data */
+  size_t length;      /**< the mapping length, zero when base is a heap block */
+} dev_fview_t;
+
 // flags for dev_fopen()
 #define DEV_FILE_INPUT    1 /**< dev_fopen() flags, open file for input (read-only)     @ingroup dev_f */
 #define DEV_FILE_OUTPUT   2 /**< dev_fopen() flags, open file for output (create)     @ingroup dev_f */
@@ -929,6 +1017,52 @@ int dev_fwrite(int SBHandle, byte *buff, uint32_t size);
  */
 int dev_fread(int SBHandle, byte *buff, uint32_t size);
 
+/**
+ * @ingroup dev_f
+ *
+ * accepts a pending client connection of an SSVR listener
+ *
+ * @param SBHandle is the RTL's file-handle of the listener
+ * @return the file-handle of the new client, or 0 when none is pending
+ */
+int dev_faccept(int SBHandle);
+
+/**
+ * @ingroup dev_f
+ *
+ * waits until any of the SOCL or SSVR files are readable
+ *
+ * @param handles the RTL's file-handles
+ * @param count the number of handles
+ * @param timeout the milliseconds to wait, -1 to wait indefinitely
+ * @param ready receives non-zero for each readable file
+ * @return the number of readable files
+ */
+int dev_fpoll(const int *handles, int count, int timeout, int *ready);
+
+/**
+ * @ingroup dev_f
+ *
+ * returns a read-only view of the next size bytes from the file and
+ * advances the file-position-pointer. large blocks from regular files
+ * are memory mapped, otherwise the data is read into a heap block
+ *
+ * @param SBHandle is the RTL's file-handle
+ * @param size is the number of bytes to view
+ * @param view receives the data
+ * @return non-zero on success
+ */
+int dev_fmap(int SBHandle, uint32_t size, dev_fview_t *view);
+
+/**
+ * @ingroup dev_f
+ *
+ * releases a view obtained with dev_fmap
+ *
+ * @param view the view to release
+ */
+void dev_funmap(dev_fview_t *view);
+
 /**
  * @ingroup dev_f
  *
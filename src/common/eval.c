@@ -628,15 +628,16 @@ static inline void oper_cmp(var_t *r, var_t *left) {
       }
     } else if (r->type == V_STR) {
       if (v_is_type(left, V_STR)) {
-        if (left->v.p.ptr[0] != '\0') {
-          ri = (strstr(r->v.p.ptr, left->v.p.ptr) != NULL);
+        int len = v_strlen(left);
+        if (len) {
+          ri = (str_find(r->v.p.ptr, v_strlen(r), left->v.p.ptr, len, 0) != NULL);
         } else {
           ri = 0;
         }
       } else if (v_is_type(left, V_NUM) || v_is_type(left, V_INT)) {
         var_t *v = v_clone(left);
         v_tostr(v);
-        ri = (strstr(r->v.p.ptr, v->v.p.ptr) != NULL);
+        ri = (str_find(r->v.p.ptr, v_strlen(r), v->v.p.ptr, v_strlen(v), 0) != NULL);
         V_FREE(v);
         v_detach(v);
       }
@@ -793,12 +794,13 @@ static inline void eval_push(var_t *r) {
     eval_stk[eval_sp].v.n = r->v.n;
     break;
   case V_STR:
-    len = r->v.p.length;
+    len = v_strlen(r);
     eval_stk[eval_sp].type = V_STR;
     eval_stk[eval_sp].v.p.ptr = malloc(len + 1);
     eval_stk[eval_sp].v.p.owner = 1;
-    strcpy(eval_stk[eval_sp].v.p.ptr, r->v.p.ptr);
-    eval_stk[eval_sp].v.p.length = len;
+    memcpy(eval_stk[eval_sp].v.p.ptr, r->v.p.ptr, len);
+    eval_stk[eval_sp].v.p.ptr[len] = '\0';
+    eval_stk[eval_sp].v.p.length = len + 1;
     break;
   default:
     v_set(&eval_stk[eval_sp], r);
@@ -1201,6 +1203,17 @@ static inline void eval_callf(var_t *r) {
   case kwIMAGE:
   case kwFORM:
   case kwWINDOW:
+  case kwACCEPT:
+  case kwPOLL:
+  case kwDIRWALKF:
+  case kwAREAD:
+  case kwAWRITE:
+  case kwATLOAD:
+  case kwADONE:
+  case kwAWAIT:
+  case kwREMATCH:
+  case kwREMATCHALL:
+  case kwRESUB:
     eval_callf_genfunc(fcode, r);
     break;
   case kwTICKS:
@@ -449,9 +449,10 @@ void slib_close() {
 }
 
 /**
- * build parameter table
+ * build parameter table. variables are passed by reference, expressions
+ * are evaluated into the caller's args storage
  */
-int slib_build_ptable(slib_par_t *ptable) {
+int slib_build_ptable(slib_par_t *ptable, var_t *args) {
   int pcount = 0;
   var_t *arg;
   bcip_t ofs;
@@ -487,7 +488,8 @@ int slib_build_ptable(slib_par_t *ptable) {
         // no 'break' here
       default:
         // default --- expression (BYVAL ONLY)
-        arg = v_new();
+        arg = &args[pcount];
+        v_init(arg);
         eval(arg);
         if (!prog_error) {
           // push parameter
@@ -496,7 +498,6 @@ int slib_build_ptable(slib_par_t *ptable) {
           pcount++;
         } else {
           v_free(arg);
-          v_detach(arg);
           return pcount;
         }
       }
@@ -517,7 +518,6 @@ void slib_free_ptable(slib_par_t *ptable, int pcount) {
   for (int i = 0; i < pcount; i++) {
     if (ptable[i].byref == 0) {
       v_free(ptable[i].var_p);
-      v_detach(ptable[i].var_p);
     }
   }
 }
@@ -526,18 +526,12 @@ void slib_free_ptable(slib_par_t *ptable, int pcount) {
  * execute a function or procedure
  */
 int slib_exec(slib_t *lib, var_t *ret, int index, int proc) {
-  slib_par_t *ptable;
-  int pcount;
-  if (code_peek() == kwTYPE_LEVEL_BEGIN) {
-    ptable = (slib_par_t *)malloc(sizeof(slib_par_t) * MAX_PARAM);
-    pcount = slib_build_ptable(ptable);
-  } else {
-    ptable = NULL;
-    pcount = 0;
-  }
+  // no allocations for the tables: chatty calls in loops are common
+  slib_par_t ptable[MAX_PARAM];
+  var_t args[MAX_PARAM];
+  int pcount = slib_build_ptable(ptable, args);
   if (prog_error) {
     slib_free_ptable(ptable, pcount);
-    free(ptable);
     return 0;
   }
 
@@ -558,12 +552,8 @@ int slib_exec(slib_t *lib, var_t *ret, int index, int proc) {
     }
   }
 
-  // clean-up
-  if (ptable) {
-    slib_free_ptable(ptable, pcount);
-    free(ptable);
-  }
-
+  // clean-up, temporaries moved into ret by the module are now empty
+  slib_free_ptable(ptable, pcount);
   return success;
 }
 
@@ -26,11 +26,18 @@
 #include "common/fs_stream.h"
 #include "common/fs_serial.h"
 #include "common/fs_socket_client.h"
+#include "common/inet.h"
 #include "lib/match.h"
 
 // FILE TABLE
 static dev_file_t file_table[OS_FILEHANDLES];
 
+// smallest block worth memory mapping in dev_fmap
+#define FILE_MAP_MIN 0x10000
+
+// milliseconds between event checks in dev_fpoll
+#define POLL_SLICE 250
+
 /**
  * Basic wild-cards
  */
@@ -67,6 +74,7 @@ void dev_closefs() {
       dev_fclose(i + 1);
     }
   }
+  http_close_pool();
 }
 
 /**
@@ -187,6 +195,8 @@ int dev_fopen(int sb_handle, const char *name, int flags) {
 #endif
       } else if (strncmp(f->name, "SOCL:", 5) == 0) {
         f->type = ft_socket_client;
+      } else if (strncmp(f->name, "SSVR:", 5) == 0) {
+        f->type = ft_socket_server;
       } else if (strncasecmp(f->name, "HTTP:", 5) == 0) {
         f->type = ft_http_client;
       } else if (strncmp(f->name, "SOUT:", 5) == 0 ||
@@ -222,6 +232,8 @@ int dev_fopen(int sb_handle, const char *name, int flags) {
     return stream_open(f);
   case ft_socket_client:
     return sockcl_open(f);
+  case ft_socket_server:
+    return sockcl_listen(f);
   case ft_http_client:
     return http_open(f);
   case ft_serial_port:
@@ -249,8 +261,10 @@ int dev_fclose(int sb_handle) {
   case ft_serial_port:
     return serial_close(f);
   case ft_socket_client:
-  case ft_http_client:
+  case ft_socket_server:
     return sockcl_close(f);
+  case ft_http_client:
+    return http_close(f);
   default:
     err_unsup();
   }
@@ -305,6 +319,108 @@ int dev_fread(int sb_handle, byte *data, uint32_t size) {
   return 0;
 }
 
+/**
+ * accepts a pending client of an SSVR listener into a free file handle
+ */
+int dev_faccept(int sb_handle) {
+  dev_file_t *f;
+
+  if ((f = dev_getfileptr(sb_handle)) == NULL) {
+    return 0;
+  }
+  if (f->type != ft_socket_server) {
+    rt_raise(ERR_NOT_SERVER);
+    return 0;
+  }
+
+  int handle = dev_freefilehandle();
+  if (handle == -1) {
+    return 0;
+  }
+  dev_file_t *client = dev_getfileptr(handle);
+  memset(client, 0, sizeof(dev_file_t));
+  client->handle = -1;
+  client->open_flags = DEV_FILE_INPUT | DEV_FILE_OUTPUT;
+  return sockcl_accept(f, client) ? handle : 0;
+}
+
+/**
+ * waits for any of the socket handles to become readable
+ */
+int dev_fpoll(const int *handles, int count, int timeout, int *ready) {
+  socket_t *socks = malloc(sizeof(socket_t) * (count ? count : 1));
+  int result = 0;
+
+  for (int i = 0; i < count; i++) {
+    dev_file_t *f = dev_getfileptr(handles[i]);
+    if (f == NULL) {
+      free(socks);
+      return 0;
+    }
+    if (f->type != ft_socket_client && f->type != ft_socket_server) {
+      rt_raise(ERR_NOT_SOCKET);
+      free(socks);
+      return 0;
+    }
+    socks[i] = (socket_t) f->handle;
+  }
+
+  // wait in slices to allow the program to break
+  while (count) {
+    int slice = (timeout < 0 || timeout > POLL_SLICE) ? POLL_SLICE : timeout;
+    result = net_poll(socks, count, slice, ready);
+    if (result != 0) {
+      break;
+    }
+    if (timeout >= 0 && (timeout -= slice) <= 0) {
+      break;
+    }
+    if (dev_events(0) != 0) {
+      break;
+    }
+  }
+  free(socks);
+  return result < 0 ? 0 : result;
+}
+
+/**
+ * returns a read-only view of the next size bytes
+ */
+int dev_fmap(int sb_handle, uint32_t size, dev_fview_t *view) {
+  dev_file_t *f;
+
+  if ((f = dev_getfileptr(sb_handle)) == NULL) {
+    return 0;
+  }
+
+  if (f->type == ft_stream && size >= FILE_MAP_MIN && stream_map(f, size, view)) {
+    return 1;
+  }
+
+  // small blocks or devices: read into a heap block
+  view->base = view->data = malloc(size ? size : 1);
+  view->length = 0;
+  if (!dev_fread(sb_handle, view->data, size)) {
+    free(view->base);
+    view->base = view->data = NULL;
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * releases the view created with dev_fmap
+ */
+void dev_funmap(dev_fview_t *view) {
+  if (view->length) {
+    stream_unmap(view);
+  } else {
+    free(view->base);
+  }
+  view->base = view->data = NULL;
+  view->length = 0;
+}
+
 /**
  *
  */
@@ -0,0 +1,405 @@
+// This file is part of SmallBASIC
+//
+// asynchronous file i/o, serviced by a pool of worker threads
+//
+// Workers only see the request structure: the file name and data are
+// copied on submit and the result is converted to a variable by the
+// interpreter thread in async_result.
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#include "common/sys.h"
+#include "common/smbas.h"
+#include "common/device.h"
+#include "common/pproc.h"
+#include "common/messages.h"
+#include "common/threads.h"
+#include "common/fs_async.h"
+
+#include <errno.h>
+
+#define ASYNC_WORKERS 2
+#define ASYNC_SLICE   50
+#define ASYNC_BUFFER  0x10000
+
+typedef enum {
+  async_queued,
+  async_running,
+  async_complete
+} async_state_t;
+
+typedef struct async_request {
+  struct async_request *next;
+  char *file;
+  char *alt_file;    // file relative to the program folder
+  char *data;        // data to write, or the data read
+  uint32_t length;
+  int handle;
+  int error;         // errno of the failed operation
+  int notified;      // whether the handler was invoked
+  bcip_t ip;         // completion handler
+  async_op_t op;
+  async_state_t state;
+} async_request;
+
+static async_request *async_head;
+static async_request *async_tail;
+static thread_lock_t *async_lock;
+static thread_t *async_threads[ASYNC_WORKERS];
+static int async_threads_count;
+static int async_handles;
+static int async_stop;
+
+/*
+ * opens the request file, trying the program folder when not found
+ */
+static int async_open(async_request *req, int flags) {
+  int result = open(req->file, flags, S_IRUSR | S_IWUSR);
+  if (result < 0 && req->alt_file != NULL) {
+    result = open(req->alt_file, flags, S_IRUSR | S_IWUSR);
+  }
+  if (result < 0) {
+    req->error = errno;
+  }
+  return result;
+}
+
+static void async_do_read(async_request *req) {
+  int fd = async_open(req, O_RDONLY | O_BINARY);
+  if (fd >= 0) {
+    struct stat st;
+    uint32_t size = (fstat(fd, &st) == 0 && st.st_size > 0) ? st.st_size : ASYNC_BUFFER;
+    uint32_t length = 0;
+    char *data = malloc(size + 1);
+    while (data != NULL) {
+      if (length == size) {
+        // grown since fstat, or not a regular file
+        size += ASYNC_BUFFER;
+        char *next = realloc(data, size + 1);
+        if (next == NULL) {
+          free(data);
+          data = NULL;
+          req->error = ENOMEM;
+          break;
+        }
+        data = next;
+      }
+      ssize_t n = read(fd, data + length, size - length);
+      if (n < 0) {
+        if (errno != EINTR) {
+          req->error = errno;
+          free(data);
+          data = NULL;
+        }
+      } else if (n == 0) {
+        break;
+      } else {
+        length += n;
+      }
+    }
+    if (data != NULL) {
+      data[length] = '\0';
+      req->data = data;
+      req->length = length;
+    } else if (!req->error) {
+      req->error = ENOMEM;
+    }
+    close(fd);
+  }
+}
+
+static void async_do_write(async_request *req) {
+  int flags = O_CREAT | O_WRONLY | O_BINARY;
+  flags |= (req->op == async_append) ? O_APPEND : O_TRUNC;
+  int fd = async_open(req, flags);
+  if (fd >= 0) {
+    uint32_t offset = 0;
+    while (offset < req->length) {
+      ssize_t n = write(fd, req->data + offset, req->length - offset);
+      if (n < 0) {
+        if (errno != EINTR) {
+          req->error = errno;
+          break;
+        }
+      } else {
+        offset += n;
+      }
+    }
+    if (close(fd) != 0 && !req->error) {
+      req->error = errno;
+    }
+    free(req->data);
+    req->data = NULL;
+    req->length = offset;
+  }
+}
+
+/*
+ * performs the request, called without the lock held
+ */
+static void async_perform(async_request *req) {
+  switch (req->op) {
+  case async_read:
+  case async_lines:
+    async_do_read(req);
+    break;
+  case async_write:
+  case async_append:
+    async_do_write(req);
+    break;
+  }
+}
+
+/*
+ * worker thread: runs queued requests in submission order
+ */
+static void async_worker(void *data) {
+  thread_lock(async_lock);
+  while (!async_stop) {
+    async_request *req = async_head;
+    while (req != NULL && req->state != async_queued) {
+      req = req->next;
+    }
+    if (req == NULL) {
+      thread_wait(async_lock, -1);
+    } else {
+      req->state = async_running;
+      thread_unlock(async_lock);
+      async_perform(req);
+      thread_lock(async_lock);
+      req->state = async_complete;
+      thread_notify(async_lock);
+    }
+  }
+  thread_unlock(async_lock);
+}
+
+/*
+ * starts the workers on first use, returns whether any are running
+ */
+static int async_start() {
+  if (async_lock == NULL) {
+    async_lock = thread_lock_create();
+    async_stop = 0;
+    async_threads_count = 0;
+    for (int i = 0; i < ASYNC_WORKERS; i++) {
+      thread_t *thread = thread_start(async_worker, NULL);
+      if (thread != NULL) {
+        async_threads[async_threads_count++] = thread;
+      }
+    }
+  }
+  return async_threads_count;
+}
+
+/*
+ * returns the request with the given handle, called with the lock held
+ */
+static async_request *async_find(int handle) {
+  async_request *result = async_head;
+  while (result != NULL && result->handle != handle) {
+    result = result->next;
+  }
+  return result;
+}
+
+static void async_free(async_request *req) {
+  free(req->file);
+  free(req->alt_file);
+  free(req->data);
+  free(req);
+}
+
+int async_submit(async_op_t op, const char *file, const char *data, uint32_t length) {
+  async_request *req = calloc(1, sizeof(async_request));
+  req->file = strdup(file);
+#if defined(_UnixOS)
+  if (gsb_bas_dir[0]) {
+    req->alt_file = malloc(strlen(gsb_bas_dir) + strlen(file) + 1);
+    strcpy(req->alt_file, gsb_bas_dir);
+    strcat(req->alt_file, file);
+  }
+#endif
+  if (data != NULL) {
+    req->data = malloc(length + 1);
+    memcpy(req->data, data, length);
+    req->length = length;
+  }
+  req->op = op;
+  req->ip = INVALID_ADDR;
+  req->handle = ++async_handles;
+  req->state = async_queued;
+
+  if (!async_start()) {
+    // no threads: complete the request now
+    async_perform(req);
+    req->state = async_complete;
+  }
+
+  thread_lock(async_lock);
+  if (async_tail != NULL) {
+    async_tail->next = req;
+  } else {
+    async_head = req;
+  }
+  async_tail = req;
+  thread_notify(async_lock);
+  thread_unlock(async_lock);
+  return req->handle;
+}
+
+int async_done(int handle) {
+  int result = -1;
+  if (async_lock != NULL) {
+    thread_lock(async_lock);
+    async_request *req = async_find(handle);
+    if (req != NULL) {
+      result = (req->state == async_complete);
+    }
+    thread_unlock(async_lock);
+  }
+  return result;
+}
+
+int async_wait(int handle) {
+  int result = async_done(handle);
+  while (result == 0) {
+    thread_lock(async_lock);
+    async_request *req = async_find(handle);
+    if (req != NULL && req->state != async_complete) {
+      thread_wait(async_lock, ASYNC_SLICE);
+    }
+    thread_unlock(async_lock);
+    result = async_done(handle);
+    if (result == 0 && dev_events(0) != 0) {
+      break;
+    }
+  }
+  return result == 1;
+}
+
+void async_result(int handle, var_t *result) {
+  async_request *req = NULL;
+  if (async_lock != NULL) {
+    thread_lock(async_lock);
+    async_request *prev = NULL;
+    req = async_head;
+    while (req != NULL && req->handle != handle) {
+      prev = req;
+      req = req->next;
+    }
+    if (req != NULL && req->state == async_complete) {
+      if (prev != NULL) {
+        prev->next = req->next;
+      } else {
+        async_head = req->next;
+      }
+      if (async_tail == req) {
+        async_tail = prev;
+      }
+    } else {
+      req = NULL;
+    }
+    thread_unlock(async_lock);
+  }
+
+  v_free(result);
+  if (req == NULL) {
+    rt_raise(ERR_ASYNC_HANDLE, handle);
+  } else if (req->error) {
+    err_file(req->error);
+  } else if (req->op == async_read) {
+    // the buffer becomes the string
+    result->type = V_STR;
+    result->v.p.ptr = req->data;
+    result->v.p.length = req->length + 1;
+    result->v.p.owner = 1;
+    req->data = NULL;
+  } else if (req->op == async_lines) {
+    // split as TLOAD: lines end with \n, any \r is dropped
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < req->length; i++) {
+      if (req->data[i] == '\n') {
+        count++;
+      }
+    }
+    v_toarray1(result, req->length ? count + 1 : 0);
+    const char *line = req->data;
+    const char *end = req->data + req->length;
+    for (uint32_t i = 0; req->length && i <= count; i++) {
+      const char *eol = memchr(line, '\n', end - line);
+      if (eol == NULL) {
+        eol = end;
+      }
+      var_t *elem = v_elem(result, i);
+      v_init_str(elem, eol - line);
+      int len = 0;
+      for (const char *p = line; p < eol; p++) {
+        if (*p != '\r') {
+          elem->v.p.ptr[len++] = *p;
+        }
+      }
+      elem->v.p.ptr[len] = '\0';
+      elem->v.p.length = len + 1;
+      line = eol + 1;
+    }
+  } else {
+    v_setint(result, req->length);
+  }
+  if (req != NULL) {
+    async_free(req);
+  }
+}
+
+int async_set_handler(int handle, bcip_t ip) {
+  int result = 0;
+  if (async_lock != NULL) {
+    thread_lock(async_lock);
+    async_request *req = async_find(handle);
+    if (req != NULL) {
+      req->ip = ip;
+      req->notified = 0;
+      result = 1;
+    }
+    thread_unlock(async_lock);
+  }
+  return result;
+}
+
+bcip_t async_next_handler() {
+  bcip_t result = INVALID_ADDR;
+  if (async_lock != NULL) {
+    thread_lock(async_lock);
+    for (async_request *req = async_head; req != NULL; req = req->next) {
+      if (req->state == async_complete && req->ip != INVALID_ADDR && !req->notified) {
+        req->notified = 1;
+        result = req->ip;
+        break;
+      }
+    }
+    thread_unlock(async_lock);
+  }
+  return result;
+}
+
+void async_close() {
+  if (async_lock != NULL) {
+    thread_lock(async_lock);
+    async_stop = 1;
+    thread_notify(async_lock);
+    thread_unlock(async_lock);
+    for (int i = 0; i < async_threads_count; i++) {
+      thread_join(async_threads[i]);
+    }
+    async_threads_count = 0;
+    while (async_head != NULL) {
+      async_request *next = async_head->next;
+      async_free(async_head);
+      async_head = next;
+    }
+    async_tail = NULL;
+    thread_lock_destroy(async_lock);
+    async_lock = NULL;
+  }
+}
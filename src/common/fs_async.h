@@ -0,0 +1,67 @@
+// This file is part of SmallBASIC
+//
+// asynchronous file i/o, serviced by a pool of worker threads
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#if !defined(_sbfs_async_h)
+#define _sbfs_async_h
+
+#include "common/sys.h"
+#include "common/var.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum {
+  async_read,   // whole file into a string
+  async_lines,  // whole file into an array of lines (as TLOAD)
+  async_write,  // string into a new file
+  async_append  // string appended to a file
+} async_op_t;
+
+/**
+ * queues a request, returns its handle
+ */
+int async_submit(async_op_t op, const char *file, const char *data, uint32_t length);
+
+/**
+ * returns 1 when the request has completed, 0 when it is still in
+ * progress, or -1 when the handle is unknown
+ */
+int async_done(int handle);
+
+/**
+ * waits for the request to complete while servicing events. returns
+ * whether the request completed
+ */
+int async_wait(int handle);
+
+/**
+ * stores the result of a completed request and releases the handle. i/o
+ * errors are raised here, on the interpreter thread
+ */
+void async_result(int handle, var_t *result);
+
+/**
+ * sets the SUB invoked from timer_run once the request completes
+ */
+int async_set_handler(int handle, bcip_t ip);
+
+/**
+ * returns the handler of a newly completed request or INVALID_ADDR
+ */
+bcip_t async_next_handler(void);
+
+/**
+ * stops the workers and releases all requests
+ */
+void async_close(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -39,10 +39,154 @@ int sockcl_open(dev_file_t *f) {
   return 1;
 }
 
+// drv_dw[3] flags a client accepted from an SSVR listener
+#define SOCL_ACCEPTED 3
+
+// open "SSVR:8080" as #1
+int sockcl_listen(dev_file_t *f) {
+  int port = xstrtol(f->name + 5);
+  f->handle = (int) net_server(port);
+  if (f->handle <= 0) {
+    // eg the port is already in use
+    f->handle = -1;
+    err_file(errno);
+    return 0;
+  }
+  f->drv_dw[0] = 1;
+  return 1;
+}
+
+// accept a pending client from an SSVR listener into the given file
+int sockcl_accept(dev_file_t *listener, dev_file_t *f) {
+  socket_t s = net_accept((socket_t) listener->handle);
+  if (s == -1) {
+    return 0;
+  }
+  f->type = ft_socket_client;
+  f->handle = (int) s;
+  f->drv_dw[0] = 1;
+  f->drv_dw[SOCL_ACCEPTED] = 1;
+  strlcpy(f->name, listener->name, sizeof(f->name));
+  return 1;
+}
+
+#define HTTP_POOL_SIZE     8
+#define HTTP_BUFFER_SIZE   0x4000
+#define HTTP_LINE_MAX      0x2000
+#define HTTP_MAX_REDIRECTS 8
+#define HTTP_HOST_SIZE     250
+
+// an idle keep-alive connection
+typedef struct http_conn {
+  char host[HTTP_HOST_SIZE];
+  int port;
+  socket_t sock;
+} http_conn;
+
+// per handle state held in dev_file_t.drv_data
+typedef struct http_state {
+  char host[HTTP_HOST_SIZE];
+  char *path;
+  int reused;
+  int reusable;
+  int len;
+  int pos;
+  char buffer[HTTP_BUFFER_SIZE];
+} http_state;
+
+// receives the response body
+typedef struct http_sink {
+  var_t *var;
+  uint32_t capacity;
+  int handle;
+} http_sink;
+
+static http_conn http_pool[HTTP_POOL_SIZE];
+static int http_pool_count = 0;
+
+/*
+ * returns an idle connection to the given host, or -1
+ */
+static socket_t http_pool_get(const char *host, int port) {
+  socket_t result = -1;
+  for (int i = http_pool_count - 1; i >= 0 && result == -1; i--) {
+    if (http_pool[i].port == port && strcasecmp(http_pool[i].host, host) == 0) {
+      socket_t s = http_pool[i].sock;
+      http_pool[i] = http_pool[--http_pool_count];
+      if (net_idle(s)) {
+        result = s;
+      } else {
+        // closed by the server while idle
+        net_disconnect(s);
+      }
+    }
+  }
+  return result;
+}
+
+/*
+ * keeps the connection for reuse, evicting the oldest when full
+ */
+static void http_pool_put(const char *host, int port, socket_t s) {
+  if (http_pool_count == HTTP_POOL_SIZE) {
+    net_disconnect(http_pool[0].sock);
+    memmove(http_pool, http_pool + 1, sizeof(http_conn) * (HTTP_POOL_SIZE - 1));
+    http_pool_count--;
+  }
+  http_conn *conn = &http_pool[http_pool_count++];
+  strlcpy(conn->host, host, sizeof(conn->host));
+  conn->port = port;
+  conn->sock = s;
+}
+
+/*
+ * closes all idle keep-alive connections
+ */
+void http_close_pool() {
+  for (int i = 0; i < http_pool_count; i++) {
+    net_disconnect(http_pool[i].sock);
+  }
+  http_pool_count = 0;
+}
+
+static void http_send_request(dev_file_t *f, http_state *st) {
+  char txbuf[1024];
+  snprintf(txbuf, sizeof(txbuf), "GET %s HTTP/1.1\r\n"
+           "Host: %s\r\n"
+           "Accept: */*\r\n"
+           "Accept-Language: en-au\r\n"
+           "Connection: keep-alive\r\n"
+           "User-Agent: SmallBASIC\r\n", st->path, st->host);
+  if (f->drv_dw[2]) {
+    // If-Modified-Since: Sun, 03 Apr 2005 04:45:47 GMT
+    strlcat(txbuf, "If-Modified-Since: ", sizeof(txbuf));
+    int len = strlen(txbuf);
+    strftime(txbuf + len, sizeof(txbuf) - len, "%a, %d %b %Y %H:%M:%S %Z\r\n",
+             localtime((time_t *) &f->drv_dw[2]));
+  }
+  strlcat(txbuf, "\r\n", sizeof(txbuf));
+  net_print(f->handle, txbuf);
+}
+
+static int http_connect(dev_file_t *f, http_state *st) {
+  st->len = st->pos = 0;
+  st->reusable = 0;
+  f->handle = http_pool_get(st->host, f->port);
+  st->reused = (f->handle != -1);
+  if (!st->reused) {
+    f->handle = net_connect(st->host, f->port);
+  }
+  if (f->handle <= 0) {
+    f->handle = -1;
+    return 0;
+  }
+  http_send_request(f, st);
+  return 1;
+}
+
 // open a web server connection
 int http_open(dev_file_t *f) {
-  char host[250];
-  char txbuf[1024];
+  http_state *st = (http_state *)f->drv_data;
   f->port = 0;
 
   // check for http://
@@ -51,136 +195,295 @@ int http_open(dev_file_t *f) {
     return 0;
   }
 
+  if (st == NULL) {
+    st = malloc(sizeof(http_state));
+    f->drv_data = (byte *)st;
+  }
+
   // check for end of host delimeter
   char *colon = strchr(f->name + 7, ':');
   char *slash = strchr(f->name + 7, '/');
-  char *lastSlash;
+  if (colon && slash && colon > slash) {
+    // colon within the path
+    colon = NULL;
+  }
+  char *end = colon ? colon : slash;
+  int len = end ? end - (f->name + 7) : (int)strlen(f->name + 7);
+  if (len >= HTTP_HOST_SIZE) {
+    len = HTTP_HOST_SIZE - 1;
+  }
+  memcpy(st->host, f->name + 7, len);
+  st->host[len] = '\0';
+  st->path = slash ? slash : "/";
 
   // saves the length of the path component in f->drv_dw[1]
+  char *lastSlash = slash ? strrchr(slash, '/') : NULL;
+  f->drv_dw[1] = lastSlash ? lastSlash - f->name : strlen(f->name);
   if (colon) {
-    // http://host:port/resource or http://host:port
-    if (slash) {
-      *slash = 0;
-      f->port = xstrtol(colon + 1);
-      *slash = '/';
-      lastSlash = strrchr(slash, '/');
-      f->drv_dw[1] = lastSlash ? lastSlash - f->name : slash - f->name;
-    } else {
-      f->port = xstrtol(colon + 1);
-      f->drv_dw[1] = strlen(f->name);
-    }
-    *colon = 0;
-    strcpy(host, f->name + 7);
-    *colon = ':';
-  } else if (slash) {
-    // http://host/resource or http://host/
-    *slash = 0;
-    strcpy(host, f->name + 7);
-    *slash = '/';
-    lastSlash = strrchr(slash, '/');
-    f->drv_dw[1] = lastSlash ? lastSlash - f->name : slash - f->name;
-  } else {
-    // http://host
-    strlcpy(host, f->name + 7, sizeof(host));
-    f->drv_dw[1] = strlen(f->name);
+    f->port = xstrtol(colon + 1);
   }
-
-  f->drv_dw[0] = 1;
   if (f->port == 0) {
     f->port = 80;
   }
 
-  socket_t s = net_connect(host, f->port);
-  f->handle = (socket_t) s;
-
-  if (f->handle <= 0) {
-    f->handle = -1;
+  f->drv_dw[0] = 1;
+  if (!http_connect(f, st)) {
+    free(st);
+    f->drv_data = NULL;
     f->drv_dw[0] = 0;
     f->port = 0;
     return 0;
   }
-
-  sprintf(txbuf, "GET %s HTTP/1.0\r\n"
-      "Host: %s\r\n"
-      "Accept: */*\r\n"
-      "Accept-Language: en-au\r\n"
-      "User-Agent: SmallBASIC\r\n", slash ? slash : "/", host);
-  if (f->drv_dw[2]) {
-    // If-Modified-Since: Sun, 03 Apr 2005 04:45:47 GMT
-    strcat(txbuf, "If-Modified-Since: ");
-    strftime(txbuf + strlen(txbuf), 60, "%a, %d %b %Y %H:%M:%S %Z\r\n",
-             localtime((time_t *) &f->drv_dw[2]));
-  }
-  strcat(txbuf, "\r\n");
-  net_print(s, txbuf);
   return 1;
 }
 
-// read from a web server connection
-int http_read(dev_file_t *f, var_t *var_p) {
-  char rxbuff[1024];
-  int inHeader = 1;
-  int httpOK = 0;
+// close the connection, keeping it for reuse when possible
+int http_close(dev_file_t *f) {
+  http_state *st = (http_state *)f->drv_data;
+  if (st != NULL && st->reusable && f->handle != -1) {
+    http_pool_put(st->host, f->port, f->handle);
+    f->handle = -1;
+  }
+  free(st);
+  f->drv_data = NULL;
+  return sockcl_close(f);
+}
 
-  v_free(var_p);
-  var_p->type = V_STR;
-  var_p->v.p.ptr = 0;
-  var_p->v.p.length = 0;
+/*
+ * reads the next block from the socket into the state buffer
+ */
+static int http_fill(dev_file_t *f, http_state *st) {
+  st->pos = 0;
+  st->len = net_read(f->handle, st->buffer, sizeof(st->buffer));
+  if (st->len < 0) {
+    st->len = 0;
+  }
+  return st->len;
+}
 
+/*
+ * reads a CRLF terminated line, returns the line length or -1 at EOF
+ */
+static int http_getline(dev_file_t *f, http_state *st, char *line, int size) {
+  int count = 0;
   while (1) {
-    int bytes = net_read(f->handle, (char *) rxbuff, sizeof(rxbuff));
-    if (bytes == -1) {
-      httpOK = 0;
+    if (st->pos == st->len && !http_fill(f, st)) {
+      return count ? count : -1;
+    }
+    char ch = st->buffer[st->pos++];
+    if (ch == '\n') {
       break;
-    } else if (bytes == 0) {
-      break;                    // no more data
-    }
-    // assumes http header < 1024 bytes
-    if (inHeader) {
-      int i = 0;
-      while (1) {
-        int iattr = i;
-        while (rxbuff[i] != 0 && rxbuff[i] != '\n') {
-          i++;
-        }
-        if (rxbuff[i] == 0) {
-          inHeader = 0;
-          break;                // no end delimiter
-        }
-        if (rxbuff[i + 2] == '\n') {
-          var_p->v.p.length = bytes - i - 3;
-          var_p->v.p.ptr = malloc(var_p->v.p.length + 1);
-          var_p->v.p.owner = 1;
-          memcpy(var_p->v.p.ptr, rxbuff + i + 3, var_p->v.p.length);
-          var_p->v.p.ptr[var_p->v.p.length] = 0;
-          inHeader = 0;
-          break;                // found start of content
-        }
-        // null terminate attribute (in \r)
-        rxbuff[i - 1] = 0;
-        i++;
-        if (strstr(rxbuff + iattr, "200 OK") != 0) {
-          httpOK = 1;
+    } else if (ch != '\r' && count < size - 1) {
+      line[count++] = ch;
+    }
+  }
+  line[count] = '\0';
+  return count;
+}
+
+static int http_sink_write(http_sink *sink, const char *data, uint32_t size) {
+  if (sink->var == NULL) {
+    return dev_fwrite(sink->handle, (byte *)data, size);
+  }
+  var_t *var = sink->var;
+  uint32_t required = var->v.p.length + size + 1;
+  if (required > sink->capacity) {
+    sink->capacity = required > sink->capacity * 2 ? required : sink->capacity * 2;
+    var->v.p.ptr = realloc(var->v.p.ptr, sink->capacity);
+  }
+  memcpy(var->v.p.ptr + var->v.p.length, data, size);
+  var->v.p.length += size;
+  return 1;
+}
+
+/*
+ * copies up to size bytes of body to the sink, returns bytes copied
+ */
+static uint32_t http_copy(dev_file_t *f, http_state *st, http_sink *sink, uint32_t size) {
+  uint32_t count = 0;
+  while (count < size && !prog_error) {
+    if (st->pos == st->len && !http_fill(f, st)) {
+      break;
+    }
+    uint32_t n = st->len - st->pos;
+    if (n > size - count) {
+      n = size - count;
+    }
+    if (!http_sink_write(sink, st->buffer + st->pos, n)) {
+      break;
+    }
+    st->pos += n;
+    count += n;
+  }
+  return count;
+}
+
+/*
+ * decodes a chunked transfer body, returns non-zero when complete
+ */
+static int http_copy_chunked(dev_file_t *f, http_state *st, http_sink *sink) {
+  char line[HTTP_LINE_MAX];
+  while (!prog_error) {
+    if (http_getline(f, st, line, sizeof(line)) < 0) {
+      return 0;
+    }
+    uint32_t size = strtoul(line, NULL, 16);
+    if (size == 0) {
+      // skip trailer headers
+      int len;
+      while ((len = http_getline(f, st, line, sizeof(line))) > 0);
+      return len == 0;
+    }
+    if (http_copy(f, st, sink, size) != size ||
+        http_getline(f, st, line, sizeof(line)) != 0) {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+/*
+ * reads the status line and headers. returns the status code or -1
+ */
+static int http_read_header(dev_file_t *f, http_state *st, long *length,
+                            int *chunked, int *keep_alive, char *location) {
+  char line[HTTP_LINE_MAX];
+  int status = -1;
+  int len = http_getline(f, st, line, sizeof(line));
+  if (len > 0) {
+    *keep_alive = (strncmp(line, "HTTP/1.1", 8) == 0);
+    char *code = strchr(line, ' ');
+    status = code ? atoi(code + 1) : 0;
+    while ((len = http_getline(f, st, line, sizeof(line))) > 0) {
+      char *value = strchr(line, ':');
+      if (value != NULL) {
+        *value++ = '\0';
+        while (*value == ' ') {
+          value++;
         }
-        if (strncmp(rxbuff + iattr, "Location: ", 10) == 0) {
-          // handle redirection
-          sockcl_close(f);
-          strlcpy(f->name, rxbuff + iattr + 10, sizeof(f->name));
-          if (http_open(f) == 0) {
-            return 0;
-          }
-          break;                // scan next header
+        if (strcasecmp(line, "Content-Length") == 0) {
+          *length = atol(value);
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+          *chunked = (strstr(value, "chunked") != NULL);
+        } else if (strcasecmp(line, "Connection") == 0) {
+          *keep_alive = (strcasecmp(value, "close") != 0);
+        } else if (strcasecmp(line, "Location") == 0) {
+          strlcpy(location, value, OS_PATHNAME_SIZE);
         }
       }
+    }
+    if (len < 0) {
+      // connection closed within the header
+      status = -1;
+    }
+  }
+  return status;
+}
+
+/*
+ * whether a body follows the header, regardless of Content-Length
+ */
+static int http_has_body(int status) {
+  return !((status >= 100 && status < 200) || status == 204 || status == 304);
+}
+
+/*
+ * reads the response into either var_p or the given file handle
+ */
+static int http_read_response(dev_file_t *f, http_sink *sink) {
+  http_state *st = (http_state *)f->drv_data;
+  char location[OS_PATHNAME_SIZE + 1];
+  int redirects = 0;
+  int status;
+
+  while (1) {
+    long length = -1;
+    int chunked = 0;
+    int keep_alive = 0;
+    location[0] = '\0';
+
+    status = http_read_header(f, st, &length, &chunked, &keep_alive, location);
+    if (status == -1 && st->reused && !prog_error) {
+      // the pooled connection went stale, retry once on a new connection
+      net_disconnect(f->handle);
+      st->reused = 0;
+      f->handle = net_connect(st->host, f->port);
+      if (f->handle <= 0) {
+        f->handle = -1;
+        return 0;
+      }
+      st->len = st->pos = 0;
+      http_send_request(f, st);
+      continue;
+    }
+    if (status == -1) {
+      return 0;
+    }
+
+    if (location[0] && status >= 300 && status < 400 && redirects++ < HTTP_MAX_REDIRECTS) {
+      // handle redirection
+      net_disconnect(f->handle);
+      f->handle = -1;
+      strlcpy(f->name, location, sizeof(f->name));
+      if (http_open(f) == 0) {
+        return 0;
+      }
+      st = (http_state *)f->drv_data;
+      continue;
+    }
+
+    if (status >= 100 && status < 200 && status != 101) {
+      // interim response, the final response follows
+      continue;
+    }
+
+    int complete;
+    if (!http_has_body(status)) {
+      // the connection is no longer http after 101 Switching Protocols
+      complete = (status != 101);
+    } else if (chunked) {
+      complete = http_copy_chunked(f, st, sink);
+    } else if (length >= 0) {
+      if (sink->var != NULL && (uint32_t)length + 1 > sink->capacity) {
+        // pre-size the result from Content-Length
+        sink->capacity = length + 1;
+        sink->var->v.p.ptr = realloc(sink->var->v.p.ptr, sink->capacity);
+      }
+      complete = (http_copy(f, st, sink, length) == (uint32_t)length);
     } else {
-      var_p->v.p.ptr = realloc(var_p->v.p.ptr, var_p->v.p.length + bytes + 1);
-      memcpy(var_p->v.p.ptr + var_p->v.p.length, rxbuff, bytes);
-      var_p->v.p.length += bytes;
-      var_p->v.p.ptr[var_p->v.p.length] = 0;
+      // body ends when the server closes the connection
+      http_copy(f, st, sink, UINT32_MAX);
+      complete = keep_alive = 0;
     }
+    st->reusable = complete && keep_alive && st->pos == st->len && !prog_error;
+    f->drv_dw[0] = 0;
+    break;
   }
+  return status == 200;
+}
 
-  return httpOK;
+// read from a web server connection
+int http_read(dev_file_t *f, var_t *var_p) {
+  http_sink sink;
+  v_free(var_p);
+  v_init_str(var_p, 0);
+  var_p->v.p.length = 0;
+  sink.var = var_p;
+  sink.capacity = 1;
+  sink.handle = -1;
+  int result = http_read_response(f, &sink);
+  var_p->v.p.ptr[var_p->v.p.length] = '\0';
+  var_p->v.p.length++;
+  return result;
+}
+
+// stream the web server response into the given file handle
+int http_read_file(dev_file_t *f, int handle) {
+  http_sink sink;
+  sink.var = NULL;
+  sink.capacity = 0;
+  sink.handle = handle;
+  return http_read_response(f, &sink);
 }
 
 int sockcl_close(dev_file_t *f) {
@@ -202,6 +505,19 @@ int sockcl_write(dev_file_t *f, byte *data, uint32_t size) {
  * read from a socket
  */
 int sockcl_read(dev_file_t *f, byte *data, uint32_t size) {
+  if (f->drv_dw[SOCL_ACCEPTED]) {
+    // binary read of exactly size bytes, unless the client disconnects
+    uint32_t count = 0;
+    while (count < size) {
+      int bytes = net_read((socket_t) f->handle, (char *)data + count, size - count);
+      if (bytes <= 0) {
+        f->drv_dw[0] = 0;
+        break;
+      }
+      count += bytes;
+    }
+    return count;
+  }
   f->drv_dw[0] = (uint32_t) net_input((socket_t) (long) f->handle, (char *)data, size, NULL);
   return (((long) f->drv_dw[0]) <= 0) ? 0 : (long) f->drv_dw[0];
 }
@@ -15,13 +15,18 @@ extern "C" {
 #endif
 
 int sockcl_open(dev_file_t *f);
+int sockcl_listen(dev_file_t *f);
+int sockcl_accept(dev_file_t *listener, dev_file_t *f);
 int sockcl_close(dev_file_t *f);
 int sockcl_write(dev_file_t *f, byte *data, uint32_t size);
 int sockcl_read(dev_file_t *f, byte *data, uint32_t size);
 int sockcl_eof(dev_file_t *f);
 int sockcl_length(dev_file_t *f);
 int http_open(dev_file_t *f);
+int http_close(dev_file_t *f);
 int http_read(dev_file_t *f, var_t *var_p);
+int http_read_file(dev_file_t *f, int handle);
+void http_close_pool(void);
 
 #if defined(__cplusplus)
 }
@@ -17,6 +17,10 @@
 #include <sys/time.h>
 #include <unistd.h>
 #endif
+#if defined(_UnixOS) && !defined(_Win32)
+#include <sys/mman.h>
+#define STREAM_MMAP 1
+#endif
 #include <dirent.h>
 
 #if !defined(O_BINARY)
@@ -122,6 +126,47 @@ int stream_read(dev_file_t *f, byte *data, uint32_t size) {
   return (r == (int) size);
 }
 
+/*
+ * maps the next size bytes of the file into memory
+ */
+int stream_map(dev_file_t *f, uint32_t size, dev_fview_t *view) {
+#if defined(STREAM_MMAP)
+  off_t pos = lseek(f->handle, 0, SEEK_CUR);
+  off_t end = lseek(f->handle, 0, SEEK_END);
+  if (pos == -1 || end == -1 || end - pos < (off_t)size) {
+    // not seekable or too short, mapping past the end would fault
+    if (pos != -1) {
+      lseek(f->handle, pos, SEEK_SET);
+    }
+    return 0;
+  }
+  off_t page = sysconf(_SC_PAGESIZE);
+  off_t base = pos - (pos % page);
+  size_t length = (size_t)(pos - base) + size;
+  void *addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, f->handle, base);
+  if (addr == MAP_FAILED) {
+    lseek(f->handle, pos, SEEK_SET);
+    return 0;
+  }
+  lseek(f->handle, pos + size, SEEK_SET);
+  view->base = addr;
+  view->length = length;
+  view->data = (byte *)addr + (pos - base);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/*
+ * releases a mapping created by stream_map
+ */
+void stream_unmap(dev_fview_t *view) {
+#if defined(STREAM_MMAP)
+  munmap(view->base, view->length);
+#endif
+}
+
 /*
  * returns the current position
  */
@@ -17,6 +17,8 @@ int stream_open(dev_file_t *f);
 int stream_close(dev_file_t *f);
 int stream_write(dev_file_t *f, byte *data, uint32_t size);
 int stream_read(dev_file_t *f, byte *data, uint32_t size);
+int stream_map(dev_file_t *f, uint32_t size, dev_fview_t *view);
+void stream_unmap(dev_fview_t *view);
 uint32_t stream_tell(dev_file_t *f);
 uint32_t stream_length(dev_file_t *f);
 uint32_t stream_seek(dev_file_t *f, uint32_t offset);
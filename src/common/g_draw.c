@@ -0,0 +1,100 @@
+// This file is part of SmallBASIC
+//
+// Shapes and colours shared by the framebuffer drivers
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#include "common/sys.h"
+#include "common/device.h"
+
+static const uint32_t colors[] = {
+  0x000000, // 0 black
+  0x000080, // 1 blue
+  0x008000, // 2 green
+  0x008080, // 3 cyan
+  0x800000, // 4 red
+  0x800080, // 5 magenta
+  0x808000, // 6 yellow
+  0xC0C0C0, // 7 white
+  0x808080, // 8 gray
+  0x0000FF, // 9 light blue
+  0x00FF00, // 10 light green
+  0x00FFFF, // 11 light cyan
+  0xFF0000, // 12 light red
+  0xFF00FF, // 13 light magenta
+  0xFFFF00, // 14 light yellow
+  0xFFFFFF  // 15 bright white
+};
+
+uint32_t g_rgb(long c) {
+  return c < 0 ? -c : colors[c > 15 ? 15 : c];
+}
+
+uint32_t g_rgba(long c) {
+  uint32_t rgb = g_rgb(c);
+  uint8_t rgba[4] = {
+    (uint8_t)((rgb & 0xff0000) >> 16),
+    (uint8_t)((rgb & 0xff00) >> 8),
+    (uint8_t)(rgb & 0xff),
+    0xff
+  };
+  uint32_t result;
+  memcpy(&result, rgba, sizeof(result));
+  return result;
+}
+
+// draws the four reflections of the point, or the two spans between them
+static void g_ellipse4(int xc, int yc, int x, int y, int fill,
+                       void (*dotproc)(int, int), void (*spanproc)(int, int, int)) {
+  if (fill) {
+    spanproc(xc - x, xc + x, yc + y);
+    spanproc(xc - x, xc + x, yc - y);
+  } else {
+    dotproc(xc + x, yc + y);
+    dotproc(xc - x, yc + y);
+    dotproc(xc + x, yc - y);
+    dotproc(xc - x, yc - y);
+  }
+}
+
+void g_ellipse(int xc, int yc, int rx, int ry, int fill,
+               void (*dotproc)(int, int), void (*spanproc)(int, int, int)) {
+  int x = 0;
+  int y = ry;
+  double a = rx;
+  double b = ry;
+  double asq = a * a;
+  double asq2 = 2 * asq;
+  double bsq = b * b;
+  double bsq2 = 2 * bsq;
+  double d = bsq - asq * b + asq / 4L;
+  double dx = 0;
+  double dy = asq2 * b;
+
+  while (dx < dy) {
+    g_ellipse4(xc, yc, x, y, fill, dotproc, spanproc);
+    if (d > 0L) {
+      y--;
+      dy -= asq2;
+      d -= dy;
+    }
+    x++;
+    dx += bsq2;
+    d += bsq + dx;
+  }
+
+  d += (3L * (asq - bsq) / 2L - (dx + dy)) / 2L;
+
+  while (y >= 0) {
+    g_ellipse4(xc, yc, x, y, fill, dotproc, spanproc);
+    if (d < 0L) {
+      x++;
+      dx += bsq2;
+      d += dx;
+    }
+    y--;
+    dy -= asq2;
+    d += asq - dy;
+  }
+}
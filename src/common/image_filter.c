@@ -0,0 +1,544 @@
+// This file is part of SmallBASIC
+//
+// native image operations for the image object. large images are divided
+// into bands of rows between workers, which only see the pixel buffers.
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#include "common/sys.h"
+#include "common/pproc.h"
+#include "common/messages.h"
+#include "common/threads.h"
+#include "common/image_filter.h"
+
+#include <math.h>
+
+// smaller images are filtered by the interpreter thread
+#define IMG_PARALLEL_MIN 0x10000
+
+// largest accepted convolution kernel
+#define IMG_KERNEL_MAX 15
+
+// largest accepted width or height, and number of pixels, so that byte
+// offsets fit an int
+#define IMG_SIZE_MAX 0x10000
+#define IMG_PIXELS_MAX (INT_MAX / 4)
+
+typedef struct img_band_t {
+  const img_buffer_t *img;
+  const uint8_t *src;
+  uint8_t *dst;
+  int y1;
+  int y2;
+  const void *args;
+  void (*func)(struct img_band_t *band);
+} img_band_t;
+
+typedef struct img_matrix_t {
+  float m[4][5];
+} img_matrix_t;
+
+typedef struct img_kernel_t {
+  float k[IMG_KERNEL_MAX * IMG_KERNEL_MAX];
+  int size;
+  float scale;
+  float bias;
+} img_kernel_t;
+
+typedef struct img_size_t {
+  int width;
+  int height;
+  int value;
+} img_size_t;
+
+static inline uint8_t img_clamp(float value) {
+  return value <= 0 ? 0 : value >= 255 ? 255 : (uint8_t)(value + 0.5f);
+}
+
+static inline int img_edge(int i, int size) {
+  return i < 0 ? 0 : i >= size ? size - 1 : i;
+}
+
+/*
+ * returns the bytes needed for the pixels, or 0 when the size is out of range
+ */
+static size_t img_bytes(var_int_t width, var_int_t height) {
+  size_t result = 0;
+  if (width > 0 && height > 0 && width <= IMG_SIZE_MAX && height <= IMG_SIZE_MAX &&
+      width * height <= IMG_PIXELS_MAX) {
+    result = 4 * (size_t)width * (size_t)height;
+  }
+  return result;
+}
+
+// byte offsets of the red and blue channels
+static inline int img_red(const img_buffer_t *img) {
+  return img->bgr ? 2 : 0;
+}
+
+static inline int img_blue(const img_buffer_t *img) {
+  return img->bgr ? 0 : 2;
+}
+
+static inline int img_luma(const uint8_t *px, int red, int blue) {
+  return (77 * px[red] + 150 * px[1] + 29 * px[blue] + 128) >> 8;
+}
+
+static void img_band_main(void *data) {
+  img_band_t *band = (img_band_t *)data;
+  band->func(band);
+}
+
+/*
+ * runs func over the destination rows, divided between the workers
+ */
+static void img_bands(const img_buffer_t *img, const uint8_t *src, uint8_t *dst,
+                      int width, int height, const void *args,
+                      void (*func)(img_band_t *band)) {
+  img_band_t bands[THREAD_MAX_WORKERS];
+  thread_t *threads[THREAD_MAX_WORKERS];
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  int workers = (width * height < IMG_PARALLEL_MIN) ? 1 : thread_workers();
+  if (workers > height) {
+    workers = height;
+  }
+  int size = height / workers;
+  for (int i = 0; i < workers; i++) {
+    bands[i].img = img;
+    bands[i].src = src;
+    bands[i].dst = dst;
+    bands[i].y1 = i * size;
+    bands[i].y2 = (i == workers - 1) ? height : (i + 1) * size;
+    bands[i].args = args;
+    bands[i].func = func;
+    threads[i] = i == 0 ? NULL : thread_start(img_band_main, &bands[i]);
+  }
+  for (int i = 0; i < workers; i++) {
+    if (threads[i] == NULL) {
+      func(&bands[i]);
+    }
+  }
+  for (int i = 1; i < workers; i++) {
+    thread_join(threads[i]);
+  }
+}
+
+static void img_grey_band(img_band_t *band) {
+  int red = img_red(band->img);
+  int blue = img_blue(band->img);
+  uint8_t *px = band->dst + 4 * band->y1 * band->img->width;
+  uint8_t *end = band->dst + 4 * band->y2 * band->img->width;
+  for (; px < end; px += 4) {
+    px[0] = px[1] = px[2] = img_luma(px, red, blue);
+  }
+}
+
+static void img_threshold_band(img_band_t *band) {
+  int red = img_red(band->img);
+  int blue = img_blue(band->img);
+  int level = ((const img_size_t *)band->args)->value;
+  uint8_t *px = band->dst + 4 * band->y1 * band->img->width;
+  uint8_t *end = band->dst + 4 * band->y2 * band->img->width;
+  for (; px < end; px += 4) {
+    px[0] = px[1] = px[2] = img_luma(px, red, blue) >= level ? 255 : 0;
+  }
+}
+
+static void img_matrix_band(img_band_t *band) {
+  const img_matrix_t *matrix = (const img_matrix_t *)band->args;
+  int channel[4] = {img_red(band->img), 1, img_blue(band->img), 3};
+  uint8_t *px = band->dst + 4 * band->y1 * band->img->width;
+  uint8_t *end = band->dst + 4 * band->y2 * band->img->width;
+  for (; px < end; px += 4) {
+    float in[4] = {px[channel[0]], px[channel[1]], px[channel[2]], px[channel[3]]};
+    for (int c = 0; c < 4; c++) {
+      const float *m = matrix->m[c];
+      px[channel[c]] = img_clamp(m[0] * in[0] + m[1] * in[1] + m[2] * in[2] + m[3] * in[3] + m[4]);
+    }
+  }
+}
+
+static void img_convolve_band(img_band_t *band) {
+  const img_kernel_t *kernel = (const img_kernel_t *)band->args;
+  int w = band->img->width;
+  int h = band->img->height;
+  int half = kernel->size / 2;
+  for (int y = band->y1; y < band->y2; y++) {
+    uint8_t *dst = band->dst + 4 * y * w;
+    for (int x = 0; x < w; x++, dst += 4) {
+      float sum[3] = {0, 0, 0};
+      const float *k = kernel->k;
+      for (int ky = -half; ky <= half; ky++) {
+        const uint8_t *row = band->src + 4 * img_edge(y + ky, h) * w;
+        for (int kx = -half; kx <= half; kx++, k++) {
+          const uint8_t *px = row + 4 * img_edge(x + kx, w);
+          sum[0] += *k * px[0];
+          sum[1] += *k * px[1];
+          sum[2] += *k * px[2];
+        }
+      }
+      dst[0] = img_clamp(sum[0] * kernel->scale + kernel->bias);
+      dst[1] = img_clamp(sum[1] * kernel->scale + kernel->bias);
+      dst[2] = img_clamp(sum[2] * kernel->scale + kernel->bias);
+    }
+  }
+}
+
+/*
+ * horizontal running sums, src to dst
+ */
+static void img_blur_rows(img_band_t *band) {
+  int radius = ((const img_size_t *)band->args)->value;
+  int w = band->img->width;
+  int n = 2 * radius + 1;
+  for (int y = band->y1; y < band->y2; y++) {
+    const uint8_t *src = band->src + 4 * y * w;
+    uint8_t *dst = band->dst + 4 * y * w;
+    for (int c = 0; c < 4; c++) {
+      int sum = 0;
+      for (int k = -radius; k <= radius; k++) {
+        sum += src[4 * img_edge(k, w) + c];
+      }
+      for (int x = 0; x < w; x++) {
+        dst[4 * x + c] = (sum + n / 2) / n;
+        sum += src[4 * img_edge(x + radius + 1, w) + c] - src[4 * img_edge(x - radius, w) + c];
+      }
+    }
+  }
+}
+
+/*
+ * vertical running sums over whole rows, src to dst
+ */
+static void img_blur_cols(img_band_t *band) {
+  int radius = ((const img_size_t *)band->args)->value;
+  int w = band->img->width;
+  int h = band->img->height;
+  int n = 2 * radius + 1;
+  int size = 4 * w;
+  int *sum = (int *)calloc(size, sizeof(int));
+  if (sum == NULL) {
+    return;
+  }
+  for (int k = -radius; k <= radius; k++) {
+    const uint8_t *row = band->src + size * img_edge(band->y1 + k, h);
+    for (int i = 0; i < size; i++) {
+      sum[i] += row[i];
+    }
+  }
+  for (int y = band->y1; y < band->y2; y++) {
+    uint8_t *dst = band->dst + size * y;
+    const uint8_t *next = band->src + size * img_edge(y + radius + 1, h);
+    const uint8_t *prev = band->src + size * img_edge(y - radius, h);
+    for (int i = 0; i < size; i++) {
+      dst[i] = (sum[i] + n / 2) / n;
+      sum[i] += next[i] - prev[i];
+    }
+  }
+  free(sum);
+}
+
+static void img_resize_band(img_band_t *band) {
+  const img_size_t *size = (const img_size_t *)band->args;
+  int sw = band->img->width;
+  int sh = band->img->height;
+  int dw = size->width;
+  int dh = size->height;
+  for (int y = band->y1; y < band->y2; y++) {
+    // source positions in 1/256ths, sampled at the pixel centres
+    int sy = (int)(((int64_t)(2 * y + 1) * sh * 256) / (2 * dh)) - 128;
+    sy = sy < 0 ? 0 : sy > (sh - 1) * 256 ? (sh - 1) * 256 : sy;
+    int wy = sy & 0xff;
+    const uint8_t *row0 = band->src + 4 * (sy >> 8) * sw;
+    const uint8_t *row1 = band->src + 4 * img_edge((sy >> 8) + 1, sh) * sw;
+    uint8_t *dst = band->dst + 4 * y * dw;
+    for (int x = 0; x < dw; x++, dst += 4) {
+      int sx = (int)(((int64_t)(2 * x + 1) * sw * 256) / (2 * dw)) - 128;
+      sx = sx < 0 ? 0 : sx > (sw - 1) * 256 ? (sw - 1) * 256 : sx;
+      int wx = sx & 0xff;
+      int x0 = 4 * (sx >> 8);
+      int x1 = 4 * img_edge((sx >> 8) + 1, sw);
+      for (int c = 0; c < 4; c++) {
+        int top = row0[x0 + c] * (256 - wx) + row0[x1 + c] * wx;
+        int bottom = row1[x0 + c] * (256 - wx) + row1[x1 + c] * wx;
+        dst[c] = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+      }
+    }
+  }
+}
+
+void img_grey(img_buffer_t *img) {
+  img_bands(img, img->pixels, img->pixels, img->width, img->height, NULL, img_grey_band);
+}
+
+void img_threshold(img_buffer_t *img, int level) {
+  img_size_t args = {0, 0, level};
+  img_bands(img, img->pixels, img->pixels, img->width, img->height, &args, img_threshold_band);
+}
+
+void img_color_matrix(img_buffer_t *img, const var_num_t *matrix, int rows, int cols) {
+  img_matrix_t args;
+  for (int r = 0; r < 4; r++) {
+    for (int c = 0; c < 5; c++) {
+      args.m[r][c] = (r == c) ? 1 : 0;
+    }
+  }
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < cols; c++) {
+      // the last of rows + 1 columns is the offset
+      args.m[r][c == rows ? 4 : c] = matrix[r * cols + c];
+    }
+  }
+  img_bands(img, img->pixels, img->pixels, img->width, img->height, &args, img_matrix_band);
+}
+
+void img_convolve(img_buffer_t *img, const var_num_t *kernel, int size,
+                  var_num_t divisor, var_num_t bias) {
+  size_t bytes = img_bytes(img->width, img->height);
+  uint8_t *src = bytes ? (uint8_t *)malloc(bytes) : NULL;
+  if (src == NULL) {
+    err_memory();
+  } else {
+    img_kernel_t args;
+    args.size = size;
+    args.scale = divisor != 0 ? 1 / divisor : 1;
+    args.bias = bias;
+    for (int i = 0; i < size * size; i++) {
+      args.k[i] = kernel[i];
+    }
+    memcpy(src, img->pixels, bytes);
+    img_bands(img, src, img->pixels, img->width, img->height, &args, img_convolve_band);
+    free(src);
+  }
+}
+
+void img_blur(img_buffer_t *img, int radius) {
+  size_t bytes = img_bytes(img->width, img->height);
+  uint8_t *rows = bytes ? (uint8_t *)malloc(bytes) : NULL;
+  if (rows == NULL) {
+    err_memory();
+  } else {
+    img_size_t args = {0, 0, radius};
+    img_bands(img, img->pixels, rows, img->width, img->height, &args, img_blur_rows);
+    img_bands(img, rows, img->pixels, img->width, img->height, &args, img_blur_cols);
+    free(rows);
+  }
+}
+
+uint8_t *img_resize(const img_buffer_t *img, int width, int height) {
+  size_t bytes = img_bytes(width, height);
+  uint8_t *result = bytes ? (uint8_t *)malloc(bytes) : NULL;
+  if (result != NULL) {
+    img_size_t args = {width, height, 0};
+    img_bands(img, img->pixels, result, width, height, &args, img_resize_band);
+  }
+  return result;
+}
+
+void img_get_channel(const img_buffer_t *img, int channel, var_t *array) {
+  int offset = channel == IMG_RED ? img_red(img) : channel == IMG_BLUE ? img_blue(img) : channel;
+  uint32_t count = img->width * img->height;
+  v_tomatrix(array, img->height, img->width);
+  for (uint32_t i = 0; i < count; i++) {
+    v_setint(v_elem(array, i), img->pixels[4 * i + offset]);
+  }
+}
+
+int img_set_channel(img_buffer_t *img, int channel, var_t *array) {
+  int offset = channel == IMG_RED ? img_red(img) : channel == IMG_BLUE ? img_blue(img) : channel;
+  uint32_t count = img->width * img->height;
+  int result = (array->type == V_ARRAY && v_asize(array) == count);
+  for (uint32_t i = 0; result && i < count; i++) {
+    var_int_t value = v_getint(v_elem(array, i));
+    img->pixels[4 * i + offset] = value < 0 ? 0 : value > 255 ? 255 : value;
+  }
+  return result;
+}
+
+/*
+ * copies up to max numbers from the array, returns the count or -1
+ */
+static int img_get_values(var_t *array, var_num_t *values, int max) {
+  int result = -1;
+  if (array != NULL && array->type == V_ARRAY && v_asize(array) <= (uint32_t)max) {
+    result = v_asize(array);
+    for (int i = 0; i < result; i++) {
+      values[i] = v_getreal(v_elem(array, i));
+    }
+  }
+  return result;
+}
+
+void img_exec(img_buffer_t *img, img_op_t op) {
+  var_num_t values[IMG_KERNEL_MAX * IMG_KERNEL_MAX];
+  var_t *array = NULL;
+  var_int_t i1 = 0, i2 = 0;
+  var_num_t f1 = 0, f2 = 0;
+  int count;
+
+  switch (op) {
+  case img_op_grey:
+    img_grey(img);
+    break;
+
+  case img_op_color_matrix:
+    // 3x3, 3x4, 4x4 or 4x5
+    par_massget("P", &array);
+    count = img_get_values(array, values, 20);
+    if (count == 9 || count == 12) {
+      img_color_matrix(img, values, 3, count / 3);
+    } else if (count == 16 || count == 20) {
+      img_color_matrix(img, values, 4, count / 4);
+    } else if (!prog_error) {
+      err_throw(ERR_PARAM);
+    }
+    break;
+
+  case img_op_convolve:
+    count = par_massget("Pff", &array, &f1, &f2);
+    i1 = img_get_values(array, values, IMG_KERNEL_MAX * IMG_KERNEL_MAX);
+    i2 = (int)sqrt(i1 > 0 ? i1 : 0);
+    if (i1 > 0 && i2 * i2 == i1 && (i2 & 1)) {
+      if (count < 2) {
+        // preserve the brightness
+        for (int i = 0; i < i1; i++) {
+          f1 += values[i];
+        }
+      }
+      img_convolve(img, values, i2, f1, f2);
+    } else if (!prog_error) {
+      err_throw(ERR_PARAM);
+    }
+    break;
+
+  case img_op_blur:
+    i1 = 1;
+    par_massget("i", &i1);
+    if (i1 < 1 || (i1 > img->width && i1 > img->height)) {
+      err_throw(ERR_PARAM);
+    } else if (!prog_error) {
+      img_blur(img, i1);
+    }
+    break;
+
+  case img_op_sharpen:
+    f1 = 1;
+    par_massget("f", &f1);
+    if (!prog_error) {
+      var_num_t kernel[9] = {0, -f1, 0, -f1, 1 + 4 * f1, -f1, 0, -f1, 0};
+      img_convolve(img, kernel, 3, 1, 0);
+    }
+    break;
+
+  case img_op_threshold:
+    i1 = 128;
+    par_massget("i", &i1);
+    if (!prog_error) {
+      img_threshold(img, i1);
+    }
+    break;
+
+  case img_op_resize:
+    if (par_massget("II", &i1, &i2) != 2) {
+      break;
+    } else if (!img_bytes(i1, i2)) {
+      err_throw(ERR_PARAM);
+    } else {
+      uint8_t *pixels = img_resize(img, i1, i2);
+      if (pixels == NULL) {
+        err_memory();
+      } else {
+        free(img->pixels);
+        img->pixels = pixels;
+        img->width = i1;
+        img->height = i2;
+      }
+    }
+    break;
+
+  case img_op_get_channel:
+  case img_op_set_channel:
+    if (par_massget("IP", &i1, &array) != 2) {
+      break;
+    } else if (i1 < IMG_RED || i1 > IMG_ALPHA) {
+      err_throw(ERR_PARAM);
+    } else if (op == img_op_get_channel) {
+      img_get_channel(img, i1, array);
+    } else if (!img_set_channel(img, i1, array)) {
+      err_throw(ERR_PARAM);
+    }
+    break;
+  }
+}
+
+//
+// png.grey()
+// png.colormatrix(m)         ' 3x3, 3x4, 4x4 or 4x5
+// png.convolve(k, [divisor, bias])
+// png.blur([radius])
+// png.sharpen([amount])
+// png.threshold([level])
+// png.resize(w, h)
+// png.getchannel(n, a)       ' 0=red, 1=green, 2=blue, 3=alpha
+// png.setchannel(n, a)
+//
+static void img_exec_self(var_t *self, img_op_t op) {
+  img_buffer_t img;
+  if (!img_buffer_get(self, &img)) {
+    err_throw(ERR_PARAM);
+  } else {
+    img_exec(&img, op);
+    img_buffer_set(self, &img);
+  }
+}
+
+static void cmd_image_grey(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_grey);
+}
+
+static void cmd_image_color_matrix(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_color_matrix);
+}
+
+static void cmd_image_convolve(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_convolve);
+}
+
+static void cmd_image_blur(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_blur);
+}
+
+static void cmd_image_sharpen(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_sharpen);
+}
+
+static void cmd_image_threshold(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_threshold);
+}
+
+static void cmd_image_resize(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_resize);
+}
+
+static void cmd_image_get_channel(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_get_channel);
+}
+
+static void cmd_image_set_channel(var_t *self, var_t *retval) {
+  img_exec_self(self, img_op_set_channel);
+}
+
+void img_create_methods(var_t *map) {
+  v_create_func(map, "grey", cmd_image_grey);
+  v_create_func(map, "colormatrix", cmd_image_color_matrix);
+  v_create_func(map, "convolve", cmd_image_convolve);
+  v_create_func(map, "blur", cmd_image_blur);
+  v_create_func(map, "sharpen", cmd_image_sharpen);
+  v_create_func(map, "threshold", cmd_image_threshold);
+  v_create_func(map, "resize", cmd_image_resize);
+  v_create_func(map, "getchannel", cmd_image_get_channel);
+  v_create_func(map, "setchannel", cmd_image_set_channel);
+}
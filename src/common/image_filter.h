@@ -0,0 +1,111 @@
+// This file is part of SmallBASIC
+//
+// native image operations for the image object
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#if !defined(_sb_image_filter_h)
+#define _sb_image_filter_h
+
+#include "common/sys.h"
+#include "common/var.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// channel numbers as seen from BASIC
+#define IMG_RED   0
+#define IMG_GREEN 1
+#define IMG_BLUE  2
+#define IMG_ALPHA 3
+
+typedef enum {
+  img_op_grey,
+  img_op_color_matrix,
+  img_op_convolve,
+  img_op_blur,
+  img_op_sharpen,
+  img_op_threshold,
+  img_op_resize,
+  img_op_get_channel,
+  img_op_set_channel
+} img_op_t;
+
+/**
+ * 4 bytes per pixel, rows without padding. bgr when blue is the first byte
+ */
+typedef struct img_buffer_t {
+  uint8_t *pixels;
+  int width;
+  int height;
+  int bgr;
+} img_buffer_t;
+
+/**
+ * parses the image method's arguments and applies the operation. the
+ * pixels are replaced when the size changes
+ */
+void img_exec(img_buffer_t *img, img_op_t op);
+
+/**
+ * converts to luma (ITU-R BT.601)
+ */
+void img_grey(img_buffer_t *img);
+
+/**
+ * applies a colour matrix. rows is 3 (rgb) or 4 (rgba), cols is rows, or
+ * rows + 1 with an offset column in 0..255 units
+ */
+void img_color_matrix(img_buffer_t *img, const var_num_t *matrix, int rows, int cols);
+
+/**
+ * convolves the colour channels with a size x size kernel (size is odd).
+ * edge pixels are repeated, alpha is preserved
+ */
+void img_convolve(img_buffer_t *img, const var_num_t *kernel, int size,
+                  var_num_t divisor, var_num_t bias);
+
+/**
+ * box blur of all channels, in two passes
+ */
+void img_blur(img_buffer_t *img, int radius);
+
+/**
+ * sets the colour to black or white depending on the pixel's luma
+ */
+void img_threshold(img_buffer_t *img, int level);
+
+/**
+ * returns a new bilinear scaled copy of the pixels or NULL
+ */
+uint8_t *img_resize(const img_buffer_t *img, int width, int height);
+
+/**
+ * copies the channel to or from a height x width numeric array
+ */
+void img_get_channel(const img_buffer_t *img, int channel, var_t *array);
+int img_set_channel(img_buffer_t *img, int channel, var_t *array);
+
+/**
+ * adds the image methods above to the image object
+ */
+void img_create_methods(var_t *map);
+
+/**
+ * implemented by the platform: fills img with the image object's pixels,
+ * returns 0 when self is not an image
+ */
+int img_buffer_get(var_t *self, img_buffer_t *img);
+
+/**
+ * implemented by the platform: stores the pixels after an operation
+ */
+void img_buffer_set(var_t *self, const img_buffer_t *img);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
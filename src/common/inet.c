@@ -23,8 +23,12 @@
  int net_read(socket_t s, char *buf, int size) { return 0; }
  socket_t net_connect(const char *server_name, int server_port) { return 0; }
  socket_t net_listen(int server_port) { return 0; }
+ socket_t net_server(int server_port) { return -1; }
+ socket_t net_accept(socket_t listener) { return -1; }
+ int net_poll(const socket_t *socks, int count, int timeout, int *ready) { return -1; }
  void net_disconnect(socket_t s) {}
  int net_peek(socket_t s) { return 0; }
+ int net_idle(socket_t s) { return 0; }
 #elif defined(_UnixOS)
  #include "inet2.c"
 #endif
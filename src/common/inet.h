@@ -108,7 +108,7 @@ int net_read(socket_t s, char *buf, int size);
  *
  * @param server_name the server's IP or domain-name
  * @param server_port the port to connect
- * @return on success the socket; otherwise -1
+ * @return on success the non-blocking socket; otherwise -1
  */
 socket_t net_connect(const char *server_name, int server_port);
 
@@ -118,10 +118,45 @@ socket_t net_connect(const char *server_name, int server_port);
  * listen on a port number like a server
  *
  * @param server_port the port to listen
- * @return on success the socket; otherwise -1
+ * @return on success the non-blocking socket; otherwise -1
  */
 socket_t net_listen(int server_port);
 
+/**
+ * @ingroup net
+ *
+ * creates a non-blocking server socket which accepts any number of
+ * clients, see net_accept()
+ *
+ * @param server_port the port to listen
+ * @return on success the socket; otherwise -1
+ */
+socket_t net_server(int server_port);
+
+/**
+ * @ingroup net
+ *
+ * accepts a pending client connection from a net_server() socket
+ *
+ * @param listener the server socket
+ * @return the non-blocking client socket; otherwise -1 when nothing is pending
+ */
+socket_t net_accept(socket_t listener);
+
+/**
+ * @ingroup net
+ *
+ * waits for any of the given sockets to become readable. a socket with
+ * a pending connection, data, or a closed connection is readable
+ *
+ * @param socks the sockets
+ * @param count the number of sockets
+ * @param timeout the milliseconds to wait, -1 to wait indefinitely
+ * @param ready receives non-zero for each readable socket
+ * @return the number of readable sockets, 0 on timeout or -1 on error
+ */
+int net_poll(const socket_t *socks, int count, int timeout, int *ready);
+
 /**
  * @ingroup net
  *
@@ -134,13 +169,24 @@ void net_disconnect(socket_t s);
 /**
  * @ingroup net
  *
- * returns true if something is waiting in input-buffer
+ * returns the number of bytes waiting in input-buffer
  *
  * @param s the socket
- * @return non-zero if something is waiting in input-buffer; otherwise returns 0
+ * @return the number of bytes waiting in input-buffer; otherwise returns 0
  */
 int net_peek(socket_t s);
 
+/**
+ * @ingroup net
+ *
+ * returns true if the connection is open with nothing waiting to be read.
+ * used to validate an idle keep-alive connection before reuse
+ *
+ * @param s the socket
+ * @return non-zero if the connection is idle
+ */
+int net_idle(socket_t s);
+
 #if defined(__cplusplus)
 }
 #endif
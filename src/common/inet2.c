@@ -23,6 +23,8 @@ static int inetlib_init = 0;
 #include <netdb.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
 #endif
 
 // the length of time (usec) to block waiting for an event
@@ -68,11 +70,58 @@ int net_close() {
  * sends a string to socket
  */
 void net_print(socket_t s, const char *str) {
-  send(s, str, strlen(str), 0);
+  net_send(s, str, strlen(str));
+}
+
+/**
+ * waits for a non-blocking socket to accept more data
+ */
+static int net_wait_writable(socket_t s) {
+  fd_set writefds;
+  struct timeval tv;
+
+  FD_ZERO(&writefds);
+  while (1) {
+    FD_SET(s, &writefds);
+    tv.tv_sec = 0;
+    tv.tv_usec = BLOCK_INTERVAL;
+
+    int rv = select(s + 1, NULL, &writefds, NULL, &tv);
+    if (rv == -1) {
+      return 0;
+    } else if (rv == 0) {
+      if (0 != dev_events(0)) {
+        return 0;
+      }
+    } else {
+      return 1;
+    }
+  }
+}
+
+/**
+ * returns true when the last send failed because the socket buffer is full
+ */
+static int net_would_block() {
+#if defined(_Win32)
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
 }
 
 void net_send(socket_t s, const char *str, size_t size) {
-  send(s, str, size, 0);
+  while (size > 0) {
+    int sent = send(s, str, size, 0);
+    if (sent > 0) {
+      str += sent;
+      size -= sent;
+    } else if (sent == -1 && net_would_block() && net_wait_writable(s)) {
+      continue;
+    } else {
+      break;
+    }
+  }
 }
 
 /**
@@ -180,24 +229,54 @@ int net_input(socket_t s, char *buf, int size, const char *delim) {
 }
 
 /**
- * return true if there something waiting
+ * return the number of bytes waiting
  */
 int net_peek(socket_t s) {
 #if defined(_Win32)
   unsigned long bytes;
 
   ioctlsocket(s, FIONREAD, &bytes);
-  return (bytes > 0);
+  return (int)bytes;
 #else
   int bytes;
 
-  ioctl(s, FIONREAD, &bytes);
-  return (bytes > 0);
+  if (ioctl(s, FIONREAD, &bytes) == -1) {
+    bytes = 0;
+  }
+  return (bytes > 0) ? bytes : 0;
 #endif
 }
 
 /**
- * connect to server and returns the socket
+ * return true if the connection is open and nothing is waiting. a closed
+ * connection is reported as readable
+ */
+int net_idle(socket_t s) {
+  fd_set readfds;
+  struct timeval tv;
+
+  FD_ZERO(&readfds);
+  FD_SET(s, &readfds);
+  tv.tv_sec = 0;
+  tv.tv_usec = 0;
+  return select(s + 1, &readfds, NULL, NULL, &tv) == 0;
+}
+
+/**
+ * puts the socket into non-blocking mode
+ */
+static int net_set_nonblocking(socket_t s) {
+#if defined(_Win32)
+  unsigned long mode = 1;
+  return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+  int flags = fcntl(s, F_GETFL, 0);
+  return flags != -1 && fcntl(s, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
+/**
+ * connect to server and returns a non-blocking socket
  */
 socket_t net_connect(const char *server_name, int server_port) {
   socket_t sock;
@@ -224,7 +303,8 @@ socket_t net_connect(const char *server_name, int server_port) {
   if (sock <= 0) {
     return sock;
   }
-  if (connect(sock, (struct sockaddr *)&ad, sizeof(ad)) < 0) {
+  if (connect(sock, (struct sockaddr *)&ad, sizeof(ad)) < 0 ||
+      !net_set_nonblocking(sock)) {
     net_disconnect(sock);
     return -1;
   }
@@ -232,16 +312,11 @@ socket_t net_connect(const char *server_name, int server_port) {
 }
 
 /**
- * listen for an incoming connection on the given port and 
- * returns the socket once a connection has been established
+ * creates a socket listening on the given port
  */
-socket_t net_listen(int server_port) {
-  int listener;
-  struct sockaddr_in addr, remoteaddr;
-  socket_t s;
-  fd_set readfds;
-  struct timeval tv;
-  int rv;
+static socket_t net_bind(int server_port, int backlog) {
+  socket_t listener;
+  struct sockaddr_in addr;
   int yes = 1;
 
   // more info about listen sockets:
@@ -268,10 +343,29 @@ socket_t net_listen(int server_port) {
     return -1;
   }
 
-  if (listen(listener, 1) == -1) {
+  if (listen(listener, backlog) == -1) {
     net_disconnect(listener);
     return -1;
   }
+  return listener;
+}
+
+/**
+ * listen for an incoming connection on the given port and 
+ * returns the non-blocking socket once a connection has been established
+ */
+socket_t net_listen(int server_port) {
+  struct sockaddr_in remoteaddr;
+  socket_t s;
+  fd_set readfds;
+  struct timeval tv;
+  int rv;
+
+  socket_t listener = net_bind(server_port, 1);
+  if (listener <= 0) {
+    return listener;
+  }
+
   // clear the set
   FD_ZERO(&readfds);
 
@@ -305,9 +399,83 @@ socket_t net_listen(int server_port) {
   FD_ZERO(&readfds);
   net_disconnect(listener);
 
+  if (s > 0 && !net_set_nonblocking(s)) {
+    net_disconnect(s);
+    s = -1;
+  }
   return s;
 }
 
+/**
+ * returns a non-blocking socket accepting any number of clients
+ */
+socket_t net_server(int server_port) {
+  socket_t listener = net_bind(server_port, SOMAXCONN);
+  if (listener > 0 && !net_set_nonblocking(listener)) {
+    net_disconnect(listener);
+    listener = -1;
+  }
+  return listener;
+}
+
+/**
+ * accepts a pending connection without blocking
+ */
+socket_t net_accept(socket_t listener) {
+  struct sockaddr_in remoteaddr;
+#if defined(_Win32)
+  int remoteaddr_len = sizeof(remoteaddr);
+#else
+  socklen_t remoteaddr_len = sizeof(remoteaddr);
+#endif
+  socket_t s = accept(listener, (struct sockaddr *)&remoteaddr, &remoteaddr_len);
+  if (s != -1 && !net_set_nonblocking(s)) {
+    net_disconnect(s);
+    s = -1;
+  }
+  return s;
+}
+
+/**
+ * waits up to timeout milliseconds for any of the sockets to become readable
+ */
+int net_poll(const socket_t *socks, int count, int timeout, int *ready) {
+  int result;
+#if defined(_Win32)
+  fd_set readfds;
+  struct timeval tv;
+  socket_t max = 0;
+
+  FD_ZERO(&readfds);
+  for (int i = 0; i < count; i++) {
+    FD_SET(socks[i], &readfds);
+    if (socks[i] > max) {
+      max = socks[i];
+    }
+  }
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+  result = select(max + 1, &readfds, NULL, NULL, &tv);
+  for (int i = 0; i < count; i++) {
+    ready[i] = result > 0 && FD_ISSET(socks[i], &readfds);
+  }
+#else
+  struct pollfd *fds = malloc(sizeof(struct pollfd) * count);
+  for (int i = 0; i < count; i++) {
+    fds[i].fd = socks[i];
+    fds[i].events = POLLIN;
+    fds[i].revents = 0;
+  }
+  result = poll(fds, count, timeout);
+  for (int i = 0; i < count; i++) {
+    // hangup and errors are ready, the next read reports EOF
+    ready[i] = result > 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+  }
+  free(fds);
+#endif
+  return result;
+}
+
 /**
  * disconnect the given network connection
  */
@@ -13,6 +13,7 @@
 #include "common/smbas.h"
 #include "common/pproc.h"
 #include "common/keymap.h"
+#include "common/fs_async.h"
 
 //  Keyboard buffer
 uint32_t keybuff[PCKBSIZE];
@@ -240,4 +241,13 @@ void timer_run(uint32_t now) {
     }
     timer = timer->next;
   }
+
+  // completed asynchronous requests
+  bcip_t handler;
+  while ((handler = async_next_handler()) != INVALID_ADDR) {
+    bcip_t ip = prog_ip;
+    prog_ip = handler;
+    bc_loop(1);
+    prog_ip = ip;
+  }
 }
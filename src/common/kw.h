@@ -177,6 +177,7 @@ enum keyword {
   kwCATCH,
   kwENDTRY,
   kwFUNC_RETURN,
+  kwTYPE_CALL_TAIL, /* Self-recursive UDP/UDF call in tail position */
   kwNULL
 };
 
@@ -247,6 +248,9 @@ enum proc_keywords {
   kwDEFINEKEY,
   kwSHOWPAGE,
   kwTHROW,
+  kwRNDFILL,
+  kwGETPIXELS,
+  kwPUTPIXELS,
   kwNULLPROC
 };
 
@@ -403,6 +407,17 @@ enum func_keywords {
   kwIMAGE,
   kwFORM,
   kwTIMESTAMP,
+  kwACCEPT,
+  kwPOLL,
+  kwDIRWALKF,
+  kwAREAD,
+  kwAWRITE,
+  kwATLOAD,
+  kwADONE,
+  kwAWAIT,
+  kwREMATCH,
+  kwREMATCHALL,
+  kwRESUB,
   kwNULLFUNC
 };
 
@@ -81,8 +81,8 @@ void cmd_plot() {
 
   if (!prog_error) {
     // draw
-    chart_draw(0, 0, os_graf_mx, os_graf_my, yt, count, xt, count, 5
-    /* points */, 2 /* ruler */);
+    chart_draw(0, 0, os_graf_mx, os_graf_my, yt, count, xt, count,
+               count > 1 ? 1 /* lines */ : 5 /* points */, 2 /* ruler */);
 //      for ( i = 0; i < count; i ++ )  
 //              dev_setpixel(i, (yt[i] - ymin) * ystep);
   }
@@ -111,14 +111,14 @@ void exec_usefunc(var_t *var, bcip_t ip) {
   var_t *old_x = v_clone(tvar[SYSVAR_X]);
 
   // run
-  v_set(tvar[SYSVAR_X], var);
-  v_free(var);
+  v_move(tvar[SYSVAR_X], var);
+  // no free after v_move
+  v_init(var);
   code_jump(ip);
   eval(var);
 
   // restore X
-  v_set(tvar[SYSVAR_X], old_x);
-  v_free(old_x);
+  v_move(tvar[SYSVAR_X], old_x);
   v_detach(old_x);
 }
 
@@ -439,6 +439,11 @@ var_t *par_next_str(var_t *arg, int sep) {
     result = NULL;
   } else if (code_isvar()) {
     result = code_getvarptr();
+    if (result->type != V_STR) {
+      v_set(arg, result);
+      v_tostr(arg);
+      result = arg;
+    }
   } else {
     eval(arg);
     result = arg;
@@ -46,7 +46,6 @@ void err_stack_msg() {
     stknode_t node = prog_stack[i_stack - 1];
     switch (node.type) {
     case 0xFF:
-    case kwBYREF:
     case kwTYPE_CRVAR:
       // ignore these types
       break;
@@ -62,6 +62,14 @@ const int LEN_CONST      = STRLEN(LCN_CONST);
 #define GROWSIZE 128
 #define MAX_PARAMS 256
 
+// the longest FUNC expression that is inlined
+#define INLINE_SIZE 128
+
+// the last statement compiled as a call of the SUB to itself, replaced
+// with kwTYPE_CALL_TAIL when nothing else follows before END
+static bcip_t comp_tail_ip = INVALID_ADDR;
+static bcip_t comp_tail_end;
+
 // the offset to a single byte stored in an 32 bit field
 #if defined(CPU_BIGENDIAN)
  #define BYTE_OFFSET_IN_32 4
@@ -437,6 +445,8 @@ bid_t comp_add_udp(const char *proc_name) {
       comp_udptable[comp_udpcount].level = comp_block_level;
       comp_udptable[comp_udpcount].block_id = comp_block_id;
       comp_udptable[comp_udpcount].pline = comp_line;
+      comp_udptable[comp_udpcount].byref = 0;
+      comp_udptable[comp_udpcount].expr = NULL;
       strcpy(comp_udptable[comp_udpcount].name, name);
       idx = comp_udpcount;
       comp_udpcount++;
@@ -1162,6 +1172,346 @@ char *comp_scan_json(char *json, bc_t *bc) {
   return p;
 }
 
+/*
+ * returns whether the character is part of a name (see comp_next_word)
+ */
+static inline int comp_is_name_char(char c) {
+  return is_alnum(c) || c == '_' || c == '.' || c == '$';
+}
+
+/*
+ * returns the end of the string literal starting at p
+ */
+static const char *comp_skip_str(const char *p) {
+  p++;
+  while (*p && *p != '"') {
+    p++;
+  }
+  return *p ? p + 1 : p;
+}
+
+/*
+ * returns the matching right parenthesis of the left parenthesis at p, or NULL
+ */
+static const char *comp_matching_par(const char *p) {
+  int level = 0;
+  while (*p) {
+    if (*p == '"') {
+      p = comp_skip_str(p);
+      continue;
+    }
+    if (*p == '(' || *p == '[' || *p == '{') {
+      level++;
+    } else if (*p == ')' || *p == ']' || *p == '}') {
+      if (--level == 0) {
+        return *p == ')' ? p : NULL;
+      }
+    }
+    p++;
+  }
+  return NULL;
+}
+
+/*
+ * returns whether the argument is a plain variable name. builtins without
+ * parameters, such as RND or TIMER, may give another value for each use.
+ */
+static int comp_inline_is_name(const char *arg) {
+  char name[SB_KEYWORD_SIZE + 1];
+  const char *p = arg;
+  if (!is_alpha(*p) && *p != '_') {
+    return 0;
+  }
+  while (comp_is_name_char(*p)) {
+    p++;
+  }
+  if (*p != '\0' || p - arg > SB_KEYWORD_SIZE) {
+    return 0;
+  }
+  strcpy(name, arg);
+  return (comp_udp_id(name, 1) == -1 &&
+          comp_is_keyword(name) == -1 &&
+          comp_is_func(name) == -1 &&
+          comp_is_proc(name) == -1 &&
+          comp_is_operator(name) == -1 &&
+          comp_is_special_operator(name) == -1 &&
+          comp_is_external_func(name) == -1 &&
+          comp_is_external_proc(name) == -1);
+}
+
+/*
+ * returns whether evaluating the argument more than once, or in another
+ * order, gives the same result: a variable, a number or a string
+ */
+static int comp_inline_is_simple(const char *arg) {
+  if (*arg == '"') {
+    return *comp_skip_str(arg) == '\0';
+  }
+  if (is_digit(*arg) || *arg == '.') {
+    while (comp_is_name_char(*arg)) {
+      arg++;
+    }
+    return *arg == '\0';
+  }
+  return comp_inline_is_name(arg);
+}
+
+/*
+ * returns whether the text refers to a SUB/FUNC
+ */
+static int comp_inline_has_udp(const char *p) {
+  char name[SB_KEYWORD_SIZE + 1];
+  while (*p) {
+    if (*p == '"') {
+      p = comp_skip_str(p);
+    } else if (comp_is_name_char(*p)) {
+      int len = 0;
+      while (comp_is_name_char(*p)) {
+        if (len < SB_KEYWORD_SIZE) {
+          name[len++] = *p;
+        }
+        p++;
+      }
+      name[len] = '\0';
+      if (is_alpha(name[0]) && comp_udp_id(name, 1) != -1) {
+        return 1;
+      }
+    } else {
+      p++;
+    }
+  }
+  return 0;
+}
+
+/*
+ * appends the expression of the inline FUNC with the parameters replaced by
+ * the arguments. returns 0 when the call can't be inlined.
+ */
+static int comp_inline_expr(cstr *out, const char *expr, char_p_t *args, int argc) {
+  char pars[INLINE_SIZE + 1];
+  char_p_t names[MAX_PARAMS];
+  int uses[MAX_PARAMS];
+  int count = 0;
+
+  const char *body = strchr(expr, '=');
+  strlcpy(pars, expr, body - expr + 1);
+  body++;
+  if (pars[0]) {
+    names[count++] = pars;
+    for (char *p = pars; *p; p++) {
+      if (*p == ',') {
+        *p = '\0';
+        names[count++] = p + 1;
+      }
+    }
+  }
+  if (count != argc) {
+    return 0;
+  }
+  for (int i = 0; i < argc; i++) {
+    uses[i] = 0;
+    if (!comp_inline_is_simple(args[i]) && comp_inline_has_udp(args[i])) {
+      // the argument calls a SUB/FUNC
+      return 0;
+    }
+  }
+
+  cstr cs;
+  cstr_init(&cs, strlen(body) + 3);
+  cstr_append(&cs, "(");
+
+  int result = 1;
+  int last = -1;
+  int shortcut = 0;
+  const char *p = body;
+  while (*p && result) {
+    if (*p == '"') {
+      const char *end = comp_skip_str(p);
+      cstr_append_i(&cs, p, end - p);
+      p = end;
+    } else if (is_alpha(*p) || *p == '_') {
+      const char *word = p;
+      int hex = (p > body && p[-1] == '&');
+      int addr = (p > body && p[-1] == '@');
+      while (comp_is_name_char(*p)) {
+        p++;
+      }
+      int len = p - word;
+      const char *dot = memchr(word, '.', len);
+      int head = dot ? dot - word : len;
+      int par = -1;
+      for (int i = 0; i < argc && !hex; i++) {
+        if ((int)strlen(names[i]) == head && strncmp(names[i], word, head) == 0) {
+          par = i;
+          break;
+        }
+      }
+      if (par != -1 && addr) {
+        // address of a parameter
+        result = 0;
+      } else if (par != -1) {
+        const char *next = p;
+        SKIP_SPACES(next);
+        uses[par]++;
+        if (!comp_inline_is_simple(args[par])) {
+          // the arguments must still be evaluated in order
+          result = (par > last);
+          last = par;
+        }
+        if (dot || *next == '(' || *next == '[') {
+          // array element or field: the argument must be a variable
+          result = result && comp_inline_is_name(args[par]);
+          cstr_append(&cs, args[par]);
+          cstr_append_i(&cs, word + head, len - head);
+        } else {
+          cstr_append(&cs, "(");
+          cstr_append(&cs, args[par]);
+          cstr_append(&cs, ")");
+        }
+      } else {
+        char name[SB_KEYWORD_SIZE + 1];
+        strlcpy(name, word, len < SB_KEYWORD_SIZE ? len + 1 : SB_KEYWORD_SIZE + 1);
+        if (!hex && comp_udp_id(name, 1) != -1) {
+          // calls a SUB/FUNC, including itself
+          result = 0;
+        } else if (!strcmp(name, "AND") || !strcmp(name, "OR") || !strcmp(name, "IFF")) {
+          shortcut = 1;
+        }
+        cstr_append_i(&cs, word, len);
+      }
+    } else if (comp_is_name_char(*p)) {
+      // number
+      const char *num = p;
+      while (comp_is_name_char(*p)) {
+        p++;
+      }
+      cstr_append_i(&cs, num, p - num);
+    } else {
+      cstr_append_i(&cs, p++, 1);
+    }
+  }
+  cstr_append(&cs, ")");
+
+  for (int i = 0; i < argc && result; i++) {
+    if (!comp_inline_is_simple(args[i]) && (uses[i] != 1 || shortcut)) {
+      // the argument would be evaluated more than once, or maybe not at all
+      result = 0;
+    }
+  }
+  if (result) {
+    cstr_append(out, cs.buf);
+  }
+  free(cs.buf);
+  return result;
+}
+
+/*
+ * replaces the calls of single-line FUNCs in the expression with the FUNC's
+ * expression. returns NULL when there is nothing to replace.
+ */
+static char *comp_inline(const char *expr) {
+  cstr out;
+  int changed = 0;
+  const char *p = expr;
+
+  cstr_init(&out, strlen(expr) + 1);
+  while (*p) {
+    if (*p == '"') {
+      const char *end = comp_skip_str(p);
+      cstr_append_i(&out, p, end - p);
+      p = end;
+    } else if (is_alpha(*p) || *p == '_') {
+      char name[SB_KEYWORD_SIZE + 1];
+      const char *word = p;
+      int prefix = (p > expr && (p[-1] == '&' || p[-1] == '@'));
+      while (comp_is_name_char(*p)) {
+        p++;
+      }
+      strlcpy(name, word, p - word < SB_KEYWORD_SIZE ? p - word + 1 : SB_KEYWORD_SIZE + 1);
+      bid_t udp = prefix || strchr(name, '.') ? -1 : comp_udp_id(name, 1);
+      const char *next = p;
+      SKIP_SPACES(next);
+      if (udp != -1 && *next == '(') {
+        const char *end = comp_matching_par(next);
+        if (end != NULL) {
+          // split the arguments, inlining any calls in them first
+          char *text = malloc(end - next);
+          char_p_t args[MAX_PARAMS];
+          int argc = 0;
+          int overflow = 0;
+          strlcpy(text, next + 1, end - next);
+          char *arg = text;
+          for (char *a = text; !overflow; a++) {
+            if (*a == '"') {
+              a = (char *)comp_skip_str(a) - 1;
+            } else if (*a == '(' || *a == '[' || *a == '{') {
+              const char *close = comp_matching_par(a);
+              a = close != NULL ? (char *)close : a + strlen(a) - 1;
+            } else if (argc == MAX_PARAMS) {
+              overflow = 1;
+            } else if (*a == ',' || *a == '\0') {
+              int last = (*a == '\0');
+              *a = '\0';
+              str_alltrim(arg);
+              char *inlined = comp_inline(arg);
+              args[argc++] = inlined != NULL ? inlined : strdup(arg);
+              changed |= (inlined != NULL);
+              arg = a + 1;
+              if (last) {
+                break;
+              }
+            }
+          }
+          if (argc == 1 && args[0][0] == '\0') {
+            free(args[0]);
+            argc = 0;
+          }
+          if (overflow) {
+            cstr_append_i(&out, word, end + 1 - word);
+          } else if (comp_udptable[udp].expr != NULL &&
+                     comp_inline_expr(&out, comp_udptable[udp].expr, args, argc)) {
+            changed = 1;
+          } else {
+            cstr_append_i(&out, word, next - word);
+            cstr_append(&out, "(");
+            for (int i = 0; i < argc; i++) {
+              cstr_append(&out, i ? "," : "");
+              cstr_append(&out, args[i]);
+            }
+            cstr_append(&out, ")");
+          }
+          for (int i = 0; i < argc; i++) {
+            free(args[i]);
+          }
+          free(text);
+          p = end + 1;
+          continue;
+        }
+      } else if (udp != -1 && comp_udptable[udp].expr != NULL && *next != '.' && *next != '[' &&
+                 comp_inline_expr(&out, comp_udptable[udp].expr, NULL, 0)) {
+        changed = 1;
+        continue;
+      }
+      cstr_append_i(&out, word, p - word);
+    } else if (comp_is_name_char(*p)) {
+      // number
+      const char *num = p;
+      while (comp_is_name_char(*p)) {
+        p++;
+      }
+      cstr_append_i(&out, num, p - num);
+    } else {
+      cstr_append_i(&out, p++, 1);
+    }
+  }
+
+  if (!changed || out.length > SB_SOURCELINE_SIZE) {
+    free(out.buf);
+    return NULL;
+  }
+  return out.buf;
+}
+
 /*
  * scan expression
  */
@@ -1180,6 +1530,11 @@ void comp_expression(char *expr, byte no_parser) {
     return;
   }
 
+  char *inlined = comp_inline(expr);
+  if (inlined != NULL) {
+    ptr = inlined;
+  }
+
   bc_create(&bc);
 
   while (*ptr) {
@@ -1473,6 +1828,7 @@ void comp_expression(char *expr, byte no_parser) {
   // clean-up
   comp_use_global_vartable = 0; // check local-variables first
   bc_destroy(&bc);
+  free(inlined);
 
   // do additional steps
   if (kw_exec_more) {
@@ -2224,6 +2580,7 @@ void comp_text_line_func(bid_t idx, int decl) {
                 comp_prepare_name(vname, pars[i] + 6, SB_KEYWORD_SIZE);
               }
               vattr = 0x80;
+              comp_udptable[pidx].byref = 1;
             } else {
               comp_prepare_name(vname, pars[i], SB_KEYWORD_SIZE);
               vattr = 0;
@@ -2468,6 +2825,28 @@ void comp_insert_locals() {
 }
 
 
+/*
+ * a SUB calling itself as its last statement restarts the SUB
+ */
+void comp_text_line_tail_sub() {
+  if (comp_tail_ip != INVALID_ADDR && comp_tail_end <= comp_prog.count) {
+    bcip_t ip = comp_tail_end;
+    while (ip < comp_prog.count) {
+      if (comp_prog.ptr[ip] == kwTYPE_EOC) {
+        ip++;
+      } else if (comp_prog.ptr[ip] == kwTYPE_LINE) {
+        ip += KW_TYPE_LINE_BYTES;
+      } else {
+        break;
+      }
+    }
+    if (ip == comp_prog.count && comp_prog.ptr[comp_tail_ip] == kwTYPE_CALL_UDP) {
+      comp_prog.ptr[comp_tail_ip] = kwTYPE_CALL_TAIL;
+    }
+  }
+  comp_tail_ip = INVALID_ADDR;
+}
+
 void comp_text_line_end(bid_t idx) {
   if (strncmp(comp_bc_parm, LCN_IF, 2) == 0 ||
       strncmp(comp_bc_parm, LCN_TRY, 3) == 0 ||
@@ -2492,6 +2871,7 @@ void comp_text_line_end(bid_t idx) {
     } else {
       *comp_bc_proc = '\0';
     }
+    comp_text_line_tail_sub();
     if (opt_autolocal) {
       comp_insert_locals();
     }
@@ -2525,6 +2905,7 @@ void comp_text_line_ext_func() {
     if (udp == -1) {
       udp = comp_add_udp(comp_bc_name);
     }
+    bcip_t call_ip = comp_prog.count;
     comp_push(comp_prog.count);
     bc_add_ctrl(&comp_prog, kwTYPE_CALL_UDP, udp, 0);
     char *next = trim_empty_parentheses(comp_bc_parm);
@@ -2535,7 +2916,50 @@ void comp_text_line_ext_func() {
       comp_expression(next, 0);
       bc_add_code(&comp_prog, kwTYPE_LEVEL_END);
     }
+    if (udp != -1 && strcmp(comp_udptable[udp].name, comp_bc_proc) == 0 &&
+        comp_udptable[udp].vid == (bid_t) INVALID_ADDR && !comp_udptable[udp].byref) {
+      // the SUB calls itself, see comp_text_line_end
+      // any trailing EOC may later be overwritten by kwTYPE_LINE
+      comp_tail_ip = call_ip;
+      comp_tail_end = comp_prog.count;
+      if (comp_prog.eoc_position == comp_tail_end - 1) {
+        comp_tail_end--;
+      }
+    }
+  }
+}
+
+/*
+ * RETURN f(...) in FUNC f: compiles a call that restarts the FUNC with the
+ * new arguments. returns 0 when the expression is not such a call.
+ */
+int comp_text_line_tail_call(char *expr) {
+  char name[SB_KEYWORD_SIZE + 1];
+  char *p = (char *)comp_next_word(expr, name);
+  bid_t udp = comp_udp_id(name, 1);
+  if (udp == -1 || strcmp(comp_udptable[udp].name, comp_bc_proc) != 0 ||
+      comp_udptable[udp].vid == (bid_t) INVALID_ADDR || comp_udptable[udp].byref) {
+    return 0;
+  }
+  if (*p == '(') {
+    const char *end = comp_matching_par(p);
+    if (end == NULL || *comp_next_char((char *)end + 1) != '\0') {
+      return 0;
+    }
+  } else if (*p != '\0') {
+    return 0;
   }
+
+  comp_push(comp_prog.count);
+  bc_add_ctrl(&comp_prog, kwTYPE_CALL_TAIL, udp, 0);
+  char *next = trim_empty_parentheses(p);
+  if (*next) {
+    comp_expression(next, 0);
+  } else {
+    bc_add_code(&comp_prog, kwTYPE_LEVEL_BEGIN);
+    bc_add_code(&comp_prog, kwTYPE_LEVEL_END);
+  }
+  return 1;
 }
 
 int comp_text_line_command(bid_t idx, int decl, int sharp, char *last_cmd) {
@@ -2793,6 +3217,10 @@ int comp_text_line_command(bid_t idx, int decl, int sharp, char *last_cmd) {
     break;
 
   case kwRETURN:
+    if (comp_bc_proc[0] && comp_bc_parm[0] && comp_text_line_tail_call(comp_bc_parm)) {
+      // RETURN f(...) restarts f
+      break;
+    }
     if (comp_bc_proc[0]) {
       // synonym for FUNC=result
       if (comp_bc_parm[0]) {
@@ -3039,6 +3467,7 @@ bcip_t comp_next_bc_cmd(bc_t *bc, bcip_t ip) {
     break;
   case kwTYPE_PTR:
   case kwTYPE_CALL_UDP:
+  case kwTYPE_CALL_TAIL:
   case kwTYPE_CALL_UDF:        // [true-ip][false-ip]
     ip += BC_CTRLSZ;
     break;
@@ -3345,6 +3774,7 @@ void comp_pass2_scan() {
         code != kwTYPE_PTR &&
         code != kwTYPE_CALL_UDP &&
         code != kwTYPE_CALL_UDF &&
+        code != kwTYPE_CALL_TAIL &&
         code != kwPROC &&
         code != kwFUNC &&
         code != kwTRY &&
@@ -3382,6 +3812,7 @@ void comp_pass2_scan() {
     case kwTYPE_PTR:
     case kwTYPE_CALL_UDP:
     case kwTYPE_CALL_UDF:
+    case kwTYPE_CALL_TAIL:
       memcpy(&label_id, comp_prog.ptr + node->pos + 1, ADDRSZ);
       if (label_id < comp_udpcount) {
         // update real IP
@@ -3874,6 +4305,7 @@ void comp_close() {
 
   for (i = 0; i < comp_udpcount; i++) {
     free(comp_udptable[i].name);
+    free(comp_udptable[i].expr);
   }
   free(comp_udptable);
 
@@ -4501,16 +4933,83 @@ void comp_preproc_sbasicpath(char *p) {
   }
 }
 
+/**
+ * keeps the parameters and the expression of a small single-line FUNC, its
+ * calls are then replaced with the expression (see comp_inline)
+ */
+void comp_preproc_inline(bid_t idx, const char *p) {
+  char expr[INLINE_SIZE + 1];
+  int len = 0;
+
+  SKIP_SPACES(p);
+  if (*p == '(') {
+    // plain BYVAL parameters only
+    p++;
+    SKIP_SPACES(p);
+    while (*p != ')') {
+      const char *name = p;
+      while (is_alnum(*p) || *p == '_' || *p == '$') {
+        p++;
+      }
+      if (p == name || is_digit(*name) || len + (p - name) + 1 > INLINE_SIZE) {
+        return;
+      }
+      memcpy(expr + len, name, p - name);
+      len += p - name;
+      SKIP_SPACES(p);
+      if (*p == ',') {
+        expr[len++] = ',';
+        p++;
+        SKIP_SPACES(p);
+      } else if (*p != ')') {
+        return;
+      }
+    }
+    p++;
+    SKIP_SPACES(p);
+  }
+  if (*p != '=') {
+    return;
+  }
+  expr[len++] = '=';
+  p++;
+  SKIP_SPACES(p);
+
+  // a single expression, without maps or remarks
+  const char *body = p;
+  while (*p && *p != '\n') {
+    if (*p == '"') {
+      p = comp_skip_str(p);
+    } else if (strchr(":'{\\", *p)) {
+      return;
+    } else {
+      p++;
+    }
+  }
+  while (p > body && is_space(p[-1])) {
+    p--;
+  }
+  if (p == body || len + (p - body) > INLINE_SIZE) {
+    return;
+  }
+  memcpy(expr + len, body, p - body);
+  len += p - body;
+  expr[len] = '\0';
+  comp_udptable[idx].expr = strdup(expr);
+}
+
 /**
  * SUB/FUNC/DEF - Automatic declaration - BEGIN
  */
 char *comp_preproc_func_begin(char *p) {
   char *dp;
   int single_line_f = 0;
+  int is_sub = 0;
   char pname[SB_KEYWORD_SIZE + 1];
 
   if (strncmp(LCN_SUB_WRS, p, LEN_SUB_WRS) == 0) {
     p += LEN_SUB_WRS;
+    is_sub = 1;
   } else if (strncmp(LCN_FUNC_WRS, p, LEN_FUNC_WRS) == 0) {
     p += LEN_FUNC_WRS;
   } else {
@@ -4524,6 +5023,7 @@ char *comp_preproc_func_begin(char *p) {
     *dp++ = *p++;
   }
   *dp = '\0';
+  const char *decl = p;
 
   // search for '='
   while (*p != '\n' && *p != '=') {
@@ -4538,7 +5038,10 @@ char *comp_preproc_func_begin(char *p) {
 
   // add declaration
   if (comp_udp_getip(pname) == INVALID_ADDR) {
-    comp_add_udp(pname);
+    bid_t idx = comp_add_udp(pname);
+    if (single_line_f && !is_sub && idx != -1) {
+      comp_preproc_inline(idx, decl);
+    }
   } else {
     sc_raise(MSG_UDP_ALREADY_DECL, pname);
   }
@@ -4965,6 +5468,9 @@ int comp_save_bin(byte_code bc) {
   if (h != -1) {
     write(h, (char *)bc.code, bc.size);
     close(h);
+    if (comp_unit_flag) {
+      unit_image_forget(fname);
+    }
     if (!opt_quiet) {
       log_printf(MSG_BC_FILE_CREATED, fname);
     }
@@ -156,6 +156,8 @@ struct comp_proc_s {
   bid_t block_id; /**< block_id (FOR-NEXT,IF-FI,etc) used for GOTOs @ingroup scan */
   int pline; /**< source code line number       @ingroup scan */
   byte level; /**< block level (used for GOTOs) @ingroup scan */
+  byte byref; /**< has BYREF parameters (no tail calls) @ingroup scan */
+  char *expr; /**< "par1,par2=expression" of an inline FUNC, or NULL @ingroup scan */
 };
 
 typedef struct comp_proc_s comp_udp_t;
@@ -15,10 +15,6 @@
 #include "common/sberr.h"
 #include "common/blib.h"
 
-#define W2X(x) (((((x) - dev_Wx1) * dev_Vdx) / dev_Wdx) + dev_Vx1)
-#define W2Y(y) (((((y) - dev_Wy1) * dev_Vdy) / dev_Wdy) + dev_Vy1)
-#define X2W(x) (((((x) - dev_Vx1) * dev_Wdx) / dev_Vdx) + dev_Wx1)
-#define Y2W(y) (((((y) - dev_Vy1) * dev_Wdy) / dev_Vdy) + dev_Wy1)
 #define W2D2(x,y) { (x) = W2X((x)); (y) = W2Y((y)); }
 #define W2D4(x1,y1,x2,y2) { W2D2((x1),(y1)); W2D2((x2),(y2)); }
 #define CLIPENCODE(x,y,c) { c = (x < dev_Vx1); \
@@ -209,6 +205,35 @@ long dev_getpixel(int x, int y) {
   return 0;
 }
 
+/**
+ * returns the values of a rectangle of pixels
+ */
+void dev_getpixels(int x, int y, int w, int h, int *pixels) {
+  if (!osd_getpixels(x, y, w, h, pixels)) {
+    for (int j = 0; j < h; j++) {
+      for (int i = 0; i < w; i++) {
+        *pixels++ = osd_getpixel(x + i, y + j);
+      }
+    }
+  }
+}
+
+/**
+ * draws the values of a rectangle of pixels
+ */
+void dev_setpixels(int x, int y, int w, int h, const int *pixels) {
+  if (!osd_setpixels(x, y, w, h, pixels)) {
+    long pcolor = dev_fgcolor;
+    for (int j = 0; j < h; j++) {
+      for (int i = 0; i < w; i++) {
+        dev_setcolor(*pixels++);
+        osd_setpixel(x + i, y + j);
+      }
+    }
+    dev_setcolor(pcolor);
+  }
+}
+
 /**
  * Cohen-Sutherland clipping
  */
@@ -281,6 +306,56 @@ void dev_line(int x1, int y1, int x2, int y2) {
   }
 }
 
+/*
+ * passes the connected lines to the driver
+ */
+static void dev_drawpath(const int *points, int count) {
+  if (count > 1 && !osd_polyline(points, count)) {
+    for (int i = 1; i < count; i++) {
+      osd_line(points[i * 2 - 2], points[i * 2 - 1], points[i * 2], points[i * 2 + 1]);
+    }
+  }
+}
+
+/**
+ * draw lines joining the points
+ */
+void dev_polyline(const ipt_t *pts, int count) {
+  int *points = malloc(sizeof(int) * count * 2);
+  if (points == NULL) {
+    for (int i = 1; i < count; i++) {
+      dev_line(pts[i - 1].x, pts[i - 1].y, pts[i].x, pts[i].y);
+    }
+    return;
+  }
+
+  int n = 0;
+  for (int i = 1; i < count; i++) {
+    int x1 = pts[i - 1].x;
+    int y1 = pts[i - 1].y;
+    int x2 = pts[i].x;
+    int y2 = pts[i].y;
+    int visible;
+
+    W2D4(x1, y1, x2, y2);
+    dev_clipline(&x1, &y1, &x2, &y2, &visible);
+    if (visible) {
+      if (!n || points[n * 2 - 2] != x1 || points[n * 2 - 1] != y1) {
+        // clipped or not connected to the previous line
+        dev_drawpath(points, n);
+        points[0] = x1;
+        points[1] = y1;
+        n = 1;
+      }
+      points[n * 2] = x2;
+      points[n * 2 + 1] = y2;
+      n++;
+    }
+  }
+  dev_drawpath(points, n);
+  free(points);
+}
+
 void dev_ellipse(int xc, int yc, int xr, int yr, double aspect, int fill) {
   osd_ellipse(W2X(xc), W2Y(yc), xr, yr * aspect, fill);
 }
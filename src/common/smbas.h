@@ -119,6 +119,7 @@ EXTERN byte opt_mute_audio; /**< whether to mute sounds                      */
 EXTERN byte opt_antialias; /**< OPTION ANTIALIAS OFF                         */
 EXTERN byte opt_autolocal; /**< OPTION AUTOLOCAL                             */
 EXTERN byte opt_trace_on; /**< initial value for the TRON command            */
+EXTERN uint32_t opt_stack_max; /**< program stack limit, 0 for default       */
 
 #define IDE_NONE        0
 #define IDE_INTERNAL    1
@@ -151,6 +152,7 @@ EXTERN char gsb_last_errmsg[SB_ERRMSG_SIZE + 1]; /**< last error message     */
 #define data_org            ctask->sbe.exec.org
 #define prog_stack          ctask->sbe.exec.stack
 #define prog_stack_alloc    ctask->sbe.exec.stack_alloc
+#define prog_stack_peak     ctask->sbe.exec.stack_peak
 #define prog_sp             ctask->sbe.exec.sp
 #define eval_stk            ctask->sbe.exec.eval_stk
 #define eval_stk_size       ctask->sbe.exec.eval_stk_size
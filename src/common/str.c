@@ -12,6 +12,12 @@
 
 #define BUF_SIZE 256
 
+// needles from this length are searched with Horspool's shift table
+#define FIND_SHIFT_MIN 4
+
+// haystacks shorter than this don't repay building the shift table
+#define FIND_SHIFT_TEXT 128
+
 /**
  * removes spaces and returns a new string
  */
@@ -95,50 +101,134 @@ int strcaselessn(const char *s1, int s1n, const char *s2, int s2n) {
 }
 
 /**
- * transdup
+ * forward search, the first byte located with memchr
  */
-char *transdup(const char *src, const char *what, const char *with, int ignore_case) {
-  int lwhat = strlen(what);
-  int lwith = strlen(with);
-  int size = BUF_SIZE;
-  char *p = (char *)src;
-  char *dest = malloc(size);
-  char *d = dest;
-
-  *d = '\0';
-
-  while (*p) {
-    int eq;
-    if (ignore_case) {
-      eq = strncasecmp(p, what, lwhat);
+static const char *str_find_byte(const char *s, int len, const char *needle, int nlen) {
+  const char *end = s + len - nlen;
+  const char *p = s;
+  while (p <= end && (p = memchr(p, *needle, end - p + 1)) != NULL) {
+    if (memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+      return p;
     }
-    else {
-      eq = strncmp(p, what, lwhat);
+    p++;
+  }
+  return NULL;
+}
+
+/**
+ * forward Horspool search: skips by the distance from the last occurrence
+ * of the byte under the end of the window to the end of the needle
+ */
+static const char *str_find_shift(const char *s, int len, const char *needle, int nlen) {
+  int shift[256];
+  const byte *u = (const byte *)s;
+  byte last = needle[nlen - 1];
+  for (int i = 0; i < 256; i++) {
+    shift[i] = nlen;
+  }
+  for (int i = 0; i < nlen - 1; i++) {
+    shift[(byte)needle[i]] = nlen - 1 - i;
+  }
+  for (int pos = 0; pos <= len - nlen;) {
+    byte c = u[pos + nlen - 1];
+    if (c == last && memcmp(s + pos, needle, nlen - 1) == 0) {
+      return s + pos;
     }
-    if (eq == 0) {
-      if ((d - dest) + lwith >= size - 1) {
-        int len = d - dest;
-        size += BUF_SIZE;
-        dest = realloc(dest, size);
-        d = dest + len;
+    pos += shift[c];
+  }
+  return NULL;
+}
+
+const char *str_find(const char *s, int len, const char *needle, int nlen, int ignore_case) {
+  const char *result = NULL;
+  if (nlen <= 0) {
+    result = s;
+  } else if (nlen > len) {
+    result = NULL;
+  } else if (ignore_case) {
+    char first = to_lower(*needle);
+    for (const char *p = s, *end = s + len - nlen; p <= end; p++) {
+      if (to_lower(*p) == first && strcaselessn(p, nlen, needle, nlen) == 0) {
+        result = p;
+        break;
       }
-      memcpy(d, with, lwith);
-      d += lwith;
-      p += (lwhat - 1);
-    } else {
-      if ((d - dest) + 1 >= size - 1) {
-        int len = d - dest;
-        size += BUF_SIZE;
-        dest = realloc(dest, size);
-        d = dest + len;
+    }
+  } else if (nlen < FIND_SHIFT_MIN || len < FIND_SHIFT_TEXT) {
+    result = str_find_byte(s, len, needle, nlen);
+  } else {
+    result = str_find_shift(s, len, needle, nlen);
+  }
+  return result;
+}
+
+const char *str_rfind(const char *s, int len, const char *needle, int nlen) {
+  if (nlen <= 0) {
+    return s + len;
+  } else if (nlen > len) {
+    return NULL;
+  }
+  if (nlen < FIND_SHIFT_MIN || len < FIND_SHIFT_TEXT) {
+    for (int pos = len - nlen; pos >= 0; pos--) {
+      if (s[pos] == *needle && memcmp(s + pos + 1, needle + 1, nlen - 1) == 0) {
+        return s + pos;
       }
-      *d = *p;
-      d++;
     }
-    p++;
+    return NULL;
   }
 
-  *d = '\0';
+  // Horspool mirrored: the window moves left, keyed by the byte under its start
+  int shift[256];
+  const byte *u = (const byte *)s;
+  byte first = needle[0];
+  for (int i = 0; i < 256; i++) {
+    shift[i] = nlen;
+  }
+  for (int i = nlen - 1; i > 0; i--) {
+    shift[(byte)needle[i]] = i;
+  }
+  for (int pos = len - nlen; pos >= 0;) {
+    byte c = u[pos];
+    if (c == first && memcmp(s + pos + 1, needle + 1, nlen - 1) == 0) {
+      return s + pos;
+    }
+    pos -= shift[c];
+  }
+  return NULL;
+}
+
+/**
+ * transdup
+ */
+char *transdup(const char *src, const char *what, const char *with, int ignore_case) {
+  int lsrc = strlen(src);
+  int lwhat = strlen(what);
+  int lwith = strlen(with);
+  if (lwhat == 0) {
+    return strdup(src);
+  }
+
+  int size = lsrc + 1;
+  int len = 0;
+  char *dest = malloc(size);
+  const char *p = src;
+  const char *end = src + lsrc;
+  const char *next;
+
+  while ((next = str_find(p, end - p, what, lwhat, ignore_case)) != NULL) {
+    int need = len + (next - p) + lwith + (end - next - lwhat) + 1;
+    if (need > size) {
+      size = need + (need >> 1);
+      dest = realloc(dest, size);
+    }
+    memcpy(dest + len, p, next - p);
+    len += next - p;
+    memcpy(dest + len, with, lwith);
+    len += lwith;
+    p = next + lwhat;
+  }
+  memcpy(dest + len, p, end - p);
+  len += end - p;
+  dest[len] = '\0';
   return dest;
 }
 
@@ -154,6 +244,10 @@ char *q_strstr(const char *s1, const char *s2, const char *pairs) {
   l2 = strlen(s2);
   wait_q = open_q = level_q = 0;
 
+  if (*pairs == '\0' && l2) {
+    return (char *)str_find(s1, strlen(s1), s2, l2, 0);
+  }
+
   while (*p) {
     if (*p == wait_q) {         // i am waiting that. level down
       level_q--;
@@ -184,7 +278,7 @@ char *q_strstr(const char *s1, const char *s2, const char *pairs) {
         }
       }
     } else if (wait_q == 0) {     // it is a regular character
-      if (strncmp(p, s2, l2) == 0) {
+      if (*p == *s2 && strncmp(p, s2, l2) == 0) {
         return p;
       }
     }
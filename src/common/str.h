@@ -266,6 +266,28 @@ int strcaselessn(const char *s1, int s1n, const char *s2, int s2n);
  */
 char *q_strstr(const char *s1, const char *s2, const char *pairs);
 
+/**
+ * @ingroup str
+ *
+ * locate the first occurrence of 'needle' in the first 'len' bytes of 's'.
+ * the text may contain NUL characters.
+ *
+ * @param s the text
+ * @param len the length of the text
+ * @param needle the substring
+ * @param nlen the length of the substring
+ * @param ignore_case whether to compare ASCII letters caselessly
+ * @return a pointer into 's' or NULL if not found
+ */
+const char *str_find(const char *s, int len, const char *needle, int nlen, int ignore_case);
+
+/**
+ * @ingroup str
+ *
+ * as str_find but returns the last occurrence, scanning backwards
+ */
+const char *str_rfind(const char *s, int len, const char *needle, int nlen);
+
 /**
  * @ingroup str
  *
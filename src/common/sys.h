@@ -80,7 +80,9 @@ extern "C" {
 #define SB_KEYWORD_SIZE     128
 #define SB_SOURCELINE_SIZE  65536 // compiler
 #define SB_TEXTLINE_SIZE    8192  // RTL
-#define SB_EXEC_STACK_SIZE  1024  // executor's stack size
+#define SB_EXEC_STACK_SIZE  1024  // executor's initial stack size
+#define SB_EXEC_STACK_MAX   0x40000 // executor's default stack limit
+#define SB_EXEC_NEST_MAX    1024  // executor's limit of nested function calls
 #define SB_EVAL_STACK_SIZE  16    // evaluation stack size
 #define SB_KW_NONE_STR "Nil"
 
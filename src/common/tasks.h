@@ -37,6 +37,7 @@ typedef struct {
   bcip_t org; /**< READ/DATA beginning position                      */
   stknode_t *stack; /**< The program stack                           */
   uint32_t stack_alloc; /**< The stack size                          */
+  uint32_t stack_peak; /**< The highest SP reached                  */
   uint32_t sp; /**< Register SP; The stack pointer                   */
   var_t *eval_stk; /**< eval's stack                                 */
   uint16_t eval_stk_size; /**< eval's stack size                     */
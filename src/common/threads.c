@@ -0,0 +1,153 @@
+// This file is part of SmallBASIC
+//
+// Worker threads for runtime services
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#include "common/sys.h"
+#include "common/threads.h"
+
+#if defined(USE_THREADS) && !defined(_Win32)
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+
+struct thread_t {
+  pthread_t id;
+  thread_func_t func;
+  void *data;
+};
+
+struct thread_lock_t {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+static void *thread_main(void *arg) {
+  thread_t *thread = (thread_t *)arg;
+  thread->func(thread->data);
+  return NULL;
+}
+
+int thread_workers() {
+  long n = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (n < 1) {
+    n = 1;
+  } else if (n > THREAD_MAX_WORKERS) {
+    n = THREAD_MAX_WORKERS;
+  }
+  return (int)n;
+}
+
+thread_t *thread_start(thread_func_t func, void *data) {
+  thread_t *result = malloc(sizeof(thread_t));
+  if (result != NULL) {
+    result->func = func;
+    result->data = data;
+    if (pthread_create(&result->id, NULL, thread_main, result) != 0) {
+      free(result);
+      result = NULL;
+    }
+  }
+  return result;
+}
+
+void thread_join(thread_t *thread) {
+  if (thread != NULL) {
+    pthread_join(thread->id, NULL);
+    free(thread);
+  }
+}
+
+thread_lock_t *thread_lock_create() {
+  thread_lock_t *result = malloc(sizeof(thread_lock_t));
+  if (result != NULL) {
+    pthread_mutex_init(&result->mutex, NULL);
+    pthread_cond_init(&result->cond, NULL);
+  }
+  return result;
+}
+
+void thread_lock_destroy(thread_lock_t *lock) {
+  if (lock != NULL) {
+    pthread_cond_destroy(&lock->cond);
+    pthread_mutex_destroy(&lock->mutex);
+    free(lock);
+  }
+}
+
+void thread_lock(thread_lock_t *lock) {
+  pthread_mutex_lock(&lock->mutex);
+}
+
+void thread_unlock(thread_lock_t *lock) {
+  pthread_mutex_unlock(&lock->mutex);
+}
+
+void thread_wait(thread_lock_t *lock, int ms) {
+  if (ms < 0) {
+    pthread_cond_wait(&lock->cond, &lock->mutex);
+  } else {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&lock->cond, &lock->mutex, &ts);
+  }
+}
+
+void thread_notify(thread_lock_t *lock) {
+  pthread_cond_broadcast(&lock->cond);
+}
+
+#else
+
+//
+// single threaded builds: thread_start always fails so that callers run
+// the job inline, locks are no-ops
+//
+struct thread_lock_t {
+  int unused;
+};
+
+int thread_workers() {
+  return 1;
+}
+
+thread_t *thread_start(thread_func_t func, void *data) {
+  return NULL;
+}
+
+void thread_join(thread_t *thread) {
+}
+
+thread_lock_t *thread_lock_create() {
+  return malloc(sizeof(thread_lock_t));
+}
+
+void thread_lock_destroy(thread_lock_t *lock) {
+  free(lock);
+}
+
+void thread_lock(thread_lock_t *lock) {
+}
+
+void thread_unlock(thread_lock_t *lock) {
+}
+
+void thread_wait(thread_lock_t *lock, int ms) {
+}
+
+void thread_notify(thread_lock_t *lock) {
+}
+
+#endif
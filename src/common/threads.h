@@ -0,0 +1,94 @@
+// This file is part of SmallBASIC
+//
+// Worker threads for runtime services. The interpreter itself is single
+// threaded: workers must never touch var_t or the program stack, they
+// exchange plain C structures with the main thread under a thread_lock_t.
+// The exception is reading array elements while the interpreter thread
+// waits in thread_join for the workers to finish.
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#if !defined(_sb_threads_h)
+#define _sb_threads_h
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// upper limit for the number of workers used by a single service
+#define THREAD_MAX_WORKERS 8
+
+typedef struct thread_lock_t thread_lock_t;
+typedef struct thread_t thread_t;
+typedef void (*thread_func_t)(void *data);
+
+/**
+ * @ingroup sys
+ *
+ * returns the number of workers worth starting for a parallel job;
+ * 1 when threads are not supported
+ *
+ * @return the number of workers (1..THREAD_MAX_WORKERS)
+ */
+int thread_workers(void);
+
+/**
+ * @ingroup sys
+ *
+ * starts a thread running func(data)
+ *
+ * @return the thread, or NULL when threads are not supported or failed to
+ * start, in which case the caller should run the job itself
+ */
+thread_t *thread_start(thread_func_t func, void *data);
+
+/**
+ * @ingroup sys
+ *
+ * waits for the thread to finish and releases it
+ */
+void thread_join(thread_t *thread);
+
+/**
+ * @ingroup sys
+ *
+ * creates a lock with an associated condition
+ */
+thread_lock_t *thread_lock_create(void);
+
+/**
+ * @ingroup sys
+ *
+ * releases a lock created with thread_lock_create
+ */
+void thread_lock_destroy(thread_lock_t *lock);
+
+/**
+ * @ingroup sys
+ *
+ * acquires/releases the lock
+ */
+void thread_lock(thread_lock_t *lock);
+void thread_unlock(thread_lock_t *lock);
+
+/**
+ * @ingroup sys
+ *
+ * waits (with the lock held) until another thread calls thread_notify or
+ * until ms milliseconds have elapsed. a negative ms waits indefinitely.
+ */
+void thread_wait(thread_lock_t *lock, int ms);
+
+/**
+ * @ingroup sys
+ *
+ * wakes all threads waiting on the lock
+ */
+void thread_notify(thread_lock_t *lock);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -13,12 +13,34 @@
 #include "common/device.h"
 #include "common/pproc.h"
 #include "common/scan.h"
+#include "common/messages.h"
 #include "common/units.h"
 
 // units table
 static unit_t *units;
 static int unit_count = 0;
 
+// find_unit_path results, kept for the life of the process
+typedef struct unit_path_t {
+  struct unit_path_t *next;
+  char *key;   // name, SBASICPATH and program directory
+  char *path;
+} unit_path_t;
+
+// compiled unit files, shared by every task and run that loads them
+typedef struct unit_image_t {
+  struct unit_image_t *next;
+  char *file;
+  time_t mtime;
+  off_t size;
+  ino_t inode;
+  byte *image;
+  int refs;
+} unit_image_t;
+
+static unit_path_t *unit_paths;
+static unit_image_t *unit_images;
+
 /**
  *   initialization
  */
@@ -53,27 +75,167 @@ void unit_mgr_close() {
  * @return non-zero on success
  */
 int find_unit_path(const char *name, char *file) {
+  const char *env = getenv("SBASICPATH");
+  char key[OS_PATHNAME_SIZE * 3];
+  snprintf(key, sizeof(key), "%s|%s|%s", name, env ? env : "", gsb_bas_dir);
+
+  // a previous search, while the file is still there
+  for (unit_path_t *cached = unit_paths; cached != NULL; cached = cached->next) {
+    if (strcmp(cached->key, key) == 0) {
+      if (access(cached->path, R_OK) == 0) {
+        strcpy(file, cached->path);
+        return 1;
+      }
+      break;
+    }
+  }
+
   strcpy(file, name);
   strcat(file, ".bas");
 
-  // find in unitpath
-  if (getenv("SBASICPATH")) {
-    if (sys_search_path(getenv("SBASICPATH"), file, file)) {
-      return 1;
+  int found =
+    // find in unitpath
+    (env && sys_search_path(env, file, file)) ||
+    // find in program launch directory
+    (gsb_bas_dir[0] && sys_search_path(gsb_bas_dir, file, file)) ||
+    // find in current directory
+    sys_search_path(".", file, file);
+
+  if (found) {
+    unit_path_t *cached = unit_paths;
+    while (cached != NULL && strcmp(cached->key, key) != 0) {
+      cached = cached->next;
+    }
+    if (cached == NULL) {
+      cached = (unit_path_t *)malloc(sizeof(unit_path_t));
+      cached->key = strdup(key);
+      cached->next = unit_paths;
+      unit_paths = cached;
+    } else {
+      free(cached->path);
     }
+    cached->path = strdup(file);
   }
+  return found;
+}
 
-  // find in program launch directory
-  if (gsb_bas_dir[0] && sys_search_path(gsb_bas_dir, file, file)) {
-    return 1;
+/**
+ * returns the compiled unit file from memory, loading it when the file
+ * is new or has changed since it was loaded
+ *
+ * @param file the .sbu file name
+ * @return the image or NULL on error
+ */
+byte *unit_image_load(const char *file) {
+  struct stat st;
+  if (stat(file, &st) != 0) {
+    return NULL;
   }
 
-  // find in current directory
-  if (sys_search_path(".", file, file)) {
-    return 1;
+  unit_image_t *cached = unit_images;
+  while (cached != NULL && (cached->file == NULL || strcmp(cached->file, file) != 0)) {
+    cached = cached->next;
+  }
+  if (cached != NULL) {
+    if (cached->mtime == st.st_mtime && cached->size == st.st_size &&
+        cached->inode == st.st_ino) {
+      cached->refs++;
+      return cached->image;
+    }
+    unit_image_forget(file);
   }
 
-  return 0;
+  byte *image = NULL;
+  int h = open(file, O_RDONLY | O_BINARY);
+  if (h != -1) {
+    if (st.st_size >= (off_t)sizeof(unit_file_t)) {
+      image = (byte *)malloc(st.st_size + 4);
+      if (read(h, image, st.st_size) != st.st_size || memcmp(image, "SBUn", 4) != 0) {
+        free(image);
+        image = NULL;
+      }
+    }
+    close(h);
+  }
+  if (image != NULL) {
+    cached = (unit_image_t *)malloc(sizeof(unit_image_t));
+    cached->file = strdup(file);
+    cached->mtime = st.st_mtime;
+    cached->size = st.st_size;
+    cached->inode = st.st_ino;
+    cached->image = image;
+    cached->refs = 1;
+    cached->next = unit_images;
+    unit_images = cached;
+  }
+  return image;
+}
+
+/**
+ * removes the file's image from the cache, since the compiler may rewrite
+ * it within the same second and with the same size
+ *
+ * @param file the .sbu file name
+ */
+void unit_image_forget(const char *file) {
+  for (unit_image_t *cached = unit_images; cached != NULL; cached = cached->next) {
+    if (cached->file != NULL && strcmp(cached->file, file) == 0) {
+      // running tasks keep the old image until released
+      free(cached->file);
+      cached->file = NULL;
+    }
+  }
+  unit_image_release(NULL);
+}
+
+/**
+ * releases an image from unit_image_load, freeing replaced images once
+ * they are no longer used
+ *
+ * @param image the image or NULL to only free replaced images
+ * @return non-zero when the image belongs to the cache
+ */
+int unit_image_release(byte *image) {
+  int result = 0;
+  unit_image_t **next = &unit_images;
+  while (*next != NULL) {
+    unit_image_t *cached = *next;
+    if (image != NULL && cached->image == image) {
+      cached->refs--;
+      result = 1;
+    }
+    if (cached->file == NULL && cached->refs == 0) {
+      *next = cached->next;
+      free(cached->image);
+      free(cached);
+    } else {
+      next = &cached->next;
+    }
+  }
+  return result;
+}
+
+/**
+ * binds an imported symbol to the unit's export on its first use
+ *
+ * @param index the symbol's index in the program's import table
+ * @return non-zero when the unit exports the symbol
+ */
+int unit_bind(int index) {
+  bc_symbol_rec_t *ps = &prog_symtable[index];
+  if (ps->exp_idx == -1 && ps->task_id != -1) {
+    // the name without the 'class', the unit may be newer than the program
+    const char *name = strrchr(ps->symbol, '.');
+    name = name ? name + 1 : ps->symbol;
+    task_t *lib = taskinfo(ps->task_id);
+    for (int k = 0; k < lib->sbe.exec.expcount; k++) {
+      if (strcmp(name, lib->sbe.exec.exptable[k].symbol) == 0) {
+        ps->exp_idx = k;
+        break;
+      }
+    }
+  }
+  return ps->exp_idx != -1;
 }
 
 /**
@@ -100,7 +262,6 @@ int find_unit(const char *name, char *file) {
  * @return the unit handle or -1 on error
  */
 int open_unit(const char *file, const char *alias) {
-  int h;
   unit_t u;
   int uid = -1;
 
@@ -146,26 +307,24 @@ int open_unit(const char *file, const char *alias) {
     return -1;
   }
 
-  // open unit
-  h = open(unitname, O_RDWR | O_BINARY);
-  if (h == -1) {
+  // the header and symbols come from the shared image, which the
+  // executor later reuses for the unit's task
+  byte *image = unit_image_load(unitname);
+  if (image == NULL) {
     return -1;
   }
-
-  // read file header
-  int nread = read(h, &u.hdr, sizeof(unit_file_t));
-  if (nread != sizeof(unit_file_t) ||
-      u.hdr.version != SB_DWORD_VER ||
-      memcmp(&u.hdr.sign, "SBUn", 4) != 0) {
-    close(h);
+  memcpy(&u.hdr, image, sizeof(unit_file_t));
+  if (u.hdr.version != SB_DWORD_VER) {
+    unit_image_release(image);
     return -1;
   }
 
   // load symbol-table
   if (u.hdr.sym_count) {
     u.symbols = (unit_sym_t *)malloc(u.hdr.sym_count * sizeof(unit_sym_t));
-    read(h, u.symbols, u.hdr.sym_count * sizeof(unit_sym_t));
+    memcpy(u.symbols, image + sizeof(unit_file_t), u.hdr.sym_count * sizeof(unit_sym_t));
   }
+  unit_image_release(image);
 
   // setup the rest
   strcpy(u.name, unitname);
@@ -184,9 +343,6 @@ int open_unit(const char *file, const char *alias) {
 
   // copy unit's data
   memcpy(&units[uid], &u, sizeof(unit_t));
-
-  // cleanup
-  close(h);
   return uid;
 }
 
@@ -261,6 +417,10 @@ int unit_exec(int lib_id, int index, var_t *ret) {
 
   my_tid = ctask->tid;
   ps = &prog_symtable[index];
+  if (!unit_bind(index)) {
+    rt_raise(ERR_UNIT_SYMBOL, ps->symbol);
+    return 0;
+  }
   us = &(taskinfo(ps->task_id)->sbe.exec.exptable[ps->exp_idx]);
 
   switch (ps->type) {
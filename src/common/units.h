@@ -108,6 +108,46 @@ void unit_mgr_close();
  */
 int find_unit(const char *name, char *file);
 
+/**
+ * @ingroup exec
+ *
+ * returns the compiled unit file from memory, loading it when the file
+ * is new or has changed since it was loaded
+ *
+ * @param file the .sbu file name
+ * @return the image or NULL on error
+ */
+byte *unit_image_load(const char *file);
+
+/**
+ * @ingroup exec
+ *
+ * removes the file's image from the cache after it was rewritten
+ *
+ * @param file the .sbu file name
+ */
+void unit_image_forget(const char *file);
+
+/**
+ * @ingroup exec
+ *
+ * releases an image from unit_image_load
+ *
+ * @param image the image or NULL to only free replaced images
+ * @return non-zero when the image belongs to the cache
+ */
+int unit_image_release(byte *image);
+
+/**
+ * @ingroup exec
+ *
+ * binds an imported unit symbol on its first use
+ *
+ * @param index the symbol's index in the program's import table
+ * @return non-zero when the unit exports the symbol
+ */
+int unit_bind(int index);
+
 /**
  * @ingroup exec
  *
@@ -334,7 +334,11 @@ int v_compare(var_t *a, var_t *b) {
     }
   }
   if ((a->type == V_STR) && (b->type == V_STR)) {
-    return strcmp(a->v.p.ptr, b->v.p.ptr);
+    // compare as bytes, a prefix sorts first
+    int la = v_strlen(a);
+    int lb = v_strlen(b);
+    int ci = memcmp(a->v.p.ptr, b->v.p.ptr, la < lb ? la : lb);
+    return ci != 0 ? ci : la - lb;
   }
   if ((a->type == V_STR) && (b->type == V_NUM)) {
     if (a->v.p.ptr[0] == '\0' || is_number(a->v.p.ptr)) {
@@ -409,10 +413,12 @@ void v_add(var_t *result, var_t *a, var_t *b) {
   char tmpsb[INT_STR_LEN];
 
   if (a->type == V_STR && b->type == V_STR) {
-    int length = strlen(a->v.p.ptr) + strlen(b->v.p.ptr);
-    v_init_str(result, length);
-    strcpy(result->v.p.ptr, a->v.p.ptr);
-    strcat(result->v.p.ptr, b->v.p.ptr);
+    int la = v_strlen(a);
+    int lb = v_strlen(b);
+    v_init_str(result, la + lb);
+    memcpy(result->v.p.ptr, a->v.p.ptr, la);
+    memcpy(result->v.p.ptr + la, b->v.p.ptr, lb);
+    result->v.p.ptr[la + lb] = '\0';
     return;
   } else if (a->type == V_INT && b->type == V_INT) {
     result->type = V_INT;
@@ -439,15 +445,16 @@ void v_add(var_t *result, var_t *a, var_t *b) {
         result->v.n = b->v.n + v_getval(a);
       }
     } else {
-      v_init_str(result, strlen(a->v.p.ptr) + INT_STR_LEN);
-      strcpy(result->v.p.ptr, a->v.p.ptr);
+      int la = v_strlen(a);
       if (b->type == V_INT) {
         ltostr(b->v.i, tmpsb);
       } else {
         ftostr(b->v.n, tmpsb);
       }
-      strcat(result->v.p.ptr, tmpsb);
-      result->v.p.length = strlen(result->v.p.ptr) + 1;
+      int lb = strlen(tmpsb);
+      v_init_str(result, la + lb);
+      memcpy(result->v.p.ptr, a->v.p.ptr, la);
+      memcpy(result->v.p.ptr + la, tmpsb, lb + 1);
     }
   } else if ((a->type == V_INT || a->type == V_NUM) && b->type == V_STR) {
     if (is_number(b->v.p.ptr)) {
@@ -458,15 +465,17 @@ void v_add(var_t *result, var_t *a, var_t *b) {
         result->v.n = a->v.n + v_getval(b);
       }
     } else {
-      v_init_str(result, strlen(b->v.p.ptr) + INT_STR_LEN);
+      int lb = v_strlen(b);
       if (a->type == V_INT) {
         ltostr(a->v.i, tmpsb);
       } else {
         ftostr(a->v.n, tmpsb);
       }
-      strcpy(result->v.p.ptr, tmpsb);
-      strcat(result->v.p.ptr, b->v.p.ptr);
-      result->v.p.length = strlen(result->v.p.ptr) + 1;
+      int la = strlen(tmpsb);
+      v_init_str(result, la + lb);
+      memcpy(result->v.p.ptr, tmpsb, la);
+      memcpy(result->v.p.ptr + la, b->v.p.ptr, lb);
+      result->v.p.ptr[la + lb] = '\0';
     }
   } else if (b->type == V_MAP) {
     char *map = map_to_str(b);
@@ -493,10 +502,12 @@ void v_set(var_t *dest, const var_t *src) {
     break;
   case V_STR:
     if (src->v.p.owner) {
-      dest->v.p.length = v_strlen(src) + 1;
-      dest->v.p.ptr = (char *)malloc(dest->v.p.length);
+      int len = v_strlen(src);
+      dest->v.p.length = len + 1;
+      dest->v.p.ptr = (char *)malloc(len + 1);
       dest->v.p.owner = 1;
-      strcpy(dest->v.p.ptr, src->v.p.ptr);
+      memcpy(dest->v.p.ptr, src->v.p.ptr, len);
+      dest->v.p.ptr[len] = '\0';
     } else {
       dest->v.p.length = src->v.p.length;
       dest->v.p.ptr = src->v.p.ptr;
@@ -673,9 +684,7 @@ void v_tostr(var_t *arg) {
   if (arg->type != V_STR) {
     char *tmp = v_str(arg);
     v_free(arg);
-    v_init_str(arg, strlen(tmp));
-    strcpy(arg->v.p.ptr, tmp);
-    free(tmp);
+    v_move_str(arg, tmp);
   }
 }
 
@@ -691,10 +700,12 @@ void v_setstr(var_t *var, const char *str) {
 }
 
 void v_setstrn(var_t *var, const char *str, int len) {
-  if (var->type != V_STR || strncmp(str, var->v.p.ptr, len) != 0) {
+  if (var->type != V_STR || var->v.p.ptr == NULL || v_strlen(var) != len ||
+      memcmp(str, var->v.p.ptr, len) != 0) {
     v_free(var);
     v_init_str(var, len);
-    strlcpy(var->v.p.ptr, str, len + 1);
+    memcpy(var->v.p.ptr, str, len);
+    var->v.p.ptr[len] = '\0';
   }
 }
 
@@ -706,18 +717,18 @@ void v_strcat(var_t *var, const char *str) {
     v_tostr(var);
   }
   if (var->type == V_STR) {
+    int len = v_strlen(var);
+    int len_str = strlen(str);
     if (var->v.p.owner) {
-      var->v.p.length = strlen(var->v.p.ptr) + strlen(str) + 1;
+      var->v.p.length = len + len_str + 1;
       var->v.p.ptr = realloc(var->v.p.ptr, var->v.p.length);
-      strcat(var->v.p.ptr, str);
     } else {
       // mutate into owner string
       char *p = var->v.p.ptr;
-      int len = var->v.p.length + strlen(str);
-      v_init_str(var, len);
-      strcpy(var->v.p.ptr, p);
-      strcat(var->v.p.ptr, str);
+      v_init_str(var, len + len_str);
+      memcpy(var->v.p.ptr, p, len);
     }
+    memcpy(var->v.p.ptr + len, str, len_str + 1);
 
   } else {
     err_typemismatch();
@@ -153,6 +153,7 @@ typedef struct stknode_s {
       bcip_t ret_ip;   /**< return ip */
       bid_t rvid;      /**< return-variable ID */
       int task_id; /**< task_id or -1 (this task) */
+      uint32_t frame; /**< index of the first frame slot (parameters, then locals) */
       uint16_t pcount; /**< number of parameters */
     } vcall;
 
@@ -164,14 +165,6 @@ typedef struct stknode_s {
       bid_t vid; /**< variable index in tvar */
     } vdvar;
 
-    /**
-     *  parameter (CALL UDP/F)
-     */
-    struct {
-      var_t *res; /**< variable pointer (for BYVAL this is a clone) */
-      uint16_t vcheck; /**< checks (1=BYVAL ONLY, 3=BYVAL|BYREF, 2=BYREF ONLY) */
-    } param;
-
     /**
      * try/catch
      */
@@ -188,6 +181,27 @@ typedef struct stknode_s {
   code_t type; /**< type of node (keyword id, i.e. kwGOSUB, kwFOR, etc) */
 } stknode_t;
 
+/*
+ * frame slot flags
+ */
+#define FRAME_ARGREF 1 /**< the argument is a single variable: 'ref' may be used BYREF */
+#define FRAME_BOUND  2 /**< the slot is bound to tvar[vid], 'prev' is the replaced pointer */
+
+/**
+ * @ingroup exec
+ * @typedef frame_slot_t
+ *
+ * A parameter or LOCAL of a SUB/FUNC call. The slots of a call are contiguous,
+ * starting at vcall.frame, and are released together on return.
+ */
+typedef struct frame_slot_s {
+  var_t var; /**< the value of a BYVAL parameter or LOCAL */
+  var_t *ref; /**< the caller's variable (FRAME_ARGREF) */
+  var_t **bind; /**< the tvar entry the slot is bound to (FRAME_BOUND) */
+  var_t *prev; /**< the previous value of the tvar entry (FRAME_BOUND) */
+  byte flags; /**< FRAME_xxx */
+} frame_slot_t;
+
 /**
  * @ingroup var
  *
@@ -268,6 +282,46 @@ void code_jump_label(uint16_t label_id);  // IP <- LABEL_IP_TABLE[label_id]
  */
 stknode_t *code_push(code_t type);
 
+/**
+ * @ingroup exec
+ *
+ * returns the number of nodes the program stack may grow to
+ */
+uint32_t code_stack_limit(void);
+
+/**
+ * @ingroup exec
+ *
+ * appends a new slot to the frame stack
+ *
+ * @return the slot, holding a cleared variable
+ */
+frame_slot_t *code_frame_push();
+
+/**
+ * @ingroup exec
+ *
+ * returns the slot at the given index of the frame stack
+ */
+frame_slot_t *code_frame_slot(uint32_t index);
+
+/**
+ * @ingroup exec
+ *
+ * returns the number of slots in the frame stack
+ */
+uint32_t code_frame_top();
+
+/**
+ * @ingroup exec
+ *
+ * releases the slots from the top of the frame stack down to base, restoring
+ * the bound variables
+ *
+ * @param base the index of the first slot to release
+ */
+void code_frame_release(uint32_t base);
+
 /**
  * @ingroup exec
  *
@@ -277,6 +331,26 @@ stknode_t *code_push(code_t type);
  */
 void code_pop(stknode_t *node, int expected_type);
 
+/**
+ * @ingroup exec
+ *
+ * releases the slots from index base up to from; the slots above from are
+ * moved down to base
+ *
+ * @param base the index of the first slot to release
+ * @param from the index of the first slot to keep
+ */
+void code_frame_shift(uint32_t base, uint32_t from);
+
+/**
+ * @ingroup exec
+ *
+ * releases the resources held by a node removed from the stack
+ *
+ * @param node the stack node
+ */
+void free_node(stknode_t *node);
+
 /**
  * @ingroup exec
  *
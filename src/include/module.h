@@ -16,6 +16,15 @@
 extern "C" {
 #endif
 
+//
+// parameters are never copied for the call:
+// byref=1: var_p is the caller's variable, changes are seen by the caller
+// byref=0: var_p is a temporary owned by the interpreter and released after
+//          the call. string literals borrow the program text (owner == 0).
+//          the module may move the value into retval and v_init the
+//          temporary instead of copying it.
+// values set in retval are moved into the caller's variable
+//
 typedef struct {
   // the parameter
   var_t *var_p;
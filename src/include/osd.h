@@ -236,6 +236,36 @@ void osd_setpixel(int x, int y);
  */
 long osd_getpixel(int x, int y);
 
+/**
+ * @ingroup lgraf
+ *
+ * Copies a rectangle of pixels into the buffer row after row, using the
+ * same values as osd_getpixel.
+ *
+ * @param x the left position
+ * @param y the top position
+ * @param w the width
+ * @param h the height
+ * @param pixels the buffer of w * h values
+ * @return non-zero on success, zero when the driver has no pixel buffer
+ */
+int osd_getpixels(int x, int y, int w, int h, int *pixels);
+
+/**
+ * @ingroup lgraf
+ *
+ * Draws a rectangle of pixels from the buffer row after row. The values
+ * are colors as given to osd_setcolor.
+ *
+ * @param x the left position
+ * @param y the top position
+ * @param w the width
+ * @param h the height
+ * @param pixels the buffer of w * h values
+ * @return non-zero on success, zero when the driver has no pixel buffer
+ */
+int osd_setpixels(int x, int y, int w, int h, const int *pixels);
+
 /**
  * @ingroup lgraf
  *
@@ -248,6 +278,17 @@ long osd_getpixel(int x, int y);
  */
 void osd_line(int x1, int y1, int x2, int y2);
 
+/**
+ * @ingroup lgraf
+ *
+ * draw the lines joining the points using foreground color
+ *
+ * @param points the x, y coordinates of each point
+ * @param count the number of points
+ * @return non-zero on success, zero when the driver only draws single lines
+ */
+int osd_polyline(const int *points, int count);
+
 /**
  * @ingroup lgraf
  *
@@ -126,6 +126,7 @@ struct keyword_s keyword_table[] = {
 { "$ret",               kwTYPE_RET },
 { "$udp",               kwTYPE_CALL_UDP },
 { "$udf",               kwTYPE_CALL_UDF },
+{ "$tcl",               kwTYPE_CALL_TAIL },
 { "", 0 }
 };
 
@@ -347,6 +348,17 @@ struct func_keyword_s func_table[] = {
 { "FORM",                       kwFORM },
 { "WINDOW",                     kwWINDOW },
 { "TIMESTAMP",                  kwTIMESTAMP },
+{ "ACCEPT",                     kwACCEPT },
+{ "POLL",                       kwPOLL },
+{ "DIRWALK",                    kwDIRWALKF },
+{ "AREAD",                      kwAREAD },
+{ "AWRITE",                     kwAWRITE },
+{ "ATLOAD",                     kwATLOAD },
+{ "ADONE",                      kwADONE },
+{ "AWAIT",                      kwAWAIT },
+{ "REMATCH",                    kwREMATCH },
+{ "REMATCHALL",                 kwREMATCHALL },
+{ "RESUB",                      kwRESUB },
 { "", 0 }
 };
 
@@ -413,7 +425,11 @@ struct proc_keyword_s proc_table[] = {
 { "CALL",               kwCALLCP },
 { "DEFINEKEY",          kwDEFINEKEY },
 { "SHOWPAGE",           kwSHOWPAGE },
+{ "RNDFILL",            kwRNDFILL },
+{ "GETPIXELS",          kwGETPIXELS },
+{ "PUTPIXELS",          kwPUTPIXELS },
 { "TIMER",              kwTIMER }, 
+{ "ADONE",              kwADONE },
 
 #if !defined(OS_LIMITED)
 { "STKDUMP",    kwSTKDUMP },
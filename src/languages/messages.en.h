@@ -43,6 +43,7 @@
 #define MSG_NEW_LABEL           "%d: new label [%s], index %d\n"
 #define MSG_NEW_UDP             "%d: new UDP/F [%s], index %d\n"
 #define MSG_NEW_VAR             "%d: new VAR [%s], index %d\n"
+#define MSG_STACK_PEAK          "%s: stack peak %d of %d nodes\n"
 #define MSG_WRONG_VARNAME       "Wrong variable name: %s"
 #define MSG_EXP_GENERR          "Error on numeric expression"
 #define MSG_BF_ARGERR           "Built-in function %s: without parameters"
@@ -92,6 +93,7 @@
 #define MSG_CANT_OPEN_FILE      "Can't open '%s'\n"
 #define MSG_GRMODE_ERR          "GRMODE, usage:<width>x<height>[x<bits-per-pixel>]\nExample: OPTION PREDEF GRMODE=640x480x4\n"
 #define MSG_UNIT_NOT_FOUND      "Unit %s.sbu not found or wrong version"
+#define ERR_UNIT_SYMBOL         "Unit does not export %s"
 #define MSG_IMPORT_FAILED       "Unit %s.sbu, import failed"
 #define MSG_INVALID_UNIT_NAME   "Invalid unit name"
 #define MSG_UNIT_ALREADY_DEFINED "Unit name already defined"
@@ -151,6 +153,8 @@
 #define ERR_PARCOUNT            "Error number of parameters"
 #define ERR_STACK_OVERFLOW      "Stack overflow"
 #define ERR_STACK_UNDERFLOW     "Stack underflow"
+#define ERR_REGEX               "Regular expression error at offset %d: %s"
+#define ERR_REGEX_UNSUPPORTED   "Regular expressions are not supported on this platform"
 #define ERR_STACK               "Stack mess (Cannot use call to SUB with an expression)"
 #define ERR_ARRAY_MISSING_LP    "Array: Missing '('"
 #define ERR_ARRAY_MISSING_RP    "Array: Missing ')'"
@@ -226,6 +230,9 @@
 #define ERR_NETWORK             "Network error"
 #define ERR_XPM_IMAGE           "Invalid xpm image"
 #define ERR_FILE_NOT_OPEN       "IOError: File not open for reading"
+#define ERR_NOT_SERVER          "IOError: File is not an SSVR listener"
+#define ERR_NOT_SOCKET          "IOError: File is not a socket"
+#define ERR_ASYNC_HANDLE        "IOError: Invalid asynchronous request %d"
 #define ERR_DIRWALK_NAME        "DIRWALK: name %s/%s too long"
 #define ERR_DIRWALK_MISSING_USE "DIRWALK: missing USE statement"
 #define ERR_DIRWALK_CANT_OPEN   "DIRWALK: can't open %s"
@@ -141,6 +141,13 @@ void maPlot(int posX, int posY);
  */
 void maLine(int startX, int startY, int endX, int endY);
 
+/**
+ * Draws the lines joining count points, given as x, y pairs, using the
+ * current color.
+ * \see maSetColor()
+ */
+void maPolyline(const int *points, int count);
+
 /**
  * Draws an ellipse using the current color.
  * \see maSetColor()
@@ -42,10 +42,40 @@
 #include "lib/match.h"
 #include "common/smbas.h"
 #include "common/sberr.h"
+#include "common/messages.h"
 
-#ifdef USE_PCRE
-#include <pcre.h>
-#define OVECCOUNT 30            /* should be a multiple of 3 */
+#if defined(USE_PCRE2)
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#elif defined(HAVE_REGEX_H)
+#include <regex.h>
+#endif
+
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+// number of compiled expressions kept by reg_compile
+#define REG_CACHE_SIZE 16
+
+#if defined(USE_PCRE2)
+typedef pcre2_match_data reg_data_t;
+#else
+typedef void reg_data_t;
+#endif
+
+typedef struct reg_cache_t {
+  struct reg_cache_t *next;
+  char *pattern;
+  int caseless;
+#if defined(USE_PCRE2)
+  pcre2_code *code;
+  pcre2_match_data *match_data;
+#elif defined(HAVE_REGEX_H)
+  regex_t code;
+  reg_data_t *match_data;  // unused
+#endif
+} reg_cache_t;
+
+// most recently used first
+static reg_cache_t *reg_cache;
 #endif
 
 int reg_match_after_star(const char *p, char *t);
@@ -246,40 +276,282 @@ int reg_match_jk(const char *p, char *t) {
   return reg_match_valid;
 }
 
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+static void reg_cache_free(reg_cache_t *entry) {
+#if defined(USE_PCRE2)
+  pcre2_match_data_free(entry->match_data);
+  pcre2_code_free(entry->code);
+#else
+  regfree(&entry->code);
+#endif
+  free(entry->pattern);
+  free(entry);
+}
+
 /*
+ * returns a new compiled expression, or NULL after raising the error
  */
-#ifdef USE_PCRE
-int reg_match_pcre(const char *p, char *t)
-{
-  pcre *re;
-  const char *error;
-  int errofs;
-
-  re =
-  pcre_compile(p, (opt_usepcre == 2) ? PCRE_CASELESS : 0, &error, &errofs, NULL);
-  if (!re) {
-    rt_raise("REGULAR EXPRESSION SYNTAX ERROR (offset %d) -> %s", error, errofs);
-    return reg_match_bad_pattern;
+static reg_cache_t *reg_cache_create(const char *p, int caseless) {
+  reg_cache_t *result = malloc(sizeof(reg_cache_t));
+  if (result == NULL) {
+    err_memory();
+    return NULL;
   }
-  else {
-    int rc;
-    int ovector[OVECCOUNT];
+#if defined(USE_PCRE2)
+  int error;
+  PCRE2_SIZE offset;
+  result->code = pcre2_compile((PCRE2_SPTR)p, PCRE2_ZERO_TERMINATED,
+                               caseless ? PCRE2_CASELESS : 0, &error, &offset, NULL);
+  if (result->code == NULL) {
+    PCRE2_UCHAR message[256];
+    pcre2_get_error_message(error, message, sizeof(message));
+    rt_raise(ERR_REGEX, (int)offset, message);
+    free(result);
+    return NULL;
+  }
+  // JIT is optional: pcre2_match interprets the pattern when it's not available
+  pcre2_jit_compile(result->code, PCRE2_JIT_COMPLETE);
+  result->match_data = pcre2_match_data_create_from_pattern(result->code, NULL);
+#else
+  int error = regcomp(&result->code, p, REG_EXTENDED | (caseless ? REG_ICASE : 0));
+  if (error) {
+    char message[256];
+    regerror(error, &result->code, message, sizeof(message));
+    rt_raise(ERR_REGEX, 0, message);
+    free(result);
+    return NULL;
+  }
+  result->match_data = NULL;
+#endif
+  result->pattern = strdup(p);
+  result->caseless = caseless;
+  result->next = NULL;
+  return result;
+}
 
-    rc = pcre_exec(re, NULL, t, strlen(t), 0, 0, ovector, OVECCOUNT);
-    if (rc >= 0)
-    return reg_match_valid;
+/*
+ * returns the compiled expression, from the cache when the same pattern
+ * was used recently. the entry is moved to the front of the cache.
+ */
+static reg_cache_t *reg_compile(const char *p, int caseless) {
+  reg_cache_t *prev = NULL;
+  reg_cache_t *last = NULL;
+  int count = 0;
+  for (reg_cache_t *entry = reg_cache; entry != NULL; entry = entry->next) {
+    if (entry->caseless == caseless && strcmp(entry->pattern, p) == 0) {
+      if (prev != NULL) {
+        prev->next = entry->next;
+        entry->next = reg_cache;
+        reg_cache = entry;
+      }
+      return entry;
+    }
+    last = prev;
+    prev = entry;
+    count++;
+  }
+
+  reg_cache_t *result = reg_cache_create(p, caseless);
+  if (result == NULL) {
+    return NULL;
+  }
+  result->next = reg_cache;
+  reg_cache = result;
+
+  if (count == REG_CACHE_SIZE) {
+    // drop the least recently used
+    reg_cache_free(prev);
+    if (last != NULL) {
+      last->next = NULL;
+    } else {
+      result->next = NULL;
+    }
+  }
+  return result;
+}
+
+/*
+ * runs the compiled expression with the given match data, see reg_search.
+ * returns a negative error code when the match failed to complete
+ */
+static int reg_exec(const reg_cache_t *re, reg_data_t *match_data, const char *t, int len,
+                    int offset, int *ovector, int ovecsize) {
+  int result;
+#if defined(USE_PCRE2)
+  int rc = pcre2_match(re->code, (PCRE2_SPTR)t, len, offset, 0, match_data, NULL);
+  if (rc > 0) {
+    PCRE2_SIZE *match = pcre2_get_ovector_pointer(match_data);
+    int groups = pcre2_get_ovector_count(match_data);
+    result = groups < ovecsize ? groups : ovecsize;
+    for (int i = 0; i < result; i++) {
+      int unset = (i >= rc || match[i * 2] == PCRE2_UNSET);
+      ovector[i * 2] = unset ? -1 : (int)match[i * 2];
+      ovector[i * 2 + 1] = unset ? -1 : (int)match[i * 2 + 1];
+    }
+  } else {
+    result = (rc == PCRE2_ERROR_NOMATCH) ? 0 : rc;
+  }
+#else
+  int groups = re->code.re_nsub + 1;
+  regmatch_t *match = malloc(sizeof(regmatch_t) * groups);
+  if (match == NULL) {
+    result = -1;
+  } else if (regexec(&re->code, t + offset, groups, match, offset ? REG_NOTBOL : 0) == 0) {
+    result = groups < ovecsize ? groups : ovecsize;
+    for (int i = 0; i < result; i++) {
+      int unset = (match[i].rm_so == -1);
+      ovector[i * 2] = unset ? -1 : (int)match[i].rm_so + offset;
+      ovector[i * 2 + 1] = unset ? -1 : (int)match[i].rm_eo + offset;
+    }
+  } else {
+    result = 0;
+  }
+  free(match);
+#endif
+  return result;
+}
+#endif
+
+int reg_search(const char *p, const char *t, int len, int offset, int *ovector, int ovecsize) {
+  int result = -1;
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+  reg_cache_t *re = reg_compile(p, opt_usepcre == 2);
+  if (re != NULL) {
+    result = reg_exec(re, re->match_data, t, len, offset, ovector, ovecsize);
+    if (result < 0) {
+#if defined(USE_PCRE2)
+      PCRE2_UCHAR message[256];
+      pcre2_get_error_message(result, message, sizeof(message));
+      rt_raise(ERR_REGEX, offset, message);
+#else
+      err_memory();
+#endif
+      result = -1;
+    }
   }
+#else
+  rt_raise(ERR_REGEX_UNSUPPORTED);
+#endif
+  return result;
+}
 
-  return reg_match_literal_failure;
+void reg_match_close() {
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+  while (reg_cache != NULL) {
+    reg_cache_t *next = reg_cache->next;
+    reg_cache_free(reg_cache);
+    reg_cache = next;
+  }
+#endif
 }
+
+struct reg_pattern_t {
+  char *mask;               // matched with reg_match_jk
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+  reg_cache_t *re;          // the regular expression, when enabled
+  reg_data_t *match_data;
+  int owner;                // whether re is released with the pattern
 #endif
+};
+
+reg_pattern_t *reg_pattern_create(const char *p) {
+  reg_pattern_t *result = calloc(1, sizeof(reg_pattern_t));
+  if (result == NULL) {
+    err_memory();
+    return NULL;
+  }
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+  if (opt_usepcre) {
+    // not taken from the cache, which belongs to the main thread
+    result->re = reg_cache_create(p, opt_usepcre == 2);
+    if (result->re == NULL) {
+      free(result);
+      return NULL;
+    }
+    result->match_data = result->re->match_data;
+    result->owner = 1;
+    return result;
+  }
+#endif
+  result->mask = strdup(p);
+  if (result->mask == NULL) {
+    free(result);
+    err_memory();
+    return NULL;
+  }
+  return result;
+}
+
+reg_pattern_t *reg_pattern_copy(const reg_pattern_t *pattern) {
+  reg_pattern_t *result = calloc(1, sizeof(reg_pattern_t));
+  if (result != NULL) {
+    *result = *pattern;
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+    result->owner = 0;
+#if defined(USE_PCRE2)
+    if (result->re != NULL) {
+      result->match_data = pcre2_match_data_create_from_pattern(result->re->code, NULL);
+      if (result->match_data == NULL) {
+        free(result);
+        return NULL;
+      }
+    }
+#endif
+#endif
+    if (pattern->mask != NULL) {
+      result->mask = strdup(pattern->mask);
+      if (result->mask == NULL) {
+        free(result);
+        return NULL;
+      }
+    }
+  }
+  return result;
+}
+
+void reg_pattern_free(reg_pattern_t *pattern) {
+  if (pattern != NULL) {
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+    if (pattern->owner) {
+      reg_cache_free(pattern->re);
+    }
+#if defined(USE_PCRE2)
+    else if (pattern->re != NULL) {
+      pcre2_match_data_free(pattern->match_data);
+    }
+#endif
+#endif
+    free(pattern->mask);
+    free(pattern);
+  }
+}
+
+int reg_pattern_match(reg_pattern_t *pattern, char *t) {
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+  if (pattern->re != NULL) {
+    int ovector[2];
+    int rc = reg_exec(pattern->re, pattern->match_data, t, strlen(t), 0, ovector, 1);
+    return rc > 0 ? reg_match_valid : reg_match_literal_failure;
+  }
+#endif
+  return reg_match_jk(pattern->mask, t);
+}
 
 /*
  */
 int reg_match(const char *p, char *t) {
-#ifdef USE_PCRE
-  if (opt_usepcre)
-  return reg_match_pcre(p, t);
+#if defined(USE_PCRE2) || defined(HAVE_REGEX_H)
+  if (opt_usepcre) {
+    int ovector[2];
+    switch (reg_search(p, t, strlen(t), 0, ovector, 1)) {
+    case 0:
+      return reg_match_literal_failure;
+    case -1:
+      return reg_match_bad_pattern;
+    default:
+      return reg_match_valid;
+    }
+  }
 #endif
   return reg_match_jk(p, t);
 }
@@ -345,7 +617,7 @@ int reg_match_after_star(const char *p, char *t) {
      */
 
     if (nextp == *t || nextp == '[')
-      RegMatch = reg_match(p, t);
+      RegMatch = reg_match_jk(p, t);
 
     /*
      * if the end of text is reached then no RegMatch 
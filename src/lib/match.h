@@ -66,4 +66,67 @@
  */
 int reg_match(const char *p, char *t);
 
+/**
+ * @ingroup str
+ *
+ * searches the text for the regular expression, PCRE2 when available,
+ * otherwise POSIX extended. compiled expressions are cached by pattern;
+ * OPTION MATCH PCRE CASELESS selects caseless matching.
+ *
+ * @param p is the pattern
+ * @param t is the text
+ * @param len is the length of the text
+ * @param offset is where the search starts
+ * @param ovector receives the start/end pairs of the match and its groups,
+ *        -1 for groups that did not participate
+ * @param ovecsize is the number of pairs ovector can hold
+ * @return the number of pairs, 0 when there is no match or -1 on error
+ */
+int reg_search(const char *p, const char *t, int len, int offset, int *ovector, int ovecsize);
+
+/**
+ * @ingroup str
+ *
+ * releases the compiled expressions
+ */
+void reg_match_close(void);
+
+/**
+ * @ingroup str
+ *
+ * a pattern compiled once for use by reg_pattern_match. unlike reg_match
+ * it can be used from worker threads, each holding its own copy.
+ */
+typedef struct reg_pattern_t reg_pattern_t;
+
+/**
+ * @ingroup str
+ *
+ * compiles the pattern as reg_match would use it. call from the main
+ * thread, returns NULL after raising an error for a bad expression
+ */
+reg_pattern_t *reg_pattern_create(const char *p);
+
+/**
+ * @ingroup str
+ *
+ * returns a copy for another thread which shares the compiled expression,
+ * or NULL when out of memory. the copy must be released first
+ */
+reg_pattern_t *reg_pattern_copy(const reg_pattern_t *pattern);
+
+/**
+ * @ingroup str
+ *
+ * releases the pattern or copy
+ */
+void reg_pattern_free(reg_pattern_t *pattern);
+
+/**
+ * @ingroup str
+ *
+ * same as reg_match with a compiled pattern
+ */
+int reg_pattern_match(reg_pattern_t *pattern, char *t);
+
 #endif
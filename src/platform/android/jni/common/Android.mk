@@ -36,9 +36,11 @@ LOCAL_SRC_FILES  :=    \
     $(COMMON)/file.c             \
     $(COMMON)/ffill.c            \
     $(COMMON)/fmt.c              \
+    $(COMMON)/fs_async.c         \
     $(COMMON)/fs_serial.c        \
     $(COMMON)/fs_socket_client.c \
     $(COMMON)/fs_stream.c        \
+    $(COMMON)/g_draw.c           \
     $(COMMON)/g_line.c           \
     $(COMMON)/geom.c             \
     $(COMMON)/inet.c             \
@@ -50,9 +52,11 @@ LOCAL_SRC_FILES  :=    \
     $(COMMON)/scan.c             \
     $(COMMON)/str.c              \
     $(COMMON)/tasks.c            \
+    $(COMMON)/threads.c          \
     $(COMMON)/var_map.c          \
     $(COMMON)/var_eval.c         \
     $(COMMON)/hashmap.c          \
+    $(COMMON)/image_filter.c     \
     $(COMMON)/keymap.c           \
     $(COMMON)/units.c            \
     $(COMMON)/var.c
@@ -239,6 +239,11 @@ void dump_bytecode(FILE *output) {
       fprintf(output, "call user-defined function %d", code_getaddr());
       fprintf(output, ", return-variable: %d", code_getaddr());
       break;
+    case kwTYPE_CALL_TAIL:
+      // restart the current user-defined proc/func
+      fprintf(output, "tail call user-defined proc/func %d", code_getaddr());
+      code_skipaddr();
+      break;
     case kwEXIT:
       fprintf(output, "exit ");
       c = code_getnext();
@@ -12,6 +12,9 @@
 #include "common/device.h"
 #include "common/extlib.h"
 #include "common/smbas.h"
+#include "common/pproc.h"
+#include "common/messages.h"
+#include "platform/console/raster.h"
 
 #define WAIT_INTERVAL 5
 
@@ -30,6 +33,8 @@ typedef void (*ellipse_fn)(int xc, int yc, int xr, int yr, int fill);
 typedef void (*arc_fn)(int xc, int yc, double r, double as, double ae, double aspect);
 typedef void (*setpixel_fn)(int x, int y);
 typedef long (*getpixel_fn)(int x, int y);
+typedef int  (*getpixels_fn)(int x, int y, int w, int h, int *pixels);
+typedef int  (*setpixels_fn)(int x, int y, int w, int h, const int *pixels);
 typedef void (*rect_fn)(int x1, int y1, int x2, int y2, int fill);
 typedef void (*refresh_fn)();
 typedef void (*beep_fn)();
@@ -55,6 +60,8 @@ static ellipse_fn p_ellipse;
 static arc_fn p_arc;
 static setpixel_fn p_setpixel;
 static getpixel_fn p_getpixel;
+static getpixels_fn p_getpixels;
+static setpixels_fn p_setpixels;
 static rect_fn p_rect;
 static refresh_fn p_refresh;
 static beep_fn p_beep;
@@ -101,6 +108,7 @@ int osd_devinit() {
   p_events = (events_fn)slib_get_func("sblib_events");
   p_getpen = (getpen_fn)slib_get_func("sblib_getpen");
   p_getpixel = (getpixel_fn)slib_get_func("sblib_getpixel");
+  p_getpixels = (getpixels_fn)slib_get_func("sblib_getpixels");
   p_getx = (getx_fn)slib_get_func("sblib_getx");
   p_gety = (gety_fn)slib_get_func("sblib_gety");
   p_line = (line_fn)slib_get_func("sblib_line");
@@ -109,6 +117,7 @@ int osd_devinit() {
   p_setcolor = (setcolor_fn)slib_get_func("sblib_setcolor");
   p_setpenmode = (setpenmode_fn)slib_get_func("sblib_setpenmode");
   p_setpixel = (setpixel_fn)slib_get_func("sblib_setpixel");
+  p_setpixels = (setpixels_fn)slib_get_func("sblib_setpixels");
   p_settextcolor = (settextcolor_fn)slib_get_func("sblib_settextcolor");
   p_setxy = (setxy_fn)slib_get_func("sblib_setxy");
   p_sound = (sound_fn)slib_get_func("sblib_sound");
@@ -122,6 +131,29 @@ int osd_devinit() {
   }
   os_graf_mx = opt_pref_width;
   os_graf_my = opt_pref_height;
+
+  if (raster_enabled()) {
+    // draw into an image in place of any graphics module, sized with
+    // OPTION PREDEF GRMODE WxH
+    if (os_graf_mx <= 0 || os_graf_my <= 0) {
+      os_graf_mx = RASTER_WIDTH;
+      os_graf_my = RASTER_HEIGHT;
+    }
+    if (raster_open(os_graf_mx, os_graf_my)) {
+      p_arc = raster_arc;
+      p_cls = raster_cls;
+      p_ellipse = raster_ellipse;
+      p_getpixel = raster_getpixel;
+      p_getpixels = raster_getpixels;
+      p_line = raster_line;
+      p_rect = raster_rect;
+      p_setcolor = raster_setcolor;
+      p_setpixel = raster_setpixel;
+      p_setpixels = raster_setpixels;
+      p_settextcolor = raster_settextcolor;
+    }
+  }
+
   setsysvar_int(SYSVAR_XMAX, os_graf_mx);
   setsysvar_int(SYSVAR_YMAX, os_graf_my);
 
@@ -132,8 +164,15 @@ int osd_devinit() {
   return 1;
 }
 
-// close driver
+// close driver, saving any image not shown with SHOWPAGE
 int osd_devrestore() {
+  if (raster_enabled()) {
+    const char *error = raster_modified() ? raster_save() : NULL;
+    if (error != NULL) {
+      fprintf(stderr, "sbasic: can't write '%s': %s\n", raster_file(), error);
+    }
+    raster_close();
+  }
   return 1;
 }
 
@@ -237,6 +276,11 @@ void osd_line(int x1, int y1, int x2, int y2) {
   }
 }
 
+// the graphics module only provides single lines
+int osd_polyline(const int *points, int count) {
+  return 0;
+}
+
 // draw an ellipse
 void osd_ellipse(int xc, int yc, int xr, int yr, int fill) {
   if (p_ellipse) {
@@ -269,6 +313,28 @@ long osd_getpixel(int x, int y) {
   return result;
 }
 
+// returns a rectangle of pixels, when supported by the graphics module
+int osd_getpixels(int x, int y, int w, int h, int *pixels) {
+  int result;
+  if (p_getpixels) {
+    result = p_getpixels(x, y, w, h, pixels);
+  } else {
+    result = 0;
+  }
+  return result;
+}
+
+// draws a rectangle of pixels, when supported by the graphics module
+int osd_setpixels(int x, int y, int w, int h, const int *pixels) {
+  int result;
+  if (p_setpixels) {
+    result = p_setpixels(x, y, w, h, pixels);
+  } else {
+    result = 0;
+  }
+  return result;
+}
+
 // draw rectangle (parallelogram)
 void osd_rect(int x1, int y1, int x2, int y2, int fill) {
   if (p_rect) {
@@ -354,8 +420,17 @@ void dev_delay(uint32_t timeout) {
   }
 }
 
+// SHOWPAGE writes the next image
+void dev_show_page() {
+  if (raster_enabled()) {
+    const char *error = raster_save();
+    if (error != NULL) {
+      err_throw(ERR_IMAGE_SAVE_ERR, error);
+    }
+  }
+}
+
 // unused
 void dev_log_stack(const char *keyword, int type, int line) {}
 void v_create_form(var_p_t var) {}
 void v_create_window(var_p_t var) {}
-void dev_show_page() {}
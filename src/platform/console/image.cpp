@@ -20,6 +20,7 @@
 #include "common/messages.h"
 #include "common/pproc.h"
 #include "common/fs_socket_client.h"
+#include "common/image_filter.h"
 #include "ui/strlib.h"
 #include "ui/rgb.h"
 #include "lib/lodepng/lodepng.h"
@@ -418,6 +419,33 @@ void cmd_image_save(var_s *self, var_s *) {
   }
 }
 
+//
+// Native image operations (image_filter.c), applied to the shared image buffer
+//
+int img_buffer_get(var_t *self, img_buffer_t *img) {
+  ImageBuffer *image = load_image(self);
+  if (image != NULL) {
+    img->pixels = image->_image;
+    img->width = image->_width;
+    img->height = image->_height;
+    img->bgr = 0;
+  }
+  return image != NULL;
+}
+
+void img_buffer_set(var_t *self, const img_buffer_t *img) {
+  ImageBuffer *image = load_image(self);
+  if (image != NULL) {
+    if (img->pixels != image->_image) {
+      image->_image = img->pixels;
+      image->_width = img->width;
+      image->_height = img->height;
+      map_set_int(self, IMG_WIDTH, img->width);
+      map_set_int(self, IMG_HEIGHT, img->height);
+    }
+  }
+}
+
 void create_image(var_p_t var, ImageBuffer *image) {
   map_init(var);
   map_add_var(var, IMG_ID, ++nextId);
@@ -432,6 +460,7 @@ void create_image(var_p_t var, ImageBuffer *image) {
   v_create_func(var, "filter", cmd_image_filter);
   v_create_func(var, "paste", cmd_image_paste);
   v_create_func(var, "save", cmd_image_save);
+  img_create_methods(var);
 }
 
 //
@@ -12,6 +12,7 @@
 #include <errno.h>
 #include "common/sbapp.h"
 #include "ui/kwp.h"
+#include "platform/console/raster.h"
 
 // decompile handling
 extern "C" {
@@ -32,6 +33,8 @@ static struct option OPTIONS[] = {
   {"decompile",      optional_argument, NULL, 's'},
   {"option",         optional_argument, NULL, 'o'},
   {"cmd",            optional_argument, NULL, 'c'},
+  {"stack-size",     required_argument, NULL, 'S'},
+  {"png",            required_argument, NULL, 'p'},
   {"stdin",          optional_argument, NULL, '-'},
   {"help",           optional_argument, NULL, 'h'},
   {0, 0, 0, 0}
@@ -241,7 +244,7 @@ bool process_options(int argc, char *argv[], char **runFile, bool *tmpFile) {
   bool result = true;
   while (result) {
     int option_index = 0;
-    int c = getopt_long(argc, argv, "vkfxm:s:o:c:h::", OPTIONS, &option_index);
+    int c = getopt_long(argc, argv, "vkfxm:s:o:c:S:p:h::", OPTIONS, &option_index);
     if (c == -1 && !option_index) {
       // no more options
       for (int i = 1; i < argc; i++) {
@@ -271,6 +274,15 @@ bool process_options(int argc, char *argv[], char **runFile, bool *tmpFile) {
       }
       result = false;
       break;
+    case 'S':
+      opt_stack_max = strtoul(optarg, nullptr, 10);
+      break;
+    case 'p':
+      if (!raster_setup(optarg)) {
+        fprintf(stdout, "sbasic: invalid png file '%s', use %%d for a page number\n", optarg);
+        result = false;
+      }
+      break;
     case 'v':
       opt_verbose = true;
       opt_quiet = false;
@@ -0,0 +1,250 @@
+// This file is part of SmallBASIC
+//
+// Headless graphics for the console version
+//
+// The shapes are rasterised as in ui::Graphics, without antialiasing and
+// without text, since the console version has no fonts.
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#define LODEPNG_NO_COMPILE_CPP
+
+#include "config.h"
+#include "common/sys.h"
+#include "common/device.h"
+#include "lib/lodepng/lodepng.h"
+#include "platform/console/raster.h"
+
+#include <math.h>
+
+static char *raster_name;      // file name or page number format
+static char *raster_path;      // the file name of the last page
+static bool raster_paged;
+static int raster_page;
+static uint32_t *raster_pixels;
+static int raster_width;
+static int raster_height;
+static uint32_t raster_fg;
+static uint32_t raster_bg;
+static bool raster_changed;    // drawn since the last save
+
+// returns whether the file name holds a single page number, eg %d or %03d
+static bool raster_is_paged(const char *file) {
+  const char *p = strchr(file, '%');
+  bool result = false;
+  if (p != NULL) {
+    p++;
+    while (*p >= '0' && *p <= '9') {
+      p++;
+    }
+    result = (*p == 'd' && strchr(p, '%') == NULL);
+  }
+  return result;
+}
+
+static void raster_plot(int x, int y) {
+  if (x >= 0 && y >= 0 && x < raster_width && y < raster_height) {
+    raster_pixels[y * raster_width + x] = raster_fg;
+    raster_changed = true;
+  }
+}
+
+static void raster_span(int x1, int x2, int y, uint32_t color) {
+  if (y >= 0 && y < raster_height) {
+    if (x1 > x2) {
+      int x = x1;
+      x1 = x2;
+      x2 = x;
+    }
+    if (x1 < 0) {
+      x1 = 0;
+    }
+    if (x2 >= raster_width) {
+      x2 = raster_width - 1;
+    }
+    uint32_t *line = raster_pixels + y * raster_width;
+    for (int x = x1; x <= x2; x++) {
+      line[x] = color;
+    }
+    raster_changed = true;
+  }
+}
+
+// draws a span in the foreground colour, for g_ellipse
+static void raster_fg_span(int x1, int x2, int y) {
+  raster_span(x1, x2, y, raster_fg);
+}
+
+bool raster_setup(const char *file) {
+  bool result = (strchr(file, '%') == NULL || raster_is_paged(file));
+  if (result) {
+    free(raster_name);
+    raster_name = strdup(file);
+    raster_paged = (strchr(file, '%') != NULL);
+    raster_page = 0;
+  }
+  return result;
+}
+
+bool raster_enabled() {
+  return raster_name != NULL;
+}
+
+bool raster_open(int width, int height) {
+  raster_close();
+  raster_pixels = (uint32_t *)malloc(width * height * sizeof(uint32_t));
+  if (raster_pixels != NULL) {
+    raster_width = width;
+    raster_height = height;
+    raster_fg = g_rgba(7);
+    raster_bg = g_rgba(0);
+    raster_cls();
+  }
+  return raster_pixels != NULL;
+}
+
+void raster_close() {
+  free(raster_pixels);
+  raster_pixels = NULL;
+  raster_width = 0;
+  raster_height = 0;
+}
+
+const char *raster_save() {
+  const char *result = NULL;
+  if (raster_pixels != NULL && raster_name != NULL) {
+    free(raster_path);
+    if (raster_paged) {
+      int len = snprintf(NULL, 0, raster_name, ++raster_page);
+      raster_path = (char *)malloc(len + 1);
+      snprintf(raster_path, len + 1, raster_name, raster_page);
+    } else {
+      raster_path = strdup(raster_name);
+    }
+    unsigned error = lodepng_encode32_file(raster_path, (const uint8_t *)raster_pixels,
+                                           raster_width, raster_height);
+    if (error) {
+      result = lodepng_error_text(error);
+    }
+    raster_changed = false;
+  }
+  return result;
+}
+
+const char *raster_file() {
+  return raster_path != NULL ? raster_path : raster_name;
+}
+
+bool raster_modified() {
+  return raster_changed || raster_path == NULL;
+}
+
+void raster_cls() {
+  for (int i = 0; i < raster_width * raster_height; i++) {
+    raster_pixels[i] = raster_bg;
+  }
+  raster_changed = true;
+}
+
+void raster_setcolor(long color) {
+  raster_fg = g_rgba(color);
+}
+
+// a value of -1 means not change that color
+void raster_settextcolor(long fg, long bg) {
+  if (fg != -1) {
+    raster_fg = g_rgba(fg);
+  }
+  if (bg != -1) {
+    raster_bg = g_rgba(bg);
+  }
+}
+
+void raster_line(int x1, int y1, int x2, int y2) {
+  if (y1 == y2) {
+    raster_span(x1, x2, y1, raster_fg);
+  } else {
+    g_line(x1, y1, x2, y2, raster_plot);
+  }
+}
+
+void raster_ellipse(int xc, int yc, int rx, int ry, int fill) {
+  g_ellipse(xc, yc, rx, ry, fill, raster_plot, raster_fg_span);
+}
+
+void raster_arc(int xc, int yc, double r, double start, double end, double aspect) {
+  if (r < 1) {
+    r = 1;
+  }
+  while (end < start) {
+    end += M_PI * 2.0;
+  }
+
+  double th = (end - start) / r;
+  double xs = xc + r * cos(start);
+  double ys = yc + r * aspect * sin(start);
+  double xe = xc + r * cos(end);
+  double ye = yc + r * aspect * sin(end);
+  int x = xs;
+  int y = ys;
+  for (int i = 1; i < r; i++) {
+    double ph = start + i * th;
+    xs = xc + r * cos(ph);
+    ys = yc + r * aspect * sin(ph);
+    raster_line(x, y, xs, ys);
+    x = xs;
+    y = ys;
+  }
+  raster_line(x, y, xe, ye);
+}
+
+void raster_setpixel(int x, int y) {
+  raster_plot(x, y);
+}
+
+long raster_getpixel(int x, int y) {
+  long result = 0;
+  if (x >= 0 && y >= 0 && x < raster_width && y < raster_height) {
+    const uint8_t *rgba = (const uint8_t *)&raster_pixels[y * raster_width + x];
+    result = -((rgba[0] << 16) | (rgba[1] << 8) | rgba[2]);
+  }
+  return result;
+}
+
+int raster_getpixels(int x, int y, int w, int h, int *pixels) {
+  for (int j = 0; j < h; j++) {
+    for (int i = 0; i < w; i++) {
+      *pixels++ = raster_getpixel(x + i, y + j);
+    }
+  }
+  return 1;
+}
+
+int raster_setpixels(int x, int y, int w, int h, const int *pixels) {
+  for (int j = 0; j < h; j++) {
+    for (int i = 0; i < w; i++) {
+      int c = *pixels++;
+      if (x + i >= 0 && y + j >= 0 && x + i < raster_width && y + j < raster_height) {
+        raster_pixels[(y + j) * raster_width + x + i] = g_rgba(c);
+        raster_changed = true;
+      }
+    }
+  }
+  return 1;
+}
+
+void raster_rect(int x1, int y1, int x2, int y2, int fill) {
+  if (fill) {
+    int yMin = y1 < y2 ? y1 : y2;
+    int yMax = y1 < y2 ? y2 : y1;
+    for (int y = yMin; y <= yMax; y++) {
+      raster_span(x1, x2, y, raster_fg);
+    }
+  } else {
+    raster_line(x1, y1, x2, y1);
+    raster_line(x2, y1, x2, y2);
+    raster_line(x2, y2, x1, y2);
+    raster_line(x1, y2, x1, y1);
+  }
+}
@@ -0,0 +1,44 @@
+// This file is part of SmallBASIC
+//
+// Headless graphics for the console version. Drawing commands are
+// rendered into an in-memory RGBA image which is saved as PNG by
+// SHOWPAGE and when the program ends.
+//
+// This program is distributed under the terms of the GPL v2.0 or later
+// Download the GNU Public License (GPL) from www.gnu.org
+
+#ifndef CONSOLE_RASTER_H
+#define CONSOLE_RASTER_H
+
+#define RASTER_WIDTH  1024
+#define RASTER_HEIGHT 768
+
+// sets the PNG file name, which may include a page number, eg chart%03d.png
+bool raster_setup(const char *file);
+bool raster_enabled();
+
+// creates or releases the image
+bool raster_open(int width, int height);
+void raster_close();
+
+// writes the image to the PNG file, returns NULL or the error message
+const char *raster_save();
+const char *raster_file();
+
+// whether the image has changed since it was last saved
+bool raster_modified();
+
+// drivers for the osd functions
+void raster_cls();
+void raster_setcolor(long color);
+void raster_settextcolor(long fg, long bg);
+void raster_line(int x1, int y1, int x2, int y2);
+void raster_ellipse(int xc, int yc, int xr, int yr, int fill);
+void raster_arc(int xc, int yc, double r, double as, double ae, double aspect);
+void raster_setpixel(int x, int y);
+long raster_getpixel(int x, int y);
+int  raster_getpixels(int x, int y, int w, int h, int *pixels);
+int  raster_setpixels(int x, int y, int w, int h, const int *pixels);
+void raster_rect(int x1, int y1, int x2, int y2, int fill);
+
+#endif
@@ -322,6 +322,15 @@ void maLine(int startX, int startY, int endX, int endY) {
   }
 }
 
+void maPolyline(const int *points, int count) {
+  Canvas *canvas = graphics->getDrawTarget();
+  if (canvas) {
+    for (int i = 1; i < count; i++) {
+      canvas->drawLine(points[i * 2 - 2], points[i * 2 - 1], points[i * 2], points[i * 2 + 1]);
+    }
+  }
+}
+
 void maFillRect(int left, int top, int width, int height) {
   Canvas *canvas = graphics->getDrawTarget();
   if (canvas) {
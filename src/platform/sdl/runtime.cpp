@@ -912,6 +912,15 @@ void dumpVariables(socket_t socket) {
       break;
     case kwFUNC:
     case kwPROC:
+      // parameters and locals
+      for (uint32_t j = node.x.vcall.frame; j < code_frame_top(); j++) {
+        frame_slot_t *slot = code_frame_slot(j);
+        if (slot->flags & FRAME_BOUND) {
+          net_printf(socket, "[%d] ", count++);
+          pv_writevar(*slot->bind, PV_NET, socket);
+          net_print(socket, "\n");
+        }
+      }
       localScope = true;
       break;
     }
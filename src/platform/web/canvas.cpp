@@ -7,6 +7,8 @@
 //
 
 #include "platform/web/canvas.h"
+#include "common/device.h"
+#include "lib/lodepng/lodepng.h"
 
 const char *colors[] = {
   "#000",    // 0 black
@@ -27,25 +29,6 @@ const char *colors[] = {
   "#fff"     // 15 bright white
 };
 
-const uint32_t colors_i[] = {
-  0x000000, // 0 black
-  0x000080, // 1 blue
-  0x008000, // 2 green
-  0x008080, // 3 cyan
-  0x800000, // 4 red
-  0x800080, // 5 magenta
-  0x808000, // 6 yellow
-  0xC0C0C0, // 7 white
-  0x808080, // 8 gray
-  0x0000FF, // 9 light blue
-  0x00FF00, // 10 light green
-  0x00FFFF, // 11 light cyan
-  0xFF0000, // 12 light red
-  0xFF00FF, // 13 light magenta
-  0xFFFF00, // 14 light yellow
-  0xFFFFFF  // 15 bright white
-};
-
 #define DEFAULT_FOREGROUND -0xa1a1a1
 #define DEFAULT_BACKGROUND 0
 
@@ -62,9 +45,59 @@ Canvas::Canvas() :
   _json(false),
   _spanLevel(false),
   _curx(0),
-  _cury(0) {
+  _cury(0),
+  _pixels(NULL),
+  _fgPixel(0),
+  _width(0),
+  _height(0),
+  _raster(false) {
   _bgBody = getColor(DEFAULT_BACKGROUND);
   _fgBody = getColor(DEFAULT_FOREGROUND);
+  _fgPixel = g_rgba(DEFAULT_FOREGROUND);
+}
+
+Canvas::~Canvas() {
+  free(_pixels);
+}
+
+// the target of g_line and g_ellipse, which plot through plain functions
+static Canvas *lineCanvas;
+
+static void linePlot(int x, int y) {
+  lineCanvas->plot(x, y);
+}
+
+static void lineSpan(int x1, int x2, int y) {
+  lineCanvas->fillSpan(x1, x2, y);
+}
+
+static const char base64Chars[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void appendBase64(String &result, const uint8_t *data, size_t size) {
+  char *buffer = (char *)malloc(((size + 2) / 3) * 4 + 1);
+  char *out = buffer;
+  size_t i = 0;
+  for (; i + 2 < size; i += 3) {
+    uint32_t n = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    *out++ = base64Chars[(n >> 18) & 0x3f];
+    *out++ = base64Chars[(n >> 12) & 0x3f];
+    *out++ = base64Chars[(n >> 6) & 0x3f];
+    *out++ = base64Chars[n & 0x3f];
+  }
+  if (i < size) {
+    uint32_t n = data[i] << 16;
+    if (i + 1 < size) {
+      n |= data[i + 1] << 8;
+    }
+    *out++ = base64Chars[(n >> 18) & 0x3f];
+    *out++ = base64Chars[(n >> 12) & 0x3f];
+    *out++ = (i + 1 < size) ? base64Chars[(n >> 6) & 0x3f] : '=';
+    *out++ = '=';
+  }
+  *out = '\0';
+  result.append(buffer, out - buffer);
+  free(buffer);
 }
 
 String Canvas::getPage() {
@@ -144,9 +177,13 @@ void Canvas::buildHTML(String &result) {
     .append("function refresh() {\n")
     .append("  var url='?width='+window.innerWidth+'&height='+window.innerHeight;\n")
     .append("  window.location.replace(url);\n")
-    .append("}\n")
-    .append(_script)
-    .append("</script>\n")
+    .append("}\n");
+  if (_pixels != NULL) {
+    buildImage(result);
+  } else {
+    result.append(_script);
+  }
+  result.append("</script>\n")
     .append("<a class=menu href=javascript:refresh()>Refresh</a>")
     .append(_html);
   for (int i = 0; i < _spanLevel; i++) {
@@ -155,9 +192,33 @@ void Canvas::buildHTML(String &result) {
   result.append("</body></html>");
 }
 
+/*! Sends the framebuffer as a PNG, text is drawn once the image has loaded
+ */
+void Canvas::buildImage(String &result) {
+  uint8_t *png = NULL;
+  size_t size = 0;
+  if (!lodepng_encode32(&png, &size, (const uint8_t *)_pixels, _width, _height)) {
+    result.append("var img = new Image();\n")
+      .append("img.onload = function() {\n")
+      .append("ctx.drawImage(img, 0, 0);\n")
+      .append(_script)
+      .append("};\n")
+      .append("img.src = 'data:image/png;base64,");
+    appendBase64(result, png, size);
+    result.append("';\n");
+  } else {
+    result.append(_script);
+  }
+  free(png);
+}
+
 void Canvas::clearScreen() {
   _html.clear();
   _script.clear();
+  if (_pixels != NULL) {
+    // transparent, the canvas background shows through
+    memset(_pixels, 0, (size_t)_width * _height * sizeof(uint32_t));
+  }
   _spanLevel = 0;
   _curx = _cury = 0;
   _bgBody = _bg;
@@ -172,27 +233,113 @@ void Canvas::reset() {
 void Canvas::setTextColor(long fg, long bg) {
   _fg = getColor(fg);
   _bg = getColor(bg);
+  _fgPixel = g_rgba(fg);
 }
 
 void Canvas::setColor(long fg) {
   _fg = getColor(fg);
+  _fgPixel = g_rgba(fg);
+}
+
+void Canvas::setRaster(bool raster, int width, int height) {
+  if (width != _width || height != _height || !raster) {
+    free(_pixels);
+    _pixels = NULL;
+  }
+  _raster = raster;
+  _width = width;
+  _height = height;
+}
+
+/*! Returns the framebuffer, allocated on first use so that text only pages
+ * remain plain HTML
+ */
+uint32_t *Canvas::getPixels() {
+  if (_raster && _pixels == NULL && _width > 0 && _height > 0) {
+    _pixels = (uint32_t *)calloc((size_t)_width * _height, sizeof(uint32_t));
+  }
+  return _pixels;
+}
+
+void Canvas::plot(int x, int y) {
+  if (x >= 0 && y >= 0 && x < _width && y < _height) {
+    _pixels[y * _width + x] = _fgPixel;
+  }
+}
+
+long Canvas::getPixel(int x, int y) {
+  long result = 0;
+  if (_pixels != NULL && x >= 0 && y >= 0 && x < _width && y < _height) {
+    const uint8_t *rgba = (const uint8_t *)&_pixels[y * _width + x];
+    result = -((rgba[0] << 16) | (rgba[1] << 8) | rgba[2]);
+  }
+  return result;
+}
+
+// copies the rectangle of pixels as returned by getPixel
+bool Canvas::readPixels(int x, int y, int w, int h, int *pixels) {
+  if (_raster) {
+    for (int j = 0; j < h; j++) {
+      for (int i = 0; i < w; i++) {
+        *pixels++ = getPixel(x + i, y + j);
+      }
+    }
+  }
+  return _raster;
+}
+
+// draws the rectangle of pixels as set by setPixel
+bool Canvas::writePixels(int x, int y, int w, int h, const int *pixels) {
+  if (getPixels() != NULL) {
+    for (int j = 0; j < h; j++) {
+      for (int i = 0; i < w; i++) {
+        int c = *pixels++;
+        if (x + i >= 0 && y + j >= 0 && x + i < _width && y + j < _height) {
+          _pixels[(y + j) * _width + x + i] = g_rgba(c);
+        }
+      }
+    }
+  }
+  return _raster;
+}
+
+void Canvas::fillSpan(int x1, int x2, int y) {
+  if (y >= 0 && y < _height) {
+    if (x1 > x2) {
+      int x = x1;
+      x1 = x2;
+      x2 = x;
+    }
+    if (x1 < 0) {
+      x1 = 0;
+    }
+    if (x2 >= _width) {
+      x2 = _width - 1;
+    }
+    uint32_t *line = _pixels + y * _width;
+    for (int x = x1; x <= x2; x++) {
+      line[x] = _fgPixel;
+    }
+  }
 }
 
 void Canvas::setPixel(int x, int y, int c) {
-  if (c < 0) {
-    c = -c;
+  if (getPixels() != NULL) {
+    if (x >= 0 && y >= 0 && x < _width && y < _height) {
+      _pixels[y * _width + x] = g_rgba(c);
+    }
   } else {
-    c = colors_i[c > 15 ? 15 : c];
+    c = g_rgb(c);
+    int r = (c & 0xff0000) >> 16;
+    int g = (c & 0xff00) >> 8;
+    int b = (c & 0xff);
+    _script.append("p(")
+      .append(x).append(",")
+      .append(y).append(",")
+      .append(r).append(",")
+      .append(g).append(",")
+      .append(b).append(");\n");
   }
-  int r = (c & 0xff0000) >> 16;
-  int g = (c & 0xff00) >> 8;
-  int b = (c & 0xff);
-  _script.append("p(")
-    .append(x).append(",")
-    .append(y).append(",")
-    .append(r).append(",")
-    .append(g).append(",")
-    .append(b).append(");\n");
 }
 
 void Canvas::setXY(int x, int y) {
@@ -201,30 +348,64 @@ void Canvas::setXY(int x, int y) {
 }
 
 void Canvas::drawLine(int x1, int y1, int x2, int y2) {
-  _script.append("l(")
-    .append(x1).append(",")
-    .append(y1).append(",")
-    .append(x2).append(",")
-    .append(y2).append(",'")
-    .append(_fg).append("');\n");
+  if (getPixels() != NULL) {
+    if (y1 == y2) {
+      fillSpan(x1, x2, y1);
+    } else {
+      lineCanvas = this;
+      g_line(x1, y1, x2, y2, linePlot);
+    }
+  } else {
+    _script.append("l(")
+      .append(x1).append(",")
+      .append(y1).append(",")
+      .append(x2).append(",")
+      .append(y2).append(",'")
+      .append(_fg).append("');\n");
+  }
 }
 
 void Canvas::drawRectFilled(int x1, int y1, int x2, int y2) {
-  _script.append("rf(")
-    .append(x1).append(",")
-    .append(y1).append(",")
-    .append(x2-x1).append(",")
-    .append(y2-y1).append(",'")
-    .append(_fg).append("');\n");
+  if (getPixels() != NULL) {
+    int yMin = y1 < y2 ? y1 : y2;
+    int yMax = y1 < y2 ? y2 : y1;
+    for (int y = yMin; y <= yMax; y++) {
+      fillSpan(x1, x2, y);
+    }
+  } else {
+    _script.append("rf(")
+      .append(x1).append(",")
+      .append(y1).append(",")
+      .append(x2-x1).append(",")
+      .append(y2-y1).append(",'")
+      .append(_fg).append("');\n");
+  }
 }
 
 void Canvas::drawRect(int x1, int y1, int x2, int y2) {
-  _script.append("r(")
-    .append(x1).append(",")
-    .append(y1).append(",")
-    .append(x2-x1).append(",")
-    .append(y2-y1).append(",'")
-    .append(_fg).append("');\n");
+  if (getPixels() != NULL) {
+    drawLine(x1, y1, x2, y1);
+    drawLine(x2, y1, x2, y2);
+    drawLine(x2, y2, x1, y2);
+    drawLine(x1, y2, x1, y1);
+  } else {
+    _script.append("r(")
+      .append(x1).append(",")
+      .append(y1).append(",")
+      .append(x2-x1).append(",")
+      .append(y2-y1).append(",'")
+      .append(_fg).append("');\n");
+  }
+}
+
+/*! Draws an ellipse into the framebuffer, as Graphics::drawEllipse. Not
+ * available without the framebuffer
+ */
+void Canvas::drawEllipse(int xc, int yc, int rx, int ry, bool fill) {
+  if (getPixels() != NULL) {
+    lineCanvas = this;
+    g_ellipse(xc, yc, rx, ry, fill, linePlot, lineSpan);
+  }
 }
 
 /*! Prints the contents of the given string onto the backbuffer
@@ -15,25 +15,37 @@
 
 using namespace strlib;
 
+// largest accepted raster width or height
+#define CANVAS_MAX_SIZE 4096
+
 struct Canvas {
   Canvas();
-  virtual ~Canvas() {}
+  virtual ~Canvas();
   void clearScreen();
+  void drawEllipse(int xc, int yc, int rx, int ry, bool fill);
   void drawLine(int x1, int y1, int x2, int y2);
   void drawRectFilled(int x1, int y1, int x2, int y2);
   void drawRect(int x1, int y1, int x2, int y2);
   String getPage();
+  void fillSpan(int x1, int x2, int y);
+  long getPixel(int x, int y);
+  void plot(int x, int y);
   void print(const char *str);
+  bool readPixels(int x, int y, int w, int h, int *pixels);
   void reset();
   void setTextColor(long fg, long bg);
   void setColor(long fg);
   void setPixel(int x, int y, int c);
+  bool writePixels(int x, int y, int w, int h, const int *pixels);
   void setXY(int x, int y);
   void setGraphicText(bool graphicText) { _graphicText = graphicText; }
   void setJSON(bool json) { _json = json; if (_json) _graphicText = false;}
- 
+  void setRaster(bool raster, int width, int height);
+
 private:    
   void buildHTML(String &result);
+  void buildImage(String &result);
+  uint32_t *getPixels();
   bool doEscape(unsigned char* &p);
   void drawText(const char *str, int len);
   String getColor(long c);
@@ -59,6 +71,13 @@ private:
   int _spanLevel;
   int _curx;
   int _cury;
+
+  // framebuffer for graphics in raster mode, sent as a single PNG
+  uint32_t *_pixels;
+  uint32_t _fgPixel;
+  int _width;
+  int _height;
+  bool _raster;
 };
 
 #endif
@@ -24,6 +24,7 @@ Canvas g_canvas;
 uint32_t g_start = 0;
 uint32_t g_maxTime = 2000;
 bool g_graphicText = true;
+bool g_raster = true;
 bool g_noExecute = false;
 struct MHD_Connection *g_connection;
 StringList g_cookies;
@@ -39,11 +40,24 @@ static struct option OPTIONS[] = {
   {"height",         optional_argument, NULL, 'e'},
   {"command",        optional_argument, NULL, 'c'},
   {"graphic-text",   optional_argument, NULL, 'g'},
+  {"raster",         optional_argument, NULL, 'a'},
   {"max-time",       optional_argument, NULL, 't'},
   {"module",         optional_argument, NULL, 'm'},
   {0, 0, 0, 0}
 };
 
+// returns the width or height, ignoring non-positive values and limiting
+// the size of the raster
+int get_dimension(const char *value, int size) {
+  int result = atoi(value);
+  if (result <= 0) {
+    result = size;
+  } else if (result > CANVAS_MAX_SIZE) {
+    result = CANVAS_MAX_SIZE;
+  }
+  return result;
+}
+
 void init() {
   opt_command[0] = '\0';
   opt_file_permitted = 0;
@@ -114,24 +128,30 @@ MHD_Response *execute(struct MHD_Connection *connection, const char *bas) {
     MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "command");
   const char *graphicText =
     MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "graphic-text");
+  const char *raster =
+    MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "raster");
   const char *accept =
     MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT);
 
   if (width != NULL) {
-    os_graf_mx = atoi(width);
+    os_graf_mx = get_dimension(width, os_graf_mx);
   }
   if (height != NULL) {
-    os_graf_my = atoi(height);
+    os_graf_my = get_dimension(height, os_graf_my);
   }
   if (graphicText != NULL) {
     g_graphicText = atoi(graphicText) > 0;
   }
+  if (raster != NULL) {
+    g_raster = atoi(raster) > 0;
+  }
   if (command != NULL) {
     strcpy(opt_command, command);
   }
 
   log("%s dim:%dX%d", bas, os_graf_mx, os_graf_my);
   g_connection = connection;
+  g_canvas.setRaster(g_raster, os_graf_mx, os_graf_my);
   g_canvas.reset();
   g_start = dev_get_millisecond_count();
   g_canvas.setGraphicText(g_graphicText);
@@ -238,7 +258,7 @@ int main(int argc, char **argv) {
 
   while (1) {
     int option_index = 0;
-    int c = getopt_long(argc, argv, "hvfxp:t:m::r:w:e:c:g:", OPTIONS, &option_index);
+    int c = getopt_long(argc, argv, "hvfxp:t:m::r:w:e:c:g:a:", OPTIONS, &option_index);
     if (c == -1) {
       break;
     }
@@ -251,10 +271,10 @@ int main(int argc, char **argv) {
       runBas = optarg;
       break;
     case 'w':
-      os_graf_mx = atoi(optarg);
+      os_graf_mx = get_dimension(optarg, os_graf_mx);
       break;
     case 'e':
-      os_graf_my = atoi(optarg);
+      os_graf_my = get_dimension(optarg, os_graf_my);
       break;
     case 'c':
       strcpy(opt_command, optarg);
@@ -262,6 +282,9 @@ int main(int argc, char **argv) {
     case 'g':
       g_graphicText = atoi(optarg) > 1;
       break;
+    case 'a':
+      g_raster = atoi(optarg) > 0;
+      break;
     case 'v':
       opt_verbose = true;
       opt_quiet = false;
@@ -296,6 +319,7 @@ int main(int argc, char **argv) {
   }
 
   if (runBas != NULL) {
+    g_canvas.setRaster(g_raster, os_graf_mx, os_graf_my);
     g_canvas.reset();
     g_start = dev_get_millisecond_count();
     sbasic_main(runBas);
@@ -327,6 +351,10 @@ void osd_line(int x1, int y1, int x2, int y2) {
   g_canvas.drawLine(x1, y1, x2, y2);
 }
 
+int osd_polyline(const int *points, int count) {
+  return 0;
+}
+
 void osd_rect(int x1, int y1, int x2, int y2, int fill) {
   if (fill) {
     g_canvas.drawRectFilled(x1, y1, x2, y2);
@@ -343,6 +371,22 @@ void osd_settextcolor(long fg, long bg) {
   g_canvas.setTextColor(fg, bg);
 }
 
+void osd_ellipse(int xc, int yc, int xr, int yr, int fill) {
+  g_canvas.drawEllipse(xc, yc, xr, yr, fill);
+}
+
+long osd_getpixel(int x, int y) {
+  return g_canvas.getPixel(x, y);
+}
+
+int osd_getpixels(int x, int y, int w, int h, int *pixels) {
+  return g_canvas.readPixels(x, y, w, h, pixels);
+}
+
+int osd_setpixels(int x, int y, int w, int h, const int *pixels) {
+  return g_canvas.writePixels(x, y, w, h, pixels);
+}
+
 void osd_setpixel(int x, int y) {
   g_canvas.setPixel(x, y, dev_fgcolor);
 }
@@ -465,14 +509,12 @@ int osd_getpen(int code) {return 0;}
 int osd_getx() { return 0; }
 int osd_gety() { return 0; }
 int osd_textheight(const char *str) { return 1; }
-long osd_getpixel(int x, int y) { return 0;}
 void osd_beep() {}
 void osd_clear_sound_queue() {}
 void osd_refresh() {}
 void osd_setpenmode(int enable) {}
 void osd_audio(const char *path) {}
 void osd_sound(int frq, int ms, int vol, int bgplay) {}
-void osd_ellipse(int xc, int yc, int xr, int yr, int fill) {}
 void osd_arc(int xc, int yc, double r, double as, double ae, double aspect) {}
 void v_create_image(var_p_t var) {}
 void v_create_form(var_p_t var) {}
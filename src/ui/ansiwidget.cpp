@@ -145,6 +145,15 @@ void AnsiWidget::drawLine(int x1, int y1, int x2, int y2) {
   flush(false, false, MAX_PENDING_GRAPHICS);
 }
 
+// draw connected lines onto the offscreen buffer
+bool AnsiWidget::drawPolyline(const int *points, int count) {
+  bool result = _back->drawPolyline(points, count);
+  if (result) {
+    flush(false, false, MAX_PENDING_GRAPHICS);
+  }
+  return result;
+}
+
 // draw a rectangle onto the offscreen buffer
 void AnsiWidget::drawRect(int x1, int y1, int x2, int y2) {
   _back->drawRect(x1, y1, x2, y2);
@@ -236,6 +245,7 @@ void AnsiWidget::print(const char *str) {
 
 // redraws and flushes the front screen
 void AnsiWidget::redraw() {
+  _front->invalidate();
   _front->drawInto();
   flushNow();
 }
@@ -347,6 +357,14 @@ void AnsiWidget::setPixel(int x, int y, int c) {
   flush(false, false, MAX_PENDING_GRAPHICS);
 }
 
+bool AnsiWidget::setPixels(int x, int y, int w, int h, const int *pixels) {
+  bool result = _back->setPixels(x, y, w, h, pixels);
+  if (result) {
+    flush(false, false, MAX_PENDING_GRAPHICS);
+  }
+  return result;
+}
+
 void AnsiWidget::setStatus(const char *label) {
   _back->_label = label;
   _back->setDirty();
@@ -385,7 +403,7 @@ void AnsiWidget::insetMenuScreen(int x, int y, int w, int h) {
   menuScreen->_height = h;
   menuScreen->setOver(_front);
   _front = _back = menuScreen;
-  _front->_dirty = true;
+  _front->invalidate();
 }
 
 void AnsiWidget::insetTextScreen(int x, int y, int w, int h) {
@@ -395,7 +413,7 @@ void AnsiWidget::insetTextScreen(int x, int y, int w, int h) {
   TextScreen *textScreen = (TextScreen *)createScreen(TEXT_SCREEN);
   textScreen->inset(x, y, w, h, _front);
   _front = _back = textScreen;
-  _front->_dirty = true;
+  _front->invalidate();
   flush(true);
 }
 
@@ -505,7 +523,7 @@ void AnsiWidget::pointerReleaseEvent(MAEvent &event) {
         _front->_scrollY = maxScroll;
       }
       // ensure the scrollbar is removed
-      _front->_dirty = true;
+      _front->invalidate();
       flush(true);
       _touchTime = 0;
     }
@@ -576,7 +594,7 @@ void AnsiWidget::doSwipe(int start, bool moveDown, int distance, int maxScroll)
       vscroll = maxScroll;
     }
     if (vscroll != _front->_scrollY) {
-      _front->_dirty = true; // forced
+      _front->invalidate(); // forced
       _front->_scrollY = vscroll;
       flush(true, true);
     } else {
@@ -713,7 +731,7 @@ bool AnsiWidget::setActiveButton(MAEvent &event, Screen *screen) {
         break;
       }
       if (redraw) {
-        _front->_dirty = true;
+        _front->invalidate();
         flush(true);
       }
     }
@@ -731,7 +749,7 @@ void AnsiWidget::selectBackScreen(int screenId) {
 
 void AnsiWidget::selectFrontScreen(int screenId) {
   _front = createScreen(screenId);
-  _front->_dirty = true;
+  _front->invalidate();
   flush(true);
 }
 
@@ -739,7 +757,7 @@ int AnsiWidget::selectScreen(int screenId, bool forceFlush) {
   int result = getScreenId(true);
   selectBackScreen(screenId);
   _front = _back;
-  _front->_dirty = true;
+  _front->invalidate();
   flush(forceFlush);
   return result;
 }
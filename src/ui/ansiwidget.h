@@ -43,6 +43,7 @@ struct AnsiWidget {
   void drawEllipse(int xc, int yc, int rx, int ry, int fill);
   void drawOverlay(bool vscroll) { _back->drawOverlay(vscroll); }
   void drawLine(int x1, int y1, int x2, int y2);
+  bool drawPolyline(const int *points, int count);
   void drawRect(int x1, int y1, int x2, int y2);
   void drawRectFilled(int x1, int y1, int x2, int y2);
   void flush(bool force, bool vscroll=false, int maxPending = MAX_PENDING);
@@ -54,6 +55,7 @@ struct AnsiWidget {
   int  getFontSize() { return _fontSize; }
   FormInput *getNextField(FormInput *field) { return _back->getNextField(field); }
   int  getPixel(int x, int y) { return _back->getPixel(x, y); }
+  bool getPixels(int x, int y, int w, int h, int *pixels) { return _back->getPixels(x, y, w, h, pixels); }
   int  getScreenId(bool back);
   int  getScreenWidth()  { return _back->_width; }
   void getScroll(int &x, int &y) { _back->getScroll(x, y); }
@@ -93,6 +95,7 @@ struct AnsiWidget {
   void setFont(int size, bool bold, bool italic);
   void setFontSize(int fontSize);
   void setPixel(int x, int y, int c);
+  bool setPixels(int x, int y, int w, int h, const int *pixels);
   void setScroll(int x, int y) { _back->setScroll(x, y); }
   void setStatus(const char *label);
   void setTextColor(long fg, long bg);
@@ -12,6 +12,12 @@
 #include "ui/utils.h"
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "common/smbas.h"
 #include "common/device.h"
 
@@ -33,8 +39,14 @@ inline double fpart(double x) {
 #define _SWAP(a, b) \
   { __typeof__(a) tmp; tmp = a; a = b; b = tmp; }
 
+//
+// renders the glyphs once into an atlas, to be blended as spans of
+// coverage values by drawChar
+//
 Font::Font(FT_Face face, int size, bool italic) :
-  _face(face) {
+  _advance(0),
+  _face(face),
+  _atlas(NULL) {
   FT_Set_Pixel_Sizes(face, 0, size);
   _spacing = 1 + (FT_MulFix(_face->height, _face->size->metrics.x_scale) / 64);
   _h = (FT_MulFix(_face->ascender, _face->size->metrics.x_scale) / 64) +
@@ -47,39 +59,186 @@ Font::Font(FT_Face face, int size, bool italic) :
     matrix.yy = 0x10000L;
   }
 
+  FT_Glyph slots[MAX_GLYPHS];
+  int atlasSize = 0;
+  bool fixed = true;
   for (int i = 0; i < MAX_GLYPHS; i++) {
     FT_UInt slot = FT_Get_Char_Index(face, i);
     FT_Error error = FT_Load_Glyph(face, slot, FT_LOAD_TARGET_LIGHT);
     if (error) {
       trace("Failed to load %d", i);
     }
-    error = FT_Get_Glyph(face->glyph, &_glyph[i]._slot);
+    slots[i] = NULL;
+    error = FT_Get_Glyph(face->glyph, &slots[i]);
     if (error) {
       trace("Failed to get glyph %d", i);
     }
-    if (italic) {
-      FT_Glyph_Transform(_glyph[i]._slot, &matrix, 0 );
+    if (slots[i] != NULL && italic) {
+      FT_Glyph_Transform(slots[i], &matrix, 0 );
     }
     FT_Vector origin;
     origin.x = 0;
     origin.y = 0;
-    error = FT_Glyph_To_Bitmap(&_glyph[i]._slot, FT_RENDER_MODE_LIGHT, &origin, 1);
+    error = slots[i] == NULL ? 1 : FT_Glyph_To_Bitmap(&slots[i], FT_RENDER_MODE_LIGHT, &origin, 1);
+    Glyph &glyph = _glyph[i];
     if (error) {
       trace("Failed to get bitmap %d", i);
+      glyph._left = glyph._top = glyph._width = glyph._rows = 0;
+    } else {
+      FT_BitmapGlyph bitmapGlyph = (FT_BitmapGlyph)slots[i];
+      glyph._left = bitmapGlyph->left;
+      glyph._top = bitmapGlyph->top;
+      glyph._width = bitmapGlyph->bitmap.width;
+      glyph._rows = bitmapGlyph->bitmap.rows;
     }
-    _glyph[i]._w = (int)(face->glyph->metrics.horiAdvance / 64);
+    glyph._offset = atlasSize;
+    glyph._w = (int)(face->glyph->metrics.horiAdvance / 64);
+    atlasSize += glyph._width * glyph._rows;
+    fixed &= (glyph._w == _glyph[0]._w);
+  }
+  if (fixed) {
+    // text extents without visiting each character
+    _advance = _glyph[0]._w;
   }
-}
 
-Font::~Font() {
+  _atlas = (uint8_t *)malloc(atlasSize + 1);
+  if (_atlas == NULL) {
+    trace("Failed to allocate glyph atlas");
+  }
   for (int i = 0; i < MAX_GLYPHS; i++) {
-    FT_Done_Glyph(_glyph[i]._slot);
+    Glyph &glyph = _glyph[i];
+    if (_atlas == NULL) {
+      // keep the metrics, but draw nothing
+      glyph._width = 0;
+    } else if (glyph._width) {
+      FT_Bitmap *bitmap = &((FT_BitmapGlyph)slots[i])->bitmap;
+      for (int y = 0; y < glyph._rows; y++) {
+        memcpy(_atlas + glyph._offset + (y * glyph._width),
+               bitmap->buffer + (y * bitmap->pitch), glyph._width);
+      }
+    }
+    if (slots[i] != NULL) {
+      FT_Done_Glyph(slots[i]);
+    }
   }
 }
 
+Font::~Font() {
+  free(_atlas);
+}
+
 //
 // Graphics implementation
 //
+// the byte offsets of the colour channels in the source images
+#if defined(PIXELFORMAT_RGBA8888)
+  #define SRC_R 2
+  #define SRC_G 1
+  #define SRC_B 0
+  #define DST_ALPHA 0xff000000
+#else
+  #define SRC_R 0
+  #define SRC_G 1
+  #define SRC_B 2
+  #define DST_ALPHA 0
+#endif
+
+// round(x / 255) for x <= 255 * 255 + 128
+inline uint8_t div255(unsigned x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+// whether every pixel in the span has full alpha
+inline bool isOpaque(const uint8_t *src, int count) {
+  const uint8_t *end = src + 4 * count;
+  for (src += 3; src < end && *src == 0xff; src += 4) {
+    // continue
+  }
+  return src >= end;
+}
+
+//
+// blends count source pixels over dst. each pixel is weighted by its alpha
+// or, when weight is non-zero, pixels that are not mostly transparent are
+// weighted by weight instead (image opacity). weights are out of 255, a
+// weight of 255 replaces and 0 preserves the destination exactly
+//
+static void blendSpan(pixel_t *dst, const uint8_t *src, int count, int weight) {
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(128);
+  const __m128i full = _mm_set1_epi16(255);
+  const __m128i limit = _mm_set1_epi16(64);
+  const __m128i fixed = _mm_set1_epi16(weight);
+  const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+  const __m128i alpha = _mm_set1_epi32(DST_ALPHA);
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    __m128i result[2];
+    for (int half = 0; half < 2; half++) {
+      __m128i sc = half ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+      __m128i dc = half ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+#if SRC_R == 0
+      // RGBA to the BGRA layout of the destination
+      sc = _mm_shufflelo_epi16(sc, _MM_SHUFFLE(3, 0, 1, 2));
+      sc = _mm_shufflehi_epi16(sc, _MM_SHUFFLE(3, 0, 1, 2));
+#endif
+      __m128i w = _mm_shufflelo_epi16(sc, _MM_SHUFFLE(3, 3, 3, 3));
+      w = _mm_shufflehi_epi16(w, _MM_SHUFFLE(3, 3, 3, 3));
+      if (weight) {
+        __m128i mask = _mm_cmpgt_epi16(w, limit);
+        w = _mm_or_si128(_mm_and_si128(mask, fixed), _mm_andnot_si128(mask, w));
+      }
+      __m128i t = _mm_add_epi16(_mm_mullo_epi16(sc, w),
+                                _mm_mullo_epi16(dc, _mm_sub_epi16(full, w)));
+      t = _mm_add_epi16(t, round);
+      result[half] = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+    __m128i r = _mm_packus_epi16(result[0], result[1]);
+    r = _mm_or_si128(_mm_and_si128(r, rgb), alpha);
+    _mm_storeu_si128((__m128i *)(dst + i), r);
+  }
+#elif defined(__ARM_NEON)
+  const uint8x8_t limit = vdup_n_u8(64);
+  const uint8x8_t fixed = vdup_n_u8(weight);
+  const uint16x8_t round = vdupq_n_u16(128);
+  for (; i + 8 <= count; i += 8) {
+    uint8x8x4_t s = vld4_u8(src + 4 * i);
+    uint8x8x4_t d = vld4_u8((const uint8_t *)(dst + i));
+    uint8x8_t w = s.val[3];
+    if (weight) {
+      w = vbsl_u8(vcgt_u8(w, limit), fixed, w);
+    }
+    uint8x8_t iw = vmvn_u8(w);
+    // destination bytes are B, G, R, A
+    const int channel[3] = {SRC_B, SRC_G, SRC_R};
+    for (int c = 0; c < 3; c++) {
+      uint16x8_t t = vmlal_u8(vmull_u8(s.val[channel[c]], w), d.val[c], iw);
+      t = vaddq_u16(t, round);
+      d.val[c] = vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+    }
+    d.val[3] = vdup_n_u8(DST_ALPHA >> 24);
+    vst4_u8((uint8_t *)(dst + i), d);
+  }
+#endif
+  for (const uint8_t *p = src + 4 * i; i < count; i++, p += 4) {
+    int w = (weight && p[3] > 64) ? weight : p[3];
+    if (w == 255) {
+      dst[i] = SET_RGB(p[SRC_R], p[SRC_G], p[SRC_B]);
+    } else if (w != 0) {
+      uint8_t dR, dG, dB;
+      GET_RGB(dst[i], dR, dG, dB);
+      dR = div255(p[SRC_R] * w + dR * (255 - w));
+      dG = div255(p[SRC_G] * w + dG * (255 - w));
+      dB = div255(p[SRC_B] * w + dB * (255 - w));
+      dst[i] = SET_RGB(dR, dG, dB);
+    }
+  }
+}
+
 Graphics::Graphics() :
   _screen(NULL),
   _drawTarget(NULL),
@@ -271,6 +430,24 @@ void Graphics::drawLine(int startX, int startY, int endX, int endY) {
   }
 }
 
+// draws the lines joining the points. with antialiasing, the point shared
+// by adjoining lines is only blended once
+void Graphics::drawPolyline(const int *points, int count) {
+  if (_drawTarget) {
+    for (int i = 1; i < count; i++) {
+      int x1 = points[i * 2 - 2];
+      int y1 = points[i * 2 - 1];
+      int x2 = points[i * 2];
+      int y2 = points[i * 2 + 1];
+      if (opt_antialias && x1 != x2 && y1 != y2) {
+        aaLine(x1, y1, x2, y2, i > 1);
+      } else {
+        drawLine(x1, y1, x2, y2);
+      }
+    }
+  }
+}
+
 void Graphics::drawPixel(int posX, int posY) {
   pixel_t *line = _drawTarget->getLine(posY);
   line[posX] = _drawColor;
@@ -278,85 +455,63 @@ void Graphics::drawPixel(int posX, int posY) {
 
 void Graphics::drawRGB(const MAPoint2d *dstPoint, const void *src,
                        const MARect *srcRect, int opacity, int bytesPerLine) {
-  uint8_t *image = (uint8_t *)src;
-  size_t scale = 1;
+  const uint8_t *image = (const uint8_t *)src;
   int w = bytesPerLine;
+  int weight = 0;
 
   if (opacity > 0 && opacity < 100) {
     // higher opacity values should make the image less transparent
-    opacity = 100 - opacity;
-  }
-  for (int y = srcRect->top; y < srcRect->height; y += scale) {
-    int dY = dstPoint->y + y;
-    if (dY >= _drawTarget->y() &&
-        dY <  _drawTarget->h()) {
-      pixel_t *line = _drawTarget->getLine(dY);
-      for (int x = srcRect->left; x < srcRect->width; x += scale) {
-        int dX = dstPoint->x + x;
-        if (dX >= _drawTarget->x() &&
-            dX <  _drawTarget->w()) {
-          // get RGBA components
-          uint8_t r,g,b,a;
+    weight = (opacity * 255 + 50) / 100;
+  }
+
+  // clip once, rather than for each pixel
+  int x1 = MAX(srcRect->left, _drawTarget->x() - dstPoint->x);
+  int x2 = MIN(srcRect->width, _drawTarget->w() - dstPoint->x);
+  int y1 = MAX(srcRect->top, _drawTarget->y() - dstPoint->y);
+  int y2 = MIN(srcRect->height, _drawTarget->h() - dstPoint->y);
+
+  for (int y = y1; x1 < x2 && y < y2; y++) {
+    pixel_t *line = _drawTarget->getLine(dstPoint->y + y) + dstPoint->x + x1;
+    const uint8_t *pixels = image + 4 * (y * w + x1);
 #if defined(PIXELFORMAT_RGBA8888)
-          b = image[4 * y * w + 4 * x + 0]; // blue
-          g = image[4 * y * w + 4 * x + 1]; // green
-          r = image[4 * y * w + 4 * x + 2]; // red
-          a = image[4 * y * w + 4 * x + 3]; // alpha
-#else
-          r = image[4 * y * w + 4 * x + 0]; // red
-          g = image[4 * y * w + 4 * x + 1]; // green
-          b = image[4 * y * w + 4 * x + 2]; // blue
-          a = image[4 * y * w + 4 * x + 3]; // alpha
-#endif
-          uint8_t dR, dG, dB;
-          GET_RGB(line[dX], dR, dG, dB);
-          if (opacity > 0 && opacity < 100 && a > 64) {
-            float op = opacity / 100.0f;
-            dR = ((1-op) * r) + (op * dR);
-            dG = ((1-op) * g) + (op * dG);
-            dB = ((1-op) * b) + (op * dB);
-          } else {
-            dR = dR + ((r - dR) * a / 255);
-            dG = dG + ((g - dG) * a / 255);
-            dB = dB + ((b - dB) * a / 255);
-          }
-          line[dX] = SET_RGB(dR, dG, dB);
-        }
-      }
+    if (!weight && isOpaque(pixels, x2 - x1)) {
+      // same byte order, nothing to blend
+      memcpy(line, pixels, (x2 - x1) * sizeof(pixel_t));
+      continue;
     }
+#endif
+    blendSpan(line, pixels, x2 - x1, weight);
   }
 }
 
-void Graphics::drawChar(FT_Bitmap *bitmap, FT_Int x, FT_Int y) {
-  FT_Int xMax = x + bitmap->width;
-  FT_Int yMax = y + bitmap->rows;
+void Graphics::drawChar(const Glyph &glyph, int x, int y) {
+  // clip once, rather than for each pixel
+  int x1 = MAX(x, _drawTarget->x());
+  int x2 = MIN(x + glyph._width, _drawTarget->w());
+  int y1 = MAX(y, _drawTarget->y());
+  int y2 = MIN(y + glyph._rows, _drawTarget->h());
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
 
   uint8_t sR, sG, sB;
   GET_RGB(_drawColor, sR, sG, sB);
 
-  int dtX = _drawTarget->x();
-  int dtY = _drawTarget->y();
-  int dtW = _drawTarget->w();
-  int dtH = _drawTarget->h();
-
-  for (FT_Int j = y, q = 0; j < yMax; j++, q++) {
-    if (j >= dtY && j < dtH) {
-      pixel_t *line = _drawTarget->getLine(j);
-      for (FT_Int i = x, p = 0; i < xMax; i++, p++) {
-        if (i >= dtX && i < dtW) {
-          uint8_t a = bitmap->buffer[q * bitmap->width + p];
-          if (a == 255) {
-            line[i] = _drawColor;
-          } else {
-            // blend drawColor to the background
-            uint8_t dR, dG, dB;
-            GET_RGB(line[i], dR, dG, dB);
-            dR = dR + ((sR - dR) * a / 255);
-            dG = dG + ((sG - dG) * a / 255);
-            dB = dB + ((sB - dB) * a / 255);
-            line[i] = SET_RGB(dR, dG, dB);
-          }
-        }
+  const uint8_t *coverage = _font->_atlas + glyph._offset + ((y1 - y) * glyph._width) + (x1 - x);
+  for (int j = y1; j < y2; j++, coverage += glyph._width) {
+    pixel_t *line = _drawTarget->getLine(j) + x1;
+    for (int i = 0; i < x2 - x1; i++) {
+      uint8_t a = coverage[i];
+      if (a == 255) {
+        line[i] = _drawColor;
+      } else if (a) {
+        // blend drawColor to the background
+        uint8_t dR, dG, dB;
+        GET_RGB(line[i], dR, dG, dB);
+        dR = dR + ((sR - dR) * a / 255);
+        dG = dG + ((sG - dG) * a / 255);
+        dB = dB + ((sB - dB) * a / 255);
+        line[i] = SET_RGB(dR, dG, dB);
       }
     }
   }
@@ -364,16 +519,14 @@ void Graphics::drawChar(FT_Bitmap *bitmap, FT_Int x, FT_Int y) {
 
 void Graphics::drawText(int left, int top, const char *str, int len) {
   if (_drawTarget && _font) {
-    FT_Vector pen;
-    pen.x = left;
-    pen.y = top + _font->_h + ((_font->_spacing - _font->_h) / 2);
+    int penX = left;
+    int penY = top + _font->_h + ((_font->_spacing - _font->_h) / 2);
     for (int i = 0; i < len; i++) {
-      uint8_t ch = str[i];
-      FT_BitmapGlyph glyph = (FT_BitmapGlyph)_font->_glyph[ch]._slot;
-      drawChar(&glyph->bitmap,
-               pen.x + glyph->left,
-               pen.y - glyph->top);
-      pen.x += _font->_glyph[ch]._w;
+      const Glyph &glyph = _font->_glyph[(uint8_t)str[i]];
+      if (glyph._width) {
+        drawChar(glyph, penX + glyph._left, penY - glyph._top);
+      }
+      penX += glyph._w;
     }
   }
 }
@@ -429,7 +582,10 @@ int Graphics::getPixel(Canvas *canvas, int posX, int posY) {
 MAExtent Graphics::getTextSize(const char *str, int len) {
   int width = 0;
   int height = 0;
-  if (_font) {
+  if (_font && _font->_advance) {
+    width = len * _font->_advance;
+    height = _font->_spacing;
+  } else if (_font) {
     for (int i = 0; i < len; i++) {
       uint8_t ch = str[i];
       width += _font->_glyph[ch]._w;
@@ -459,8 +615,12 @@ MAHandle Graphics::setDrawTarget(MAHandle maHandle) {
 }
 
 // see: http://en.wikipedia.org/wiki/Xiaolin_Wu%27s_line_algorithm
-void Graphics::aaLine(int x0, int y0, int x1, int y1) {
+// joined lines start at the end of the previous line, which has already
+// been drawn
+void Graphics::aaLine(int x0, int y0, int x1, int y1, bool joined) {
   int steep = abs(y1 - y0) > abs(x1 - x0);
+  bool drawStart = !joined;
+  bool drawEnd = true;
 
   if (steep) {
     _SWAP(x0, y0);
@@ -469,6 +629,8 @@ void Graphics::aaLine(int x0, int y0, int x1, int y1) {
   if (x0 > x1) {
     _SWAP(x0, x1);
     _SWAP(y0, y1);
+    drawStart = true;
+    drawEnd = !joined;
   }
 
   double dx = x1 - x0;
@@ -484,7 +646,9 @@ void Graphics::aaLine(int x0, int y0, int x1, int y1) {
   int xpxl1 = (int)xend;
   int ypxl1 = (int)yend;
 
-  if (steep) {
+  if (!drawStart) {
+    // shared with the previous line
+  } else if (steep) {
     aaPlot(ypxl1,   xpxl1, 1 - fpart(yend) * xgap);
     aaPlot(ypxl1+1, xpxl1,  1 - fpart(yend) * xgap);
   } else {
@@ -504,16 +668,20 @@ void Graphics::aaLine(int x0, int y0, int x1, int y1) {
   int ypxl2 = (int)yend;
 
   if (steep) {
-    aaPlot(ypxl2  , xpxl2, 1 - fpart(yend) * xgap);
-    aaPlot(ypxl2+1, xpxl2,  fpart(yend) * xgap);
+    if (drawEnd) {
+      aaPlot(ypxl2  , xpxl2, 1 - fpart(yend) * xgap);
+      aaPlot(ypxl2+1, xpxl2,  fpart(yend) * xgap);
+    }
     for (int x = xpxl1 + 1; x < xpxl2; x++) {
       aaPlot((int)intery,   x, 1 - fpart(intery));
       aaPlot((int)intery+1, x, fpart(intery));
       intery += gradient;
     }
   } else {
-    aaPlot(xpxl2, ypxl2,  1 - fpart(yend) * xgap);
-    aaPlot(xpxl2, ypxl2+1, fpart(yend) * xgap);
+    if (drawEnd) {
+      aaPlot(xpxl2, ypxl2,  1 - fpart(yend) * xgap);
+      aaPlot(xpxl2, ypxl2+1, fpart(yend) * xgap);
+    }
     for (int x = xpxl1 + 1; x < xpxl2; x++) {
       aaPlot(x, (int)intery,   1 - fpart(intery));
       aaPlot(x, (int)intery+1, fpart(intery));
@@ -627,6 +795,10 @@ void maLine(int startX, int startY, int endX, int endY) {
   graphics->drawLine(startX, startY, endX, endY);
 }
 
+void maPolyline(const int *points, int count) {
+  graphics->drawPolyline(points, count);
+}
+
 void maFillRect(int left, int top, int width, int height) {
   Canvas *drawTarget = graphics->getDrawTarget();
   if (drawTarget) {
@@ -25,8 +25,12 @@ using namespace strlib;
 namespace ui {
 
 struct Glyph {
-  FT_Glyph _slot;
-  int _w;
+  int _w;       // horizontal advance
+  int _left;    // bitmap position relative to the pen
+  int _top;
+  int _width;   // bitmap size
+  int _rows;
+  int _offset;  // bitmap position in the font atlas
 };
 
 struct Font {
@@ -34,7 +38,9 @@ struct Font {
   virtual ~Font();
   int _h;
   int _spacing;
+  int _advance;     // the advance of every glyph, or 0 when proportional
   FT_Face _face;
+  uint8_t *_atlas;  // 8 bit coverage of the glyph bitmaps, without padding
   Glyph _glyph[MAX_GLYPHS];
 };
 
@@ -49,6 +55,7 @@ struct Graphics {
   void drawAaEllipse(int xc, int yc, int rx, int ry, bool fill);
   void drawImageRegion(Canvas *src, const MAPoint2d *dstPoint, const MARect *srcRect);
   void drawLine(int startX, int startY, int endX, int endY);
+  void drawPolyline(const int *points, int count);
   void drawPixel(int posX, int posY);
   void drawRectFilled(int left, int top, int width, int height);
   void drawRGB(const MAPoint2d *dstPoint, const void *src,
@@ -68,8 +75,8 @@ struct Graphics {
   MAHandle setDrawTarget(MAHandle maHandle);
 
 protected:
-  void drawChar(FT_Bitmap *bitmap, FT_Int x, FT_Int y);
-  void aaLine(int x0, int y0, int x1, int y1);
+  void drawChar(const Glyph &glyph, int x, int y);
+  void aaLine(int x0, int y0, int x1, int y1, bool joined=false);
   void aaPlot(int x, int y, double c);
   void aaPlotX8(int xc, int yc, int x, int y, double c, bool fill);
   void aaPlotY8(int xc, int yc, int x, int y, double c, bool fill);
@@ -11,6 +11,7 @@
 #include "common/messages.h"
 #include "common/pproc.h"
 #include "common/fs_socket_client.h"
+#include "common/image_filter.h"
 #include "lib/maapi.h"
 #include "lib/lodepng/lodepng.h"
 #include "ui/image.h"
@@ -28,6 +29,13 @@
 #define IMG_ID "ID"
 #define IMG_BID "BID"
 
+// matches the byte order used by Graphics::drawRGB
+#if defined(PIXELFORMAT_RGBA8888)
+  #define IMG_BGR 1
+#else
+  #define IMG_BGR 0
+#endif
+
 extern System *g_system;
 unsigned nextId = 0;
 strlib::List<ImageBuffer *> cache;
@@ -41,7 +49,8 @@ ImageBuffer::ImageBuffer() :
   _image(nullptr),
   _bid(0),
   _width(0),
-  _height(0) {
+  _height(0),
+  _revision(0) {
 }
 
 ImageBuffer::ImageBuffer(ImageBuffer &o) :
@@ -49,7 +58,8 @@ ImageBuffer::ImageBuffer(ImageBuffer &o) :
   _image(o._image),
   _bid(o._bid),
   _width(o._width),
-  _height(o._height) {
+  _height(o._height),
+  _revision(o._revision) {
 }
 
 ImageBuffer::~ImageBuffer() {
@@ -66,27 +76,10 @@ ImageDisplay::ImageDisplay() : Shape(0, 0, 0, 0),
   _opacity(0),
   _id(0),
   _bid(0),
+  _revision(0),
   _buffer(nullptr) {
 }
 
-ImageDisplay::ImageDisplay(ImageDisplay &o) : Shape(o._x, o._y, o._width, o._height) {
-  copyImage(o);
-}
-
-void ImageDisplay::copyImage(ImageDisplay &o) {
-  _x = o._x;
-  _y = o._y;
-  _offsetLeft = o._offsetLeft;
-  _offsetTop = o._offsetTop;
-  _width =o._width;
-  _height = o._height;
-  _zIndex = o._zIndex;
-  _opacity = o._opacity;
-  _id = o._id;
-  _bid = o._bid;
-  _buffer = o._buffer;
-}
-
 void ImageDisplay::draw(int x, int y, int w, int h, int cw) {
   MAPoint2d dstPoint;
   MARect srcRect;
@@ -309,6 +302,7 @@ void cmd_image_show(var_s *self, var_s *) {
     ImageBuffer *next = (*it);
     if (next->_bid == image._bid) {
       image._buffer = next;
+      image._revision = next->_revision;
       break;
     }
   }
@@ -415,6 +409,34 @@ void cmd_image_save(var_s *self, var_s *) {
   }
 }
 
+//
+// Native image operations (image_filter.c), applied to the shared image buffer
+//
+int img_buffer_get(var_t *self, img_buffer_t *img) {
+  ImageBuffer *image = load_image(self);
+  if (image != nullptr) {
+    img->pixels = image->_image;
+    img->width = image->_width;
+    img->height = image->_height;
+    img->bgr = IMG_BGR;
+  }
+  return image != nullptr;
+}
+
+void img_buffer_set(var_t *self, const img_buffer_t *img) {
+  ImageBuffer *image = load_image(self);
+  if (image != nullptr) {
+    image->_revision++;
+    if (img->pixels != image->_image) {
+      image->_image = img->pixels;
+      image->_width = img->width;
+      image->_height = img->height;
+      map_set_int(self, IMG_WIDTH, img->width);
+      map_set_int(self, IMG_HEIGHT, img->height);
+    }
+  }
+}
+
 void create_image(var_p_t var, ImageBuffer *image) {
   map_init(var);
   map_add_var(var, IMG_X, 0);
@@ -430,6 +452,7 @@ void create_image(var_p_t var, ImageBuffer *image) {
   v_create_func(var, "show", cmd_image_show);
   v_create_func(var, "hide", cmd_image_hide);
   v_create_func(var, "save", cmd_image_save);
+  img_create_methods(var);
 }
 
 // loads an image for the form image input type
@@ -22,22 +22,48 @@ struct ImageBuffer {
   unsigned _bid;
   int _width;
   int _height;
+  unsigned _revision;
 };
 
 struct ImageDisplay : public Shape {
   ImageDisplay();
-  ImageDisplay(ImageDisplay &imageDisplay);
+  ImageDisplay(ImageDisplay &o) : Shape(o._x, o._y, o._width, o._height) {
+    copyImage(o);
+  }
   virtual ~ImageDisplay() {}
 
-  void copyImage(ImageDisplay &imageDisplay);
+  void copyImage(ImageDisplay &o) {
+    _x = o._x;
+    _y = o._y;
+    _offsetLeft = o._offsetLeft;
+    _offsetTop = o._offsetTop;
+    _width = o._width;
+    _height = o._height;
+    _zIndex = o._zIndex;
+    _opacity = o._opacity;
+    _id = o._id;
+    _bid = o._bid;
+    _revision = o._revision;
+    _buffer = o._buffer;
+  }
   void draw(int x, int y, int bw, int bh, int cw);
 
+  // whether the other image would appear the same on the screen
+  bool equals(const ImageDisplay &o) const {
+    return (_x == o._x && _y == o._y &&
+            _offsetLeft == o._offsetLeft && _offsetTop == o._offsetTop &&
+            _width == o._width && _height == o._height &&
+            _zIndex == o._zIndex && _opacity == o._opacity &&
+            _buffer == o._buffer && _revision == o._revision);
+  }
+
   int _offsetLeft;
   int _offsetTop;
   int _zIndex;
   int _opacity;
   unsigned _id;
   unsigned _bid;
+  unsigned _revision;
   ImageBuffer *_buffer;
 };
 
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "ui/screen.h"
+#include "ui/rgb.h"
 
 #define WHITE 15
 #define SCROLL_IND 4
@@ -21,12 +22,6 @@
       rect->_y <= _scrollY + _height) \
     rect->draw(_x + rect->_x, _y + rect->_y - _scrollY, w(), h(), _charWidth)
 
-int compareZIndex(const void *p1, const void *p2) {
-  ImageDisplay **i1 = (ImageDisplay **)p1;
-  ImageDisplay **i2 = (ImageDisplay **)p2;
-  return (*i1)->_zIndex < (*i2)->_zIndex ? -1 : (*i1)->_zIndex == (*i2)->_zIndex ? 0 : 1;
-}
-
 bool Shape::isFullScreen() const {
   MAExtent screenSize = maGetScrSize();
   return _width == EXTENT_X(screenSize) && _height == EXTENT_Y(screenSize);
@@ -46,7 +41,12 @@ Screen::Screen(int x, int y, int width, int height, int fontSize) :
   _curX(INITXY),
   _curY(INITXY),
   _dirty(0),
-  _linePadding(0) {
+  _linePadding(0),
+  _damageAll(false) {
+  _damage.left = 0;
+  _damage.top = 0;
+  _damage.width = 0;
+  _damage.height = 0;
 }
 
 Screen::~Screen() {
@@ -76,21 +76,56 @@ void Screen::add(Shape *button) {
   }
 }
 
+// extends the area of the base image to be presented by the next drawBase
+void Screen::addDamage(int x1, int y1, int x2, int y2) {
+  int left = MIN(x1, x2);
+  int top = MIN(y1, y2);
+  int right = MAX(x1, x2) + 1;
+  int bottom = MAX(y1, y2) + 1;
+  if (_damage.width > 0) {
+    left = MIN(left, _damage.left);
+    top = MIN(top, _damage.top);
+    right = MAX(right, _damage.left + _damage.width);
+    bottom = MAX(bottom, _damage.top + _damage.height);
+  }
+  _damage.left = left;
+  _damage.top = top;
+  _damage.width = right - left;
+  _damage.height = bottom - top;
+  setPending();
+}
+
+// shows the image, or updates an image already shown. the images are kept
+// in z order, with the most recently added image on top of equal values.
+// only the areas that have changed are presented by the next drawBase
 void Screen::addImage(ImageDisplay &image) {
-  bool exists = false;
+  ImageDisplay *display = NULL;
+  bool unchanged = false;
   List_each(ImageDisplay *, it, _images) {
     ImageDisplay *next = (*it);
     if (next->_id == image._id) {
-      exists = true;
-      next->copyImage(image);
+      display = next;
+      unchanged = next->equals(image);
+      if (!unchanged) {
+        // uncover the previous position
+        addDamage(next->_x, next->_y, next->_x + next->_width, next->_y + next->_height);
+        bool reorder = next->_zIndex != image._zIndex;
+        next->copyImage(image);
+        if (reorder) {
+          _images.remove(it);
+          insertImage(next);
+        }
+      }
       break;
     }
   }
-  if (!exists) {
-    _images.add(new ImageDisplay(image));
+  if (display == NULL) {
+    display = new ImageDisplay(image);
+    insertImage(display);
+  }
+  if (!unchanged) {
+    addDamage(image._x, image._y, image._x + image._width, image._y + image._height);
   }
-  _images.sort(compareZIndex);
-  setDirty();
 }
 
 void Screen::clear() {
@@ -163,7 +198,10 @@ void Screen::drawOverlay(bool vscroll) {
   }
 
   List_each(ImageDisplay *, it, _images) {
-    DRAW_SHAPE;
+    ImageDisplay *image = (*it);
+    if (isVisible(image)) {
+      image->draw(_x + image->_x, _y + image->_y - _scrollY, w(), h(), _charWidth);
+    }
   }
 
   FormInput *drawTop = NULL;
@@ -363,13 +401,36 @@ bool Screen::removeInput(FormInput *input) {
   return result;
 }
 
+// inserts the image after any others with the same or lower z index
+void Screen::insertImage(ImageDisplay *image) {
+  int lo = 0;
+  int hi = _images.size();
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (_images[mid]->_zIndex <= image->_zIndex) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  _images.insert(lo, image);
+}
+
+// whether any part of the image is within the visible page
+bool Screen::isVisible(const ImageDisplay *image) const {
+  return (image->_x < _width && image->_x + image->_width > 0 &&
+          image->_y < _scrollY + _height && image->_y + image->_height > _scrollY);
+}
+
 // remove the image from the list
 void Screen::removeImage(unsigned imageId) {
   List_each(ImageDisplay *, it, _images) {
     ImageDisplay *next = (*it);
     if (next->_id == imageId) {
+      // uncover the image
+      addDamage(next->_x, next->_y, next->_x + next->_width, next->_y + next->_height);
       _images.remove(it);
-      setDirty();
+      delete next;
       break;
     }
   }
@@ -487,7 +548,8 @@ GraphicScreen::GraphicScreen(int width, int height, int fontSize) :
   _imageHeight(height),
   _curYSaved(0),
   _curXSaved(0),
-  _tabSize(40) {  // tab size in pixels (160/32 = 5)
+  _tabSize(40),  // tab size in pixels (160/32 = 5)
+  _baseScrollY(0) {
 }
 
 GraphicScreen::~GraphicScreen() {
@@ -523,27 +585,62 @@ void GraphicScreen::clear() {
   maSetColor(_bg);
   maFillRect(0, 0, _imageWidth, _imageHeight);
   Screen::clear();
+  setDirty();
 }
 
 void GraphicScreen::drawArc(int xc, int yc, double r, double start, double end, double aspect) {
+  int rx = (int)r + 1;
+  int ry = (int)(r * aspect) + 1;
   drawInto();
   maArc(xc, yc, r, start, end, aspect);
+  addDamage(xc - rx, yc - ry, xc + rx, yc + ry);
 }
 
+//
+// presents the base image followed by the overlay. when only draw calls
+// have changed the screen since the last time, the blit is limited to the
+// union of their areas.
+//
 void GraphicScreen::drawBase(bool vscroll, bool update) {
   MARect srcRect;
   MAPoint2d dstPoint;
-  srcRect.left = 0;
-  srcRect.top = _scrollY;
-  srcRect.width = _width;
-  srcRect.height = _height;
-  dstPoint.x = _x;
-  dstPoint.y = _y;
   MAHandle currentHandle = maSetDrawTarget(HANDLE_SCREEN);
-  maDrawImageRegion(_image, &srcRect, &dstPoint, TRANS_NONE);
+  if (getDamage(srcRect, vscroll)) {
+    if (srcRect.width > 0) {
+      dstPoint.x = _x + srcRect.left;
+      dstPoint.y = _y + srcRect.top - _scrollY;
+      maDrawImageRegion(_image, &srcRect, &dstPoint, TRANS_NONE);
+
+      // the images covering the area were included by getDamage
+      List_each(ImageDisplay *, it, _images) {
+        ImageDisplay *image = (*it);
+        if (isVisible(image) &&
+            image->_x < srcRect.left + srcRect.width &&
+            image->_x + image->_width > srcRect.left &&
+            image->_y < srcRect.top + srcRect.height &&
+            image->_y + image->_height > srcRect.top) {
+          image->draw(_x + image->_x, _y + image->_y - _scrollY, w(), h(), _charWidth);
+        }
+      }
+    } else {
+      // nothing visible has changed
+      update = false;
+    }
+  } else {
+    srcRect.left = 0;
+    srcRect.top = _scrollY;
+    srcRect.width = _width;
+    srcRect.height = _height;
+    dstPoint.x = _x;
+    dstPoint.y = _y;
+    maDrawImageRegion(_image, &srcRect, &dstPoint, TRANS_NONE);
+    drawOverlay(vscroll);
+  }
 
-  drawOverlay(vscroll);
   _dirty = 0;
+  _damage.width = 0;
+  _damageAll = false;
+  _baseScrollY = _scrollY;
   if (update) {
     maUpdateScreen();
   }
@@ -553,16 +650,42 @@ void GraphicScreen::drawBase(bool vscroll, bool update) {
 void GraphicScreen::drawEllipse(int xc, int yc, int rx, int ry, int fill) {
   drawInto();
   maEllipse(xc, yc, rx, ry, fill);
+  addDamage(xc - rx - 1, yc - ry - 1, xc + rx + 1, yc + ry + 1);
 }
 
+// the screen becomes pending without damage, which redraws in full unless
+// followed by a draw call
 void GraphicScreen::drawInto(bool background) {
   maSetDrawTarget(_image);
-  Screen::drawInto(background);
+  maSetColor(background ? _bg : _fg);
+  setPending();
 }
 
 void GraphicScreen::drawLine(int x1, int y1, int x2, int y2) {
   drawInto();
   maLine(x1, y1, x2, y2);
+
+  // allow for antialiasing
+  addDamage(MIN(x1, x2) - 1, MIN(y1, y2) - 1, MAX(x1, x2) + 1, MAX(y1, y2) + 1);
+}
+
+bool GraphicScreen::drawPolyline(const int *points, int count) {
+  int x1 = points[0];
+  int y1 = points[1];
+  int x2 = x1;
+  int y2 = y1;
+  for (int i = 1; i < count; i++) {
+    x1 = MIN(x1, points[i * 2]);
+    y1 = MIN(y1, points[i * 2 + 1]);
+    x2 = MAX(x2, points[i * 2]);
+    y2 = MAX(y2, points[i * 2 + 1]);
+  }
+  drawInto();
+  maPolyline(points, count);
+
+  // allow for antialiasing
+  addDamage(x1 - 1, y1 - 1, x2 + 1, y2 + 1);
+  return true;
 }
 
 void GraphicScreen::drawRect(int x1, int y1, int x2, int y2) {
@@ -571,11 +694,61 @@ void GraphicScreen::drawRect(int x1, int y1, int x2, int y2) {
   maLine(x1, y2, x2, y2); // bottom
   maLine(x1, y1, x1, y2); // left
   maLine(x2, y1, x2, y2); // right
+  addDamage(MIN(x1, x2) - 1, MIN(y1, y2) - 1, MAX(x1, x2) + 1, MAX(y1, y2) + 1);
 }
 
 void GraphicScreen::drawRectFilled(int x1, int y1, int x2, int y2) {
   drawInto();
   maFillRect(x1, y1, x2 - x1, y2 - y1);
+  addDamage(x1, y1, x2, y2);
+}
+
+//
+// returns whether the next drawBase can be limited to the given area of the
+// base image. the area is extended to include any images it overlaps, since
+// blended images are drawn in full over a fresh copy of the base.
+//
+bool GraphicScreen::getDamage(MARect &rect, bool vscroll) {
+  bool result = (!_damageAll && !vscroll && _damage.width > 0 &&
+                 _scrollY == _baseScrollY && _shapes.empty() &&
+                 _inputs.empty() && _label.empty());
+  if (result) {
+    int x1 = _damage.left;
+    int y1 = _damage.top;
+    int x2 = _damage.left + _damage.width;
+    int y2 = _damage.top + _damage.height;
+    bool extended = true;
+    while (extended) {
+      extended = false;
+      List_each(ImageDisplay *, it, _images) {
+        ImageDisplay *image = (*it);
+        if (isVisible(image) &&
+            image->_x < x2 && image->_x + image->_width > x1 &&
+            image->_y < y2 && image->_y + image->_height > y1 &&
+            (image->_x < x1 || image->_y < y1 ||
+             image->_x + image->_width > x2 || image->_y + image->_height > y2)) {
+          x1 = MIN(x1, image->_x);
+          y1 = MIN(y1, image->_y);
+          x2 = MAX(x2, image->_x + image->_width);
+          y2 = MAX(y2, image->_y + image->_height);
+          extended = true;
+        }
+      }
+    }
+    // clip to the visible page
+    x1 = MAX(x1, 0);
+    y1 = MAX(y1, _scrollY);
+    x2 = MIN(x2, _width);
+    y2 = MIN(y2, _scrollY + _height);
+    rect.left = x1;
+    rect.top = y1;
+    rect.width = MAX(0, x2 - x1);
+    rect.height = MAX(0, y2 - y1);
+    if (!rect.height) {
+      rect.width = 0;
+    }
+  }
+  return result;
 }
 
 // returns the color of the pixel at the given xy location
@@ -600,6 +773,28 @@ int GraphicScreen::getPixel(int x, int y) {
   return result;
 }
 
+// copies the colors of the rectangle of pixels, as returned by getPixel
+bool GraphicScreen::getPixels(int x, int y, int w, int h, int *pixels) {
+  if (w == 1 && h == 1) {
+    pixels[0] = getPixel(x, y);
+  } else if (w > 0 && h > 0) {
+    MARect rc;
+    rc.left = x;
+    rc.top = y;
+    rc.width = w;
+    rc.height = h;
+    memset(pixels, 0, w * h * sizeof(int));
+    maGetImageData(_image, pixels, &rc, w * sizeof(int));
+
+    // convert the rgba bytes in place
+    const uint8_t *rgba = (const uint8_t *)pixels;
+    for (int i = 0; i < w * h; i++, rgba += 4) {
+      pixels[i] = -((rgba[0] << 16) | (rgba[1] << 8) | rgba[2]);
+    }
+  }
+  return true;
+}
+
 // extend the image to allow for additional content on the newline
 void GraphicScreen::imageAppend(MAHandle newImage) {
   MARect srcRect;
@@ -654,6 +849,7 @@ void GraphicScreen::imageScroll() {
     _image = newImage;
     _scrollY -= scrollBack;
     _curY -= scrollBack;
+    setDirty();
   } else {
     // unable to create duplicate
     maDestroyPlaceholder(newImage);
@@ -711,6 +907,7 @@ int GraphicScreen::print(const char *p, int lineHeight, bool allChars) {
     maLine(cx, _curY + lineHeight - 2, _curX, _curY + lineHeight - 2);
   }
 
+  addDamage(cx, _curY, _curX, _curY + lineHeight);
   return numChars;
 }
 
@@ -771,6 +968,7 @@ void GraphicScreen::resize(int newWidth, int newHeight, int oldWidth,
   _scrollY = 0;
   _width = newWidth;
   _height = newHeight;
+  setDirty();
   if (!fullscreen) {
     drawBase(false);
   }
@@ -787,6 +985,7 @@ bool GraphicScreen::setGraphicsRendition(const char c, int escValue, int lineHei
   case 'K':
     maSetColor(_bg);            // \e[K - clear to eol
     maFillRect(_curX, _curY, _width - _curX, lineHeight);
+    addDamage(_curX, _curY, _width, _curY + lineHeight);
     break;
   case 'G':                    // move to column
     _curX = escValue * _charWidth;
@@ -899,6 +1098,39 @@ void GraphicScreen::setPixel(int x, int y, int c) {
   drawInto();
   maSetColor(ansiToMosync(c));
   maPlot(x, y);
+  addDamage(x, y, x, y);
+}
+
+// draws the rectangle of pixels, with the colors as given to setPixel
+bool GraphicScreen::setPixels(int x, int y, int w, int h, const int *pixels) {
+  if (w > 0 && h > 0) {
+    uint8_t *rgba = (uint8_t *)malloc(w * h * 4);
+    if (rgba == NULL) {
+      return false;
+    }
+    for (int i = 0; i < w * h; i++) {
+      pixel_t px = ansiToMosync(pixels[i]);
+      uint8_t r, g, b;
+      GET_RGB2(px, r, g, b);
+      rgba[i * 4 + 0] = r;
+      rgba[i * 4 + 1] = g;
+      rgba[i * 4 + 2] = b;
+      rgba[i * 4 + 3] = 255;
+    }
+    MAPoint2d pt;
+    pt.x = x;
+    pt.y = y;
+    MARect rc;
+    rc.left = 0;
+    rc.top = 0;
+    rc.width = w;
+    rc.height = h;
+    drawInto();
+    maDrawRGB(&pt, rgba, &rc, 0, w);
+    free(rgba);
+    addDamage(x, y, x + w - 1, y + h - 1);
+  }
+  return true;
 }
 
 struct LineShape : Shape {
@@ -991,6 +1223,7 @@ void TextScreen::drawBase(bool vscroll, bool update) {
   }
 
   if (_over != NULL && _over != this) {
+    _over->setDirty();
     _over->drawBase(vscroll, false);
   }
 
@@ -1238,3 +1471,45 @@ bool TextScreen::setGraphicsRendition(const char c, int escValue, int lineHeight
   return false;
 }
 
+// g++ -c -I. ui/strlib.cpp && g++ -DUNIT_TESTS=1 -D_FLTK -I. -I.. -no-pie ui/screen.cpp strlib.o -Wl,--unresolved-symbols=ignore-all && ./a.out
+#if defined(UNIT_TESTS)
+#include <stdio.h>
+void assertEq(int a, int b) {
+  if (a != b) {
+    fprintf(stderr, "FAIL: %d != %d\n", a, b);
+  }
+}
+// image.cpp needs the stb and lodepng submodules
+ImageDisplay::ImageDisplay() : Shape(0, 0, 0, 0), _offsetLeft(0), _offsetTop(0), _zIndex(0),
+  _opacity(0), _id(0), _bid(0), _revision(0), _buffer(nullptr) {}
+void ImageDisplay::draw(int x, int y, int w, int h, int cw) {}
+void addImage(Screen &screen, unsigned id, int zIndex) {
+  ImageDisplay image;
+  image._id = id;
+  image._zIndex = zIndex;
+  image._width = 10;
+  image._height = 10;
+  screen.addImage(image);
+}
+int main() {
+  GraphicScreen screen(100, 100, 10);
+  screen._dirty = 1;  // avoid the timer in setPending()
+  addImage(screen, 1, 1);
+  addImage(screen, 2, 2);
+  addImage(screen, 3, 3);
+  assertEq(1, screen._images[0]->_id);
+  assertEq(3, screen._images[2]->_id);
+
+  // raising and lowering sorts by the new z index
+  addImage(screen, 1, 4);
+  assertEq(2, screen._images[0]->_id);
+  assertEq(1, screen._images[2]->_id);
+  assertEq(4, screen._images[2]->_zIndex);
+  addImage(screen, 3, 0);
+  assertEq(3, screen._images[0]->_id);
+  assertEq(2, screen._images[1]->_id);
+  assertEq(1, screen._images[2]->_id);
+  assertEq(3, screen._images.size());
+  return 0;
+}
+#endif
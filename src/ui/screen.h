@@ -36,13 +36,16 @@ struct Screen : public Shape {
   virtual void drawEllipse(int xc, int yc, int rx, int ry, int fill) = 0;
   virtual void drawInto(bool background=false);
   virtual void drawLine(int x1, int y1, int x2, int y2) = 0;
+  virtual bool drawPolyline(const int *points, int count) = 0;
   virtual void drawRect(int x1, int y1, int x2, int y2) = 0;
   virtual void drawRectFilled(int x1, int y1, int x2, int y2) = 0;
   virtual void newLine(int lineHeight) = 0;
   virtual int  getPixel(int x, int y) = 0;
+  virtual bool getPixels(int x, int y, int w, int h, int *pixels) = 0;
   virtual int  print(const char *p, int lineHeight, bool allChars=false);
   virtual bool setGraphicsRendition(const char c, int escValue, int lineHeight) = 0;
   virtual void setPixel(int x, int y, int c) = 0;
+  virtual bool setPixels(int x, int y, int w, int h, const int *pixels) = 0;
   virtual void reset(int fontSize);
   virtual void resize(int newWidth, int newHeight, int oldWidth,
                       int oldHeight, int lineHeight) = 0;
@@ -50,6 +53,7 @@ struct Screen : public Shape {
   virtual int  getMaxHScroll() = 0;
 
   void add(Shape *button);
+  void addDamage(int x1, int y1, int x2, int y2);
   void addImage(ImageDisplay &image);
   int  ansiToMosync(long c);
   void drawLabel();
@@ -61,6 +65,9 @@ struct Screen : public Shape {
   FormInput *getNextMenu(FormInput *prev, bool up);
   FormInput *getNextField(FormInput *field);
   void getScroll(int &x, int &y) { x = _scrollX; y = _scrollY; }
+  void insertImage(ImageDisplay *image);
+  void invalidate() { _damageAll = true; _dirty = 1; }
+  bool isVisible(const ImageDisplay *image) const;
   void layoutInputs(int newWidth, int newHeight);
   bool overLabel(int px, int py);
   bool overMenu(int px, int py);
@@ -72,7 +79,8 @@ struct Screen : public Shape {
   void replaceFont(int type = FONT_TYPE_MONOSPACE);
   void resetScroll() { _scrollX = 0; _scrollY = 0; }
   void setColor(long color);
-  void setDirty() { if (!_dirty) { _dirty = maGetMilliSecondCount(); } }
+  void setDirty() { _damageAll = true; setPending(); }
+  void setPending() { if (!_dirty) { _dirty = maGetMilliSecondCount(); } }
   void setFont(bool bold, bool italic, int size);
   void selectFont() { if (_font != -1) maFontSetCurrent(_font); }
   void setScroll(int x, int y) { _scrollX = x; _scrollY = y; }
@@ -91,6 +99,8 @@ struct Screen : public Shape {
   int _curY;
   int _dirty;
   int _linePadding;
+  MARect _damage;
+  bool _damageAll;
   String _label;
   strlib::List<Shape *> _shapes;
   strlib::List<FormInput *> _inputs;
@@ -109,9 +119,12 @@ struct GraphicScreen : public Screen {
   void drawEllipse(int xc, int yc, int rx, int ry, int fill);
   void drawInto(bool background=false);
   void drawLine(int x1, int y1, int x2, int y2);
+  bool drawPolyline(const int *points, int count);
   void drawRect(int x1, int y1, int x2, int y2);
   void drawRectFilled(int x1, int y1, int x2, int y2);
+  bool getDamage(MARect &rect, bool vscroll);
   int  getPixel(int x, int y);
+  bool getPixels(int x, int y, int w, int h, int *pixels);
   void imageScroll();
   void imageAppend(MAHandle newImage);
   void newLine(int lineHeight);
@@ -119,6 +132,7 @@ struct GraphicScreen : public Screen {
   void reset(int fontSize);
   bool setGraphicsRendition(const char c, int escValue, int lineHeight);
   void setPixel(int x, int y, int c);
+  bool setPixels(int x, int y, int w, int h, const int *pixels);
   void resize(int newWidth, int newHeight, int oldWidth,
               int oldHeight, int lineHeight);
   void updateFont(int size);
@@ -134,6 +148,7 @@ struct GraphicScreen : public Screen {
   int _curYSaved;
   int _curXSaved;
   int _tabSize;
+  int _baseScrollY;
 };
 
 struct TextSeg {
@@ -328,10 +343,12 @@ struct TextScreen : public Screen {
   void drawBase(bool vscroll, bool update=true);
   void drawEllipse(int xc, int yc, int rx, int ry, int fill) {}
   void drawLine(int x1, int y1, int x2, int y2);
+  bool drawPolyline(const int *points, int count) { return false; }
   void drawText(const char *text, int len, int x, int lineHeight);
   void drawRect(int x1, int y1, int x2, int y2);
   void drawRectFilled(int x1, int y1, int x2, int y2);
   int  getPixel(int x, int y) { return 0; }
+  bool getPixels(int x, int y, int w, int h, int *pixels) { return false; }
   void inset(int x, int y, int w, int h, Screen *over);
   void newLine(int lineHeight);
   int  print(const char *p, int lineHeight, bool allChars=false);
@@ -340,6 +357,7 @@ struct TextScreen : public Screen {
   bool setGraphicsRendition(const char c, int escValue, int lineHeight);
   void setOver(Screen *over) { _over = over; }
   void setPixel(int x, int y, int c) {}
+  bool setPixels(int x, int y, int w, int h, const int *pixels) { return false; }
   void updateFont(int size) {}
   int  getMaxHScroll() { return (_cols * _charWidth) - w(); }
 
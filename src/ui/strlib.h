@@ -133,6 +133,15 @@ struct List {
     _head[_count - 1] = object;
   }
 
+  /**
+   * Inserts T before the element at index
+   */
+  void insert(int index, T object) {
+    add(object);
+    memmove(_head + index + 1, _head + index, (_count - index - 1) * sizeof(T));
+    _head[index] = object;
+  }
+
   /**
    * Removes the element pointed to by TP i.
    */
@@ -1277,6 +1277,14 @@ long osd_getpixel(int x, int y) {
   return g_system->getOutput()->getPixel(x, y);
 }
 
+int osd_getpixels(int x, int y, int w, int h, int *pixels) {
+  return g_system->getOutput()->getPixels(x, y, w, h, pixels);
+}
+
+int osd_setpixels(int x, int y, int w, int h, const int *pixels) {
+  return g_system->getOutput()->setPixels(x, y, w, h, pixels);
+}
+
 int osd_getx(void) {
   return g_system->getOutput()->getX();
 }
@@ -1297,6 +1305,10 @@ void osd_ellipse(int xc, int yc, int xr, int yr, int fill) {
   g_system->getOutput()->drawEllipse(xc, yc, xr, yr, fill);
 }
 
+int osd_polyline(const int *points, int count) {
+  return g_system->getOutput()->drawPolyline(points, count);
+}
+
 void osd_rect(int x1, int y1, int x2, int y2, int fill) {
   if (fill) {
     g_system->getOutput()->drawRectFilled(x1, y1, x2, y2);